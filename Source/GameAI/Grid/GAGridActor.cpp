@@ -1,11 +1,18 @@
 #include "GAGridActor.h"
+#include "GAGridRasterizer.h"
+#include "GAGridSnapshot.h"
+#include "GAGridMapKernels.h"
 
 #include "Components/SceneComponent.h"
 #include "Components/BoxComponent.h"
 #include "ProceduralMeshComponent.h"
 #include "NavigationSystem.h"
 #include "NavMesh/RecastNavMesh.h"
+#include "NavAreas/NavArea.h"
 #include "Engine/Texture2D.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Async/Async.h"
+#include "Misc/Paths.h"
 
 
 FCellRef FCellRef::Invalid(INDEX_NONE, INDEX_NONE);
@@ -17,6 +24,12 @@ AGAGridActor::AGAGridActor(const FObjectInitializer& ObjectInitializer)
 	XCount = 100;
 	YCount = 100;
 	CellScale = 100.0f;
+	GridVersion = 0;
+	HeightsVersion = 0;
+	TraversableVersion = 0;
+	VisibilityTableVersion = 0;
+	RegionXCount = 0;
+	RegionYCount = 0;
 	RefreshDerivedValues();
 
 	SceneComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
@@ -37,279 +50,1549 @@ AGAGridActor::AGAGridActor(const FObjectInitializer& ObjectInitializer)
 	DebugMeshComponent->SetVisibility(false);
 
 	DebugMeshZOffset = 30.0f;
+	DebugMeshTraceDistance = 1000.0f;
+	DebugMeshXCount = 0;
+	DebugMeshYCount = 0;
+	DebugMeshCellScale = 0.0f;
+	DebugMeshBuiltZOffset = 0.0f;
+	DebugMeshHeightsVersion = 0;
+	bDebugMeshBuilt = false;
+
+	bUseLegacyRasterizer = false;
+
+	BuildSerial = 0;
+	bAsyncBuildInProgress = false;
+	bRefreshOnNavChange = true;
+	NavChecksum = 0;
+	bUseGridSnapshot = true;
+
+	NextStampHandle = 0;
+
+	bBakeVisibility = false;
+	VisibilityBlockSize = 4;
+	VisibilityEyeHeight = 100.0f;
+
+	bBuildCostField = true;
+	CellFlagCosts.Add(ECellData::CellDataSlow, 3);
+	CellFlagCosts.Add(ECellData::CellDataDoor, 2);
+	CellFlagCosts.Add(ECellData::CellDataHazard, 8);
+}
+
+void AGAGridActor::PostLoad()
+{
+#if WITH_EDITORONLY_DATA
+	RefreshBoxComponent();
+#endif //WITH_EDITORONLY_DATA
+
+	RefreshDerivedValues();
+	RefreshDerivedData(GetGridRect());
+	Super::PostLoad();
+}
+
+void AGAGridActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetNavigationSystem(this);
+	if (NavSystem)
+	{
+		NavSystem->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &AGAGridActor::OnNavigationGenerationFinished);
+	}
+}
+
+void AGAGridActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetNavigationSystem(this);
+	if (NavSystem)
+	{
+		NavSystem->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &AGAGridActor::OnNavigationGenerationFinished);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+#if WITH_EDITORONLY_DATA
+void AGAGridActor::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	FName ChangedPropertyName = PropertyChangedEvent.GetMemberPropertyName();
+
+	// If the width, height or scale change, refresh the scale of the BoxComponent
+	if ((ChangedPropertyName == FName("XCount")) || (ChangedPropertyName == FName("YCount")) || (ChangedPropertyName == FName("CellScale")))
+	{
+		RefreshBoxComponent();
+	}
+
+	RefreshDerivedValues();
+
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+}
+
+void AGAGridActor::RefreshBoxComponent()
+{
+	FVector DesiredExtents;
+
+	DesiredExtents.X = 0.5f * float(XCount) * CellScale;
+	DesiredExtents.Y = 0.5f * float(YCount) * CellScale;
+	DesiredExtents.Z = 10.0f;
+
+	BoxComponent->SetBoxExtent(DesiredExtents);
+}
+
+#endif // WITH_EDITORONLY_DATA
+
+
+void AGAGridActor::RefreshDerivedValues()
+{
+	// Refresh HalfExtents
+	HalfExtents.X = 0.5f * CellScale * float(XCount);
+	HalfExtents.Y = 0.5f * CellScale * float(YCount);
+
+	// Refresh the region versions if the grid has been resized
+	int32 NewRegionXCount = FMath::DivideAndRoundUp(FMath::Max(XCount, 1), RegionSize);
+	int32 NewRegionYCount = FMath::DivideAndRoundUp(FMath::Max(YCount, 1), RegionSize);
+	if ((NewRegionXCount != RegionXCount) || (NewRegionYCount != RegionYCount) || (RegionVersions.Num() != NewRegionXCount * NewRegionYCount))
+	{
+		RegionXCount = NewRegionXCount;
+		RegionYCount = NewRegionYCount;
+		GridVersion++;
+		RegionVersions.Init(GridVersion, RegionXCount * RegionYCount);
+	}
+}
+
+
+bool AGAGridActor::ResetData()
+{
+	bool Result = false;
+	Data.SetNum(GetCellCount());
+	CellHeights.Init(FGAGridHeightQuantizer::NoHeight, GetCellCount());
+	HeightsVersion++;
+
+	ECellData* GridData = GetData();
+	if (GridData)
+	{
+		memset(GridData, 0, GetCellCount() * sizeof(ECellData));
+	}
+
+	return Result;
+}
+
+// Return the cell the given point is inside of
+// If bClamp = true, then any point outside of the grid will be clamped to the bounds of the grid
+// Otherwise, if the point is outside the grid, it will return FCellRef::Invalid
+
+FCellRef AGAGridActor::GetCellRef(const FVector& Point, bool bClamp) const
+{
+	// First, transform the point into grid-local space
+	// note, we drop the Z dimension at this point, by casting to a FVector2D
+	const FTransform& GridTransform = GetActorTransform();
+	FVector2D LocalPoint = FVector2D(GridTransform.InverseTransformPosition(Point));
+
+	if (bClamp)
+	{
+		LocalPoint.X = FMath::Clamp(LocalPoint.X, -HalfExtents.X, HalfExtents.X);
+		LocalPoint.Y = FMath::Clamp(LocalPoint.Y, -HalfExtents.Y, HalfExtents.Y);
+	}
+	else if (FMath::Abs(LocalPoint.X) > HalfExtents.X || FMath::Abs(LocalPoint.Y) > HalfExtents.Y)
+	{
+		return FCellRef::Invalid;
+	}
+
+	LocalPoint += HalfExtents;		// Now LocalPoint is relative the to the (0, 0) corner of grid
+
+	// Discretize by dividing by scale and flooring
+	// Out of an abundance of caution we also clamp the result to a valid index, to avoid any floating-point issues
+
+	FCellRef Result(
+		FMath::Clamp(FMath::FloorToInt32(LocalPoint.X / CellScale), 0, XCount - 1),
+		FMath::Clamp(FMath::FloorToInt32(LocalPoint.Y / CellScale), 0, YCount - 1)
+	);
+	return Result;
+}
+
+FVector AGAGridActor::GetCellPosition(const FCellRef& CellRef) const
+{
+	float HalfScale = 0.5f * CellScale;
+
+	// Grab the center of the cell, then offset by -HalfExtents, so that it is relative to the center of the grid
+	FVector LocalResult;
+	LocalResult.X = CellRef.X * CellScale + HalfScale - HalfExtents.X;
+	LocalResult.Y = CellRef.Y * CellScale + HalfScale - HalfExtents.Y;
+	LocalResult.Z = 0.0f;
+
+	// Sit the point on the ground if we know where it is
+	float Height;
+	if (GetCellLocalHeight(CellRef, Height))
+	{
+		LocalResult.Z = Height;
+	}
+
+	const FTransform& ActorTransform = GetActorTransform();
+	FVector Result = ActorTransform.TransformPosition(LocalResult);
+	return Result;
+}
+
+const AGAGridActor::FGridTransformCache& AGAGridActor::GetTransformCache() const
+{
+	check(IsInGameThread());
+
+	// An exact compare, so that even the smallest move shows up in the conversions
+	const FTransform& ActorTransform = GetActorTransform();
+	if (!TransformCache.bValid || !TransformCache.Transform.Equals(ActorTransform, 0.0f))
+	{
+		TransformCache.Transform = ActorTransform;
+		TransformCache.Matrix = ActorTransform.ToMatrixWithScale();
+		TransformCache.InverseMatrix = ActorTransform.ToInverseMatrixWithScale();
+		TransformCache.InvScale = ActorTransform.GetSafeScaleReciprocal(ActorTransform.GetScale3D());
+		TransformCache.bNoRotation = ActorTransform.GetRotation().IsIdentity();
+		TransformCache.bValid = true;
+	}
+	return TransformCache;
+}
+
+void AGAGridActor::GetCellRefs(TConstArrayView<FVector> Points, TArrayView<FCellRef> CellRefsOut, bool bClamp) const
+{
+	check(CellRefsOut.Num() >= Points.Num());
+
+	const FGridTransformCache& Cache = GetTransformCache();
+	const bool bNoRotation = Cache.bNoRotation;
+	const FVector Translation = Cache.Transform.GetTranslation();
+	const FVector InvScale = Cache.InvScale;
+	const FMatrix& InverseMatrix = Cache.InverseMatrix;
+
+	auto ToLocal = [&](const FVector& Point)
+	{
+		return bNoRotation ? FVector2D((Point - Translation) * InvScale) : FVector2D(FVector(InverseMatrix.TransformPosition(Point)));
+	};
+
+	// Two points at a time: lanes are (X0, Y0, X1, Y1), in cells relative to the (0, 0) corner of the grid
+	const float InvCellScale = 1.0f / CellScale;
+	const VectorRegister4Float CellMax = MakeVectorRegisterFloat(float(XCount - 1), float(YCount - 1), float(XCount - 1), float(YCount - 1));
+	const VectorRegister4Float CellMin = VectorZeroFloat();
+	alignas(16) int32 Cells[4];
+
+	for (int32 Index = 0; Index < Points.Num(); Index += 2)
+	{
+		const bool bPair = (Index + 1 < Points.Num());
+		const FVector2D Local0 = ToLocal(Points[Index]);
+		const FVector2D Local1 = bPair ? ToLocal(Points[Index + 1]) : Local0;
+
+		const FVector2D Grid0 = (Local0 + HalfExtents) * InvCellScale;
+		const FVector2D Grid1 = (Local1 + HalfExtents) * InvCellScale;
+
+		// Clamping to the cell range after the floor gives the same answer as clamping the point to the extents before it
+		VectorRegister4Float Lanes = MakeVectorRegisterFloat(float(Grid0.X), float(Grid0.Y), float(Grid1.X), float(Grid1.Y));
+		Lanes = VectorMin(VectorMax(VectorFloor(Lanes), CellMin), CellMax);
+		VectorIntStoreAligned(VectorFloatToInt(Lanes), Cells);
+
+		CellRefsOut[Index] = FCellRef(Cells[0], Cells[1]);
+		if (!bClamp && ((FMath::Abs(Local0.X) > HalfExtents.X) || (FMath::Abs(Local0.Y) > HalfExtents.Y)))
+		{
+			CellRefsOut[Index] = FCellRef::Invalid;
+		}
+
+		if (bPair)
+		{
+			CellRefsOut[Index + 1] = FCellRef(Cells[2], Cells[3]);
+			if (!bClamp && ((FMath::Abs(Local1.X) > HalfExtents.X) || (FMath::Abs(Local1.Y) > HalfExtents.Y)))
+			{
+				CellRefsOut[Index + 1] = FCellRef::Invalid;
+			}
+		}
+	}
+}
+
+void AGAGridActor::GetCellPositions(TConstArrayView<FCellRef> CellRefs, TArrayView<FVector> PositionsOut) const
+{
+	check(PositionsOut.Num() >= CellRefs.Num());
+
+	const FGridTransformCache& Cache = GetTransformCache();
+	const bool bNoRotation = Cache.bNoRotation;
+	const FVector Translation = Cache.Transform.GetTranslation();
+	const FVector Scale = Cache.Transform.GetScale3D();
+	const FMatrix& Matrix = Cache.Matrix;
+
+	const float HalfScale = 0.5f * CellScale;
+	const bool bHasHeights = (CellHeights.Num() == GetCellCount());
+
+	for (int32 Index = 0; Index < CellRefs.Num(); Index++)
+	{
+		const FCellRef& CellRef = CellRefs[Index];
+
+		FVector LocalResult;
+		LocalResult.X = CellRef.X * CellScale + HalfScale - HalfExtents.X;
+		LocalResult.Y = CellRef.Y * CellScale + HalfScale - HalfExtents.Y;
+		LocalResult.Z = 0.0f;
+
+		if (bHasHeights && (CellRef.X >= 0) && (CellRef.X < XCount) && (CellRef.Y >= 0) && (CellRef.Y < YCount))
+		{
+			const uint16 Height = CellHeights[CellRefToIndex(CellRef)];
+			if (Height != FGAGridHeightQuantizer::NoHeight)
+			{
+				LocalResult.Z = HeightQuantizer.Dequantize(Height);
+			}
+		}
+
+		PositionsOut[Index] = bNoRotation ? (LocalResult * Scale + Translation) : FVector(Matrix.TransformPosition(LocalResult));
+	}
+}
+
+FVector2D AGAGridActor::GetCellGridSpacePosition(const FCellRef& CellRef) const
+{
+	float HalfScale = 0.5f * CellScale;
+
+	// Grab the center of the cell, then offset by -HalfExtents, so that it is relative to the center of the grid
+	FVector2D LocalResult;
+	LocalResult.X = CellRef.X * CellScale + HalfScale;
+	LocalResult.Y = CellRef.Y * CellScale + HalfScale;
+
+	return LocalResult;
+}
+
+
+
+bool AGAGridActor::GetCellLocalHeight(const FCellRef& CellRef, float& HeightOut) const
+{
+	if ((CellRef.X < 0) || (CellRef.X >= XCount) || (CellRef.Y < 0) || (CellRef.Y >= YCount) || (CellHeights.Num() != GetCellCount()))
+	{
+		return false;
+	}
+
+	const uint16 Height = CellHeights[CellRefToIndex(CellRef)];
+	if (Height == FGAGridHeightQuantizer::NoHeight)
+	{
+		return false;
+	}
+
+	HeightOut = HeightQuantizer.Dequantize(Height);
+	return true;
+}
+
+bool AGAGridActor::HasCellHeight(const FCellRef& CellRef) const
+{
+	float Height;
+	return GetCellLocalHeight(CellRef, Height);
+}
+
+bool AGAGridActor::GetHeightAboveGround(const FVector& Point, float& HeightOut) const
+{
+	FCellRef CellRef = GetCellRef(Point, false);
+	if (!HasCellHeight(CellRef))
+	{
+		return false;
+	}
+
+	HeightOut = Point.Z - GetCellPosition(CellRef).Z;
+	return true;
+}
+
+ECellData AGAGridActor::GetCellData(const FCellRef &CellRef) const
+{
+	int32 CellIndex = CellRefToIndex(CellRef);
+	return HasStampCounts() ? ApplyStampsToCell(CellIndex, Data[CellIndex]) : Data[CellIndex];
+}
+
+
+bool AGAGridActor::GridSpaceBoundsToRect2D(const FBox2D& Box, FIntRect &RectOut) const
+{
+	float HalfScale = 0.5f * CellScale;
+
+	RectOut.Min.X = FMath::Max(int32((Box.Min.X + HalfScale) / CellScale), 0);
+	RectOut.Max.X = FMath::Min(int32((Box.Max.X - HalfScale) / CellScale), XCount - 1);	
+	RectOut.Min.Y = FMath::Max(int32((Box.Min.Y + HalfScale) / CellScale), 0);
+	RectOut.Max.Y = FMath::Min(int32((Box.Max.Y - HalfScale) / CellScale), YCount - 1);
+
+	return (RectOut.Min.X <= RectOut.Max.X) && (RectOut.Min.Y <= RectOut.Max.Y);
+}
+
+
+// Data from NavSystem --------------------------------
+
+const ARecastNavMesh* AGAGridActor::GetNavMesh() const
+{
+	UNavigationSystemV1 *NavSystem = UNavigationSystemV1::GetNavigationSystem(this);
+	if (NavSystem)
+	{
+		INavigationDataInterface* NavData = NavSystem->GetMainNavData();		// Note: only using the default nav data here
+		return Cast<ARecastNavMesh>(NavData);
+	}
+	return NULL;
+}
+
+bool AGAGridActor::RefreshDataFromNav()
+{
+	return RefreshDataFromNavInternal(bUseGridSnapshot);
+}
+
+bool AGAGridActor::RefreshDataFromNavInternal(bool bAllowSnapshot)
+{
+	bool Result = false;
+	const ARecastNavMesh* NavMesh = GetNavMesh();
+	if (NavMesh)
+	{
+		// Supersede any async build that's still running
+		BuildSerial++;
+		bAsyncBuildInProgress = false;
+
+		TArray<FGANavTilePolys> Tiles;
+		GatherNavTiles(NavMesh, Tiles);
+		RecordNavTiles(Tiles);
+
+		if (!bAllowSnapshot || !LoadGridSnapshot())
+		{
+			// Allocate the array and set to 0
+			ResetData();
+
+			HeightQuantizer = FGAGridHeightQuantizer::FromTiles(Tiles);
+			FGAPolyRasterizer::RasterizeTiles(Tiles, GetGridRect(), CellScale, XCount, bUseLegacyRasterizer, false, GetData(), CellHeights.GetData(), HeightQuantizer);
+			NotifyCellsChanged(GetGridRect());
+		}
+		Result = true;
+
+		OnGridDataReady.Broadcast(this, Result);
+	}
+
+	return Result;
+}
+
+bool AGAGridActor::RefreshDataFromNavAsync()
+{
+	const ARecastNavMesh* NavMesh = GetNavMesh();
+	if (NavMesh == NULL)
+	{
+		return false;
+	}
+
+	TSharedRef<TArray<FGANavTilePolys>> Tiles = MakeShared<TArray<FGANavTilePolys>>();
+	GatherNavTiles(NavMesh, *Tiles);
+	RecordNavTiles(*Tiles);
+
+	BuildSerial++;
+
+	// Nothing to build if there's a good snapshot
+	if (bUseGridSnapshot && LoadGridSnapshot())
+	{
+		bAsyncBuildInProgress = false;
+		OnGridDataReady.Broadcast(this, true);
+		return true;
+	}
+
+	bAsyncBuildInProgress = true;
+
+	// Everything the workers need is copied into the task, they never touch the actor
+	TWeakObjectPtr<AGAGridActor> WeakGrid(this);
+	const int32 Serial = BuildSerial;
+	const int32 CellCount = GetCellCount();
+	const FIntRect GridRect = GetGridRect();
+	const int32 BuildXCount = XCount;
+	const int32 BuildYCount = YCount;
+	const float BuildCellScale = CellScale;
+	const bool bLegacy = bUseLegacyRasterizer;
+	const FGAGridHeightQuantizer Quantizer = FGAGridHeightQuantizer::FromTiles(*Tiles);
+
+	Async(EAsyncExecution::ThreadPool, [WeakGrid, Tiles, Serial, CellCount, GridRect, BuildXCount, BuildYCount, BuildCellScale, bLegacy, Quantizer]()
+	{
+		TArray<ECellData> NewData;
+		TArray<uint16> NewHeights;
+		NewData.SetNumZeroed(CellCount);
+		NewHeights.Init(FGAGridHeightQuantizer::NoHeight, CellCount);
+		FGAPolyRasterizer::RasterizeTiles(*Tiles, GridRect, BuildCellScale, BuildXCount, bLegacy, true, NewData.GetData(), NewHeights.GetData(), Quantizer);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakGrid, Serial, BuildXCount, BuildYCount, Quantizer, NewData = MoveTemp(NewData), NewHeights = MoveTemp(NewHeights)]() mutable
+		{
+			AGAGridActor* Grid = WeakGrid.Get();
+			if (Grid && (Grid->BuildSerial == Serial))
+			{
+				Grid->FinishAsyncBuild(BuildXCount, BuildYCount, MoveTemp(NewData), MoveTemp(NewHeights), Quantizer);
+			}
+		});
+	});
+
+	return true;
+}
+
+void AGAGridActor::FinishAsyncBuild(int32 BuildXCount, int32 BuildYCount, TArray<ECellData>&& NewData, TArray<uint16>&& NewHeights, const FGAGridHeightQuantizer& Quantizer)
+{
+	check(IsInGameThread());
+
+	bAsyncBuildInProgress = false;
+
+	// The grid could have been resized while we were building. Checking the cell count alone would miss a resize that
+	// keeps it (e.g. 100 x 50 to 50 x 100), which would scramble every row.
+	bool bSuccess = (BuildXCount == XCount) && (BuildYCount == YCount) && (NewData.Num() == GetCellCount());
+	if (bSuccess)
+	{
+		Data = MoveTemp(NewData);
+		CellHeights = MoveTemp(NewHeights);
+		HeightsVersion++;
+		HeightQuantizer = Quantizer;
+		NotifyCellsChanged(GetGridRect());
+	}
+
+	OnGridDataReady.Broadcast(this, bSuccess);
+}
+
+bool AGAGridActor::RefreshDataFromNavIncremental()
+{
+	const ARecastNavMesh* NavMesh = GetNavMesh();
+	if (NavMesh == NULL)
+	{
+		return false;
+	}
+
+	// Anything gathered by a build that's still in flight is already out of date, so start it over
+	if (bAsyncBuildInProgress)
+	{
+		return RefreshDataFromNavAsync();
+	}
+
+	// Without a previous build to diff against, there's nothing to be incremental about. That includes heights that
+	// don't match the grid (never built, or the grid has been resized since), which the dirty rects are written into.
+	if (!IsGridDataReady() || (CellHeights.Num() != GetCellCount()) || (NavTileRecords.Num() == 0))
+	{
+		return RefreshDataFromNav();
+	}
+
+	TArray<FGANavTilePolys> Tiles;
+	GatherNavTiles(NavMesh, Tiles);
+
+	// A tile whose hash we haven't seen before was added or changed, so its new footprint is dirty.
+	// A hash that has disappeared was removed or changed, so its old footprint is dirty too -- the cells it
+	// used to cover might not be covered by anything anymore.
+	TArray<FIntRect> DirtyRects;
+	TSet<uint32> NewHashes;
+	for (const FGANavTilePolys& Tile : Tiles)
+	{
+		NewHashes.Add(Tile.Hash);
+		if (!NavTileRecords.Contains(Tile.Hash))
+		{
+			DirtyRects.Add(Tile.CellRect);
+		}
+	}
+	for (const TPair<uint32, FIntRect>& Record : NavTileRecords)
+	{
+		if (!NewHashes.Contains(Record.Key))
+		{
+			DirtyRects.Add(Record.Value);
+		}
+	}
+
+	RecordNavTiles(Tiles);
+
+	for (const FIntRect& DirtyRect : DirtyRects)
+	{
+		// Clear the rect, then rasterize every tile that overlaps it back in.
+		// Heights keep the existing quantizer, anything outside its range gets clamped.
+		const int32 DirtyWidth = DirtyRect.Max.X - DirtyRect.Min.X + 1;
+		for (int32 Y = DirtyRect.Min.Y; Y <= DirtyRect.Max.Y; Y++)
+		{
+			const int32 RowStart = CellRefToIndex(FCellRef(DirtyRect.Min.X, Y));
+			FMemory::Memzero(GetData() + RowStart, DirtyWidth * sizeof(ECellData));
+			for (int32 X = 0; X < DirtyWidth; X++)
+			{
+				CellHeights[RowStart + X] = FGAGridHeightQuantizer::NoHeight;
+			}
+		}
+
+		FGAPolyRasterizer::RasterizeTiles(Tiles, DirtyRect, CellScale, XCount, bUseLegacyRasterizer, false, GetData(), CellHeights.GetData(), HeightQuantizer);
+		HeightsVersion++;
+		NotifyCellsChanged(DirtyRect);
+	}
+
+	return true;
+}
+
+void AGAGridActor::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	if (bRefreshOnNavChange && (NavData != NULL) && (NavData == GetNavMesh()))
+	{
+		RefreshDataFromNavIncremental();
+	}
+}
+
+void AGAGridActor::RecordNavTiles(const TArray<FGANavTilePolys>& Tiles)
+{
+	NavTileRecords.Reset();
+	TArray<uint32> Hashes;
+	for (const FGANavTilePolys& Tile : Tiles)
+	{
+		NavTileRecords.Add(Tile.Hash, Tile.CellRect);
+		Hashes.Add(Tile.Hash);
+	}
+
+	// Sorted, so the checksum doesn't depend on the order the tiles were gathered in
+	Hashes.Sort();
+	NavChecksum = FCrc::MemCrc32(Hashes.GetData(), Hashes.Num() * Hashes.GetTypeSize());
+}
+
+bool AGAGridActor::IsGridDataReady() const
+{
+	return !bAsyncBuildInProgress && (Data.Num() == XCount * YCount);
+}
+
+int32 AGAGridActor::CompareRasterizers() const
+{
+	const ARecastNavMesh* NavMesh = GetNavMesh();
+	if (NavMesh == NULL)
+	{
+		return INDEX_NONE;
+	}
+
+	TArray<FGANavTilePolys> Tiles;
+	GatherNavTiles(NavMesh, Tiles);
+
+	TArray<ECellData> LegacyData;
+	TArray<ECellData> ScanlineData;
+	LegacyData.SetNumZeroed(XCount * YCount);
+	ScanlineData.SetNumZeroed(XCount * YCount);
+
+	FGAPolyRasterizer::RasterizeTiles(Tiles, GetGridRect(), CellScale, XCount, true, true, LegacyData.GetData());
+	FGAPolyRasterizer::RasterizeTiles(Tiles, GetGridRect(), CellScale, XCount, false, true, ScanlineData.GetData());
+
+	int32 MismatchCount = 0;
+	for (int32 CellIndex = 0; CellIndex < LegacyData.Num(); CellIndex++)
+	{
+		if (LegacyData[CellIndex] != ScanlineData[CellIndex])
+		{
+			// Only spell out the first few, the count tells the rest of the story
+			if (MismatchCount < 16)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("CompareRasterizers: cell (%d, %d) legacy = %d, scanline = %d"),
+					CellIndex % XCount, CellIndex / XCount, int32(LegacyData[CellIndex]), int32(ScanlineData[CellIndex]));
+			}
+			MismatchCount++;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("CompareRasterizers: %d of %d cells differ"), MismatchCount, LegacyData.Num());
+	return MismatchCount;
+}
+
+void AGAGridActor::GatherNavTiles(const ARecastNavMesh* NavMesh, TArray<FGANavTilePolys>& TilesOut) const
+{
+	check(IsInGameThread());
+
+	FTransform ActorTransform = GetActorTransform();
+
+	// Scratch, reused for every tile and poly
+	TArray<FNavPoly> Polys;
+	TArray<FVector> PolyVerts;
+
+	// The cell flags of each of the nav mesh's areas, by area ID
+	TArray<ECellData, TInlineAllocator<64>> AreaFlags;
+	AreaFlags.SetNumZeroed(RECAST_MAX_AREAS);
+	for (int32 AreaID = 0; AreaID < AreaFlags.Num(); AreaID++)
+	{
+		if (const UClass* AreaClass = NavMesh->GetAreaClass(AreaID))
+		{
+			if (const FGANavAreaCellData* AreaData = NavAreaCellData.Find(const_cast<UClass*>(AreaClass)))
+			{
+				AreaFlags[AreaID] = ECellData(AreaData->Flags) & ~ECellData::CellDataTraversable;
+			}
+		}
+	}
+
+	// Code for extracting nav polys taken from here:
+	// https://nerivec.github.io/old-ue4-wiki/pages/ai-navigation-in-c-customize-path-following-every-tick.html
+
+	for (int32 TileIndex = 0; TileIndex < NavMesh->GetNavMeshTilesCount(); TileIndex++)
+	{
+		const FBox TileBounds = NavMesh->GetNavMeshTileBounds(TileIndex);
+		if (TileBounds.IsValid)			// reportedly will crash if this is not checked
+		{
+			Polys.Reset();
+
+			if (NavMesh->GetPolysInTile(TileIndex, Polys) && (Polys.Num() > 0))
+			{
+				FGANavTilePolys Tile;
+				FBox2D TileGridBounds(EForceInit::ForceInit);
+
+				for (const FNavPoly& NavPoly : Polys)
+				{
+					PolyVerts.Reset();
+					NavMesh->GetPolyVerts(NavPoly.Ref, PolyVerts);
+
+					uint8 AreaID = 0;
+					const bool bHasArea = NavMesh->GetPolyAreaID(NavPoly.Ref, AreaID) && AreaFlags.IsValidIndex(AreaID);
+					Tile.PolyFlags.Add(bHasArea ? AreaFlags[AreaID] : ECellData::CellDataNone);
+
+					// transform verts to grid space
+					for (const FVector& Vert : PolyVerts)
+					{
+						const FVector LocalVert = ActorTransform.InverseTransformPosition(Vert);
+						FVector2D GridVert = FVector2D(LocalVert) + HalfExtents;
+						Tile.Verts.Add(GridVert);
+						Tile.VertHeights.Add(LocalVert.Z);
+						TileGridBounds += GridVert;
+					}
+					Tile.PolyVertCounts.Add(PolyVerts.Num());
+				}
+				Tile.RefreshHash();
+
+				// Every cell whose center lies within the bounds of the verts, clipped to the grid
+				Tile.CellRect.Min.X = FMath::Max(FMath::CeilToInt32(TileGridBounds.Min.X / CellScale - 0.5f), 0);
+				Tile.CellRect.Min.Y = FMath::Max(FMath::CeilToInt32(TileGridBounds.Min.Y / CellScale - 0.5f), 0);
+				Tile.CellRect.Max.X = FMath::Min(FMath::FloorToInt32(TileGridBounds.Max.X / CellScale - 0.5f), XCount - 1);
+				Tile.CellRect.Max.Y = FMath::Min(FMath::FloorToInt32(TileGridBounds.Max.Y / CellScale - 0.5f), YCount - 1);
+
+				if ((Tile.CellRect.Min.X <= Tile.CellRect.Max.X) && (Tile.CellRect.Min.Y <= Tile.CellRect.Max.Y))
+				{
+					TilesOut.Add(MoveTemp(Tile));
+				}
+			}
+		}
+	}
+}
+
+
+// Snapshots --------------------------------
+
+FString AGAGridActor::GetGridSnapshotPath() const
+{
+	FString MapName = TEXT("NoMap");
+	if (const UWorld* World = GetWorld())
+	{
+		MapName = UWorld::RemovePIEPrefix(World->GetMapName());
+	}
+	return FPaths::ProjectContentDir() / TEXT("GridSnapshots") / FString::Printf(TEXT("%s_%s.gagrid"), *MapName, *GetName());
+}
+
+bool AGAGridActor::BakeGridSnapshot()
+{
+	if (!RefreshDataFromNavInternal(false))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BakeGridSnapshot: no nav mesh to build %s from"), *GetName());
+		return false;
+	}
+
+	if (bBakeVisibility)
+	{
+		if (Stamps.Num() > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("BakeGridSnapshot: %s has stamps down, so the visibility table can't be saved with it"), *GetName());
+		}
+		BakeVisibilityTable();
+	}
+
+	bool Result = SaveGridSnapshot();
+	UE_LOG(LogTemp, Log, TEXT("BakeGridSnapshot: %s %s"), Result ? TEXT("saved") : TEXT("failed to save"), *GetGridSnapshotPath());
+	return Result;
+}
+
+bool AGAGridActor::SaveGridSnapshot() const
+{
+	if (Data.Num() != XCount * YCount)
+	{
+		return false;
+	}
+
+	FGAGridSnapshotInfo Info;
+	Info.XCount = XCount;
+	Info.YCount = YCount;
+	Info.CellScale = CellScale;
+	Info.Transform = GetActorTransform();
+	Info.NavChecksum = NavChecksum;
+
+	FGAGridSnapshotWriter Writer;
+	Writer.AddInfo(Info);
+	Writer.AddSection(GAGridSnapshot::CellDataSection, Data.GetData(), Data.Num() * Data.GetTypeSize());
+
+	if (CellHeights.Num() == Data.Num())
+	{
+		FGAGridSnapshotHeights HeightsHeader;
+		HeightsHeader.Offset = HeightQuantizer.Offset;
+		HeightsHeader.Step = HeightQuantizer.Step;
+		HeightsHeader.CellCount = CellHeights.Num();
+		HeightsHeader.Reserved = 0;
+
+		TArray<uint8> HeightBytes;
+		HeightBytes.Append(reinterpret_cast<const uint8*>(&HeightsHeader), sizeof(HeightsHeader));
+		HeightBytes.Append(reinterpret_cast<const uint8*>(CellHeights.GetData()), CellHeights.Num() * CellHeights.GetTypeSize());
+		Writer.AddSection(GAGridSnapshot::HeightsSection, HeightBytes.GetData(), HeightBytes.Num());
+	}
+
+	// Only a table baked from exactly the traversability in Data can go with it. Stamps change that without touching
+	// Data, so none can be down now, and the bits can't have changed since the bake.
+	if (HasVisibilityTable() && (VisibilityTableVersion == TraversableVersion) && (Stamps.Num() == 0))
+	{
+		TArray<uint8> VisibilityBytes;
+		VisibilityTable.Encode(VisibilityBytes);
+		Writer.AddSection(GAGridSnapshot::VisibilitySection, VisibilityBytes.GetData(), VisibilityBytes.Num());
+	}
+	return Writer.SaveToFile(GetGridSnapshotPath());
+}
+
+bool AGAGridActor::LoadGridSnapshot()
+{
+	const FString Path = GetGridSnapshotPath();
+
+	FGAGridSnapshotReader Reader;
+	if (!Reader.Open(Path))
+	{
+		return false;
+	}
+
+	FGAGridSnapshotInfo Info;
+	if (!Reader.ReadInfo(Info))
+	{
+		return false;
+	}
+
+	const bool bMatches = (Info.XCount == XCount) && (Info.YCount == YCount) && (Info.CellScale == CellScale)
+		&& Info.Transform.Equals(GetActorTransform()) && (Info.NavChecksum == NavChecksum);
+	if (!bMatches)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Grid snapshot %s is out of date, rebuilding from nav. Bake it again to speed up startup."), *Path);
+		return false;
+	}
+
+	TConstArrayView<uint8> Cells = Reader.FindSection(GAGridSnapshot::CellDataSection);
+	if (Cells.Num() != GetCellCount() * int32(sizeof(ECellData)))
+	{
+		return false;
+	}
+
+	// Snapshots baked before heights existed are treated as stale
+	TConstArrayView<uint8> Heights = Reader.FindSection(GAGridSnapshot::HeightsSection);
+	FGAGridSnapshotHeights HeightsHeader;
+	if (Heights.Num() != int32(sizeof(FGAGridSnapshotHeights)) + GetCellCount() * int32(sizeof(uint16)))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Grid snapshot %s has no ground heights, rebuilding from nav. Bake it again to speed up startup."), *Path);
+		return false;
+	}
+	FMemory::Memcpy(&HeightsHeader, Heights.GetData(), sizeof(HeightsHeader));
+
+	// Data is a UPROPERTY TArray, which can't point at memory it doesn't own, so this is one straight copy out of the mapping
+	Data.SetNumUninitialized(GetCellCount());
+	FMemory::Memcpy(GetData(), Cells.GetData(), Cells.Num());
+
+	HeightQuantizer.Offset = HeightsHeader.Offset;
+	HeightQuantizer.Step = HeightsHeader.Step;
+	CellHeights.SetNumUninitialized(GetCellCount());
+	FMemory::Memcpy(CellHeights.GetData(), Heights.GetData() + sizeof(FGAGridSnapshotHeights), GetCellCount() * sizeof(uint16));
+	HeightsVersion++;
+
+	// Refreshing the bits drops any table that was baked against the old ones, so the new table goes in afterwards
+	NotifyCellsChanged(GetGridRect());
+
+	// The visibility table is optional, a snapshot without one just means traces for everything. It only sampled the
+	// cells traversable in the saved Data, which stamps could add to.
+	TConstArrayView<uint8> Visibility = Reader.FindSection(GAGridSnapshot::VisibilitySection);
+	if ((Visibility.Num() > 0) && (Stamps.Num() == 0))
+	{
+		if (VisibilityTable.Decode(Visibility, XCount, YCount))
+		{
+			VisibilityTableVersion = TraversableVersion;
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Grid snapshot %s has a bad visibility table, ignoring it"), *Path);
+		}
+	}
+	return true;
+}
+
+
+// Baked visibility --------------------------------
+
+
+bool AGAGridActor::BakeVisibilityTable()
+{
+	UWorld* World = GetWorld();
+	if ((World == NULL) || (Data.Num() != GetCellCount()) || (GetCellCount() == 0))
+	{
+		return false;
+	}
+
+	FGAGridVisibilityTable NewTable;
+	NewTable.Init(XCount, YCount, VisibilityBlockSize);
+	const int32 BlockCount = NewTable.GetBlockCount();
+
+	// Every traversable cell of a block is a sample, so a block is only hidden from another if no pair of their cells can
+	// see each other. Blocks with no traversable cells get no samples, and can't see or be seen.
+	const FVector Up = GetActorTransform().GetUnitAxis(EAxis::Z);
+	TArray<TArray<FVector>> BlockSamples;
+	BlockSamples.SetNum(BlockCount);
+
+	for (int32 BlockIndex = 0; BlockIndex < BlockCount; BlockIndex++)
+	{
+		const FIntRect Rect = NewTable.GetBlockCellRect(BlockIndex);
+		for (int32 Y = Rect.Min.Y; Y <= Rect.Max.Y; Y++)
+		{
+			for (int32 X = Rect.Min.X; X <= Rect.Max.X; X++)
+			{
+				if (TraversableBits.Get(X, Y))
+				{
+					BlockSamples[BlockIndex].Add(GetCellPosition(FCellRef(X, Y)) + Up * VisibilityEyeHeight);
+				}
+			}
+		}
+	}
+
+	// Trace the channel the runtime line of sight checks use, so the table can't hide anything they would see. Only
+	// static geometry goes into the table though: anything movable that blocks is ignored from then on, since it has to
+	// be traced at runtime anyway. This runs on the game thread, it's an editor bake and doesn't need to be quick.
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(GAGridVisibility), false, this);
+	auto IsClear = [World, &Params](const FVector& Start, const FVector& End)
+	{
+		FHitResult Hit;
+		while (World->LineTraceSingleByChannel(Hit, Start, End, ECollisionChannel::ECC_Visibility, Params))
+		{
+			const UPrimitiveComponent* Component = Hit.GetComponent();
+			if ((Component == NULL) || (Component->Mobility != EComponentMobility::Movable))
+			{
+				return false;
+			}
+			Params.AddIgnoredComponent(Component);
+		}
+		return true;
+	};
+
+	// Each block tests itself against every later block, and keeps the ones it can see
+	TArray<TArray<int32>> VisibleBlocks;
+	VisibleBlocks.SetNum(BlockCount);
+
+	for (int32 BlockA = 0; BlockA < BlockCount; BlockA++)
+	{
+		const TArray<FVector>& SamplesA = BlockSamples[BlockA];
+		if (SamplesA.Num() == 0)
+		{
+			continue;
+		}
+
+		VisibleBlocks[BlockA].Add(BlockA);
+
+		for (int32 BlockB = BlockA + 1; BlockB < BlockCount; BlockB++)
+		{
+			bool bVisible = false;
+			for (int32 IndexA = 0; (IndexA < SamplesA.Num()) && !bVisible; IndexA++)
+			{
+				for (const FVector& SampleB : BlockSamples[BlockB])
+				{
+					if (IsClear(SamplesA[IndexA], SampleB))
+					{
+						bVisible = true;
+						break;
+					}
+				}
+			}
+
+			if (bVisible)
+			{
+				VisibleBlocks[BlockA].Add(BlockB);
+			}
+		}
+	}
+
+	int32 VisiblePairCount = 0;
+	for (int32 BlockA = 0; BlockA < BlockCount; BlockA++)
+	{
+		for (int32 BlockB : VisibleBlocks[BlockA])
+		{
+			NewTable.SetVisible(BlockA, BlockB);
+		}
+		VisiblePairCount += VisibleBlocks[BlockA].Num();
+	}
+
+	VisibilityTable = MoveTemp(NewTable);
+	VisibilityTableVersion = TraversableVersion;
+	UE_LOG(LogTemp, Log, TEXT("BakeVisibilityTable: %s has %d blocks, %d visible pairs"), *GetName(), BlockCount, VisiblePairCount);
+	return true;
+}
+
+bool AGAGridActor::IsCellPotentiallyVisible(const FCellRef& From, const FCellRef& To) const
+{
+	// The table only knows about traversable cells, anything else has to be traced
+	if (!HasVisibilityTable() || !IsCellTraversable(From) || !IsCellTraversable(To))
+	{
+		return true;
+	}
+	return VisibilityTable.IsVisible(From.X, From.Y, To.X, To.Y);
+}
+
+bool AGAGridActor::IsAnyCellPotentiallyVisibleInSpan(const FCellRef& From, int32 Y, int32 MinX, int32 MaxX) const
+{
+	if (!HasVisibilityTable() || !IsCellTraversable(From))
+	{
+		return true;
+	}
+	return VisibilityTable.IsAnyVisibleInSpan(From.X, From.Y, Y, MinX, MaxX);
+}
+
+
+// Versioning --------------------------------
+
+uint32 AGAGridActor::GetRegionVersion(const FCellRef& CellRef) const
+{
+	int32 RegionX = FMath::Clamp(CellRef.X / RegionSize, 0, RegionXCount - 1);
+	int32 RegionY = FMath::Clamp(CellRef.Y / RegionSize, 0, RegionYCount - 1);
+	return RegionVersions[RegionY * RegionXCount + RegionX];
+}
+
+uint32 AGAGridActor::GetRectVersion(const FIntRect& CellRect) const
+{
+	uint32 Result = 0;
+	FIntRect Clipped;
+	if (FGAPolyRasterizer::IntersectCellRects(CellRect, GetGridRect(), Clipped))
+	{
+		for (int32 RegionY = Clipped.Min.Y / RegionSize; RegionY <= Clipped.Max.Y / RegionSize; RegionY++)
+		{
+			for (int32 RegionX = Clipped.Min.X / RegionSize; RegionX <= Clipped.Max.X / RegionSize; RegionX++)
+			{
+				Result = FMath::Max(Result, RegionVersions[RegionY * RegionXCount + RegionX]);
+			}
+		}
+	}
+	return Result;
+}
+
+void AGAGridActor::NotifyCellsChanged(const FIntRect& CellRect)
+{
+	FIntRect Clipped;
+	if (!FGAPolyRasterizer::IntersectCellRects(CellRect, GetGridRect(), Clipped))
+	{
+		return;
+	}
+
+	RefreshDerivedData(Clipped);
+
+	GridVersion++;
+
+	for (int32 RegionY = Clipped.Min.Y / RegionSize; RegionY <= Clipped.Max.Y / RegionSize; RegionY++)
+	{
+		for (int32 RegionX = Clipped.Min.X / RegionSize; RegionX <= Clipped.Max.X / RegionSize; RegionX++)
+		{
+			RegionVersions[RegionY * RegionXCount + RegionX] = GridVersion;
+		}
+	}
+
+	OnCellsChanged.Broadcast(Clipped, GridVersion);
+}
+
+
+void AGAGridActor::RefreshDerivedData(const FIntRect& CellRect)
+{
+	const bool bHasData = (Data.Num() == XCount * YCount);
+
+	// A resize invalidates everything
+	FIntRect Rect = CellRect;
+	const bool bResized = (TraversableBits.GetXCount() != XCount) || (TraversableBits.GetYCount() != YCount) || !bHasData;
+	if (bResized)
+	{
+		TraversableBits.Init(XCount, YCount);
+		for (FGAGridBitPlane& Bits : FlagBits)
+		{
+			Bits.Init(XCount, YCount);
+		}
+		Rect = GetGridRect();
+	}
+
+	// Stamps were rasterized against the old dimensions, so they can't survive a resize
+	if ((Stamps.Num() > 0 || StampBlockCounts.Num() > 0) && !HasStampCounts())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s was resized, dropping its %d stamps"), *GetName(), Stamps.Num());
+		Stamps.Empty();
+		StampBlockCounts.Empty();
+		for (TArray<uint16>& Counts : StampFlagCounts)
+		{
+			Counts.Empty();
+		}
+	}
+	const bool bStamps = HasStampCounts();
+
+	// The cost of every combination of flags, so costing a cell is a lookup
+	uint8 CostByFlags[1 << CellDataChannelCount];
+	for (int32 Flags = 0; Flags < int32(UE_ARRAY_COUNT(CostByFlags)); Flags++)
+	{
+		int32 Cost = 1;
+		for (const TPair<ECellData, uint8>& FlagCost : CellFlagCosts)
+		{
+			if ((Flags & int32(FlagCost.Key)) != 0)
+			{
+				Cost = FMath::Max(Cost, int32(FlagCost.Value));
+			}
+		}
+		CostByFlags[Flags] = uint8(Cost);
+	}
+
+	const bool bCosts = bBuildCostField && bHasData;
+	if (!bCosts)
+	{
+		CellCosts.Empty();
+	}
+	else if (CellCosts.Num() != GetCellCount())
+	{
+		CellCosts.SetNumUninitialized(GetCellCount());
+		Rect = GetGridRect();
+	}
+
+	bool bTraversableChanged = bResized;
+	if (bHasData)
+	{
+		for (int32 Y = Rect.Min.Y; Y <= Rect.Max.Y; Y++)
+		{
+			const int32 RowStart = CellRefToIndex(FCellRef(0, Y));
+			const ECellData* Row = Data.GetData() + RowStart;
+			for (int32 X = Rect.Min.X; X <= Rect.Max.X; X++)
+			{
+				const uint8 Flags = uint8(bStamps ? ApplyStampsToCell(RowStart + X, Row[X]) : Row[X]);
+				const bool bTraversable = (Flags & 1) != 0;
+				bTraversableChanged |= (TraversableBits.Get(X, Y) != bTraversable);
+				TraversableBits.Set(X, Y, bTraversable);
+				for (int32 Channel = 1; Channel < CellDataChannelCount; Channel++)
+				{
+					FlagBits[Channel - 1].Set(X, Y, ((Flags >> Channel) & 1) != 0);
+				}
+
+				if (bCosts)
+				{
+					CellCosts[RowStart + X] = CostByFlags[Flags & ((1 << CellDataChannelCount) - 1)];
+				}
+			}
+		}
+	}
+
+	// The visibility table only sampled the cells that were traversable when it was baked
+	if (bTraversableChanged)
+	{
+		TraversableVersion++;
+		VisibilityTable.Reset();
+	}
+
+	// The rest is built from the bits, so it has to come after them
+	if (bResized)
+	{
+		TraversablePyramid.Build(TraversableBits);
+		ClearanceField.Build(TraversableBits);
+	}
+	else
+	{
+		TraversablePyramid.Refresh(TraversableBits, Rect);
+		ClearanceField.Refresh(TraversableBits, Rect);
+	}
+
+	// Edits that leave traversability alone cost nothing here, and new cells that only grow a region are labelled in
+	// place. Anything that might join or split regions gets a full pass over the runs.
+	if (bResized)
+	{
+		RegionLabels.Build(TraversableBits);
+	}
+	else
+	{
+		RegionLabels.Refresh(TraversableBits, Rect);
+	}
+}
+
+
+// Line traversal --------------------------------
+
+
+FVector2D AGAGridActor::GetCellSpacePosition(const FVector& Point, const FTransform& GridTransform) const
+{
+	const FVector LocalPoint = GridTransform.InverseTransformPosition(Point);
+	return (FVector2D(LocalPoint) + HalfExtents) / CellScale;
+}
+
+bool AGAGridActor::IsCellSpaceLineTraversable(const FVector2D& Start, const FVector2D& End, FCellRef* BlockedCellOut) const
+{
+	FCellRef BlockedCell = FCellRef::Invalid;
+
+	const bool bClear = FGAGridLineWalk::Walk(Start, End, [this, &BlockedCell](int32 X, int32 Y)
+	{
+		if (TraversableBits.IsValidCell(X, Y) && TraversableBits.Get(X, Y))
+		{
+			return true;
+		}
+		BlockedCell = FCellRef(X, Y);
+		return false;
+	});
+
+	if (BlockedCellOut)
+	{
+		*BlockedCellOut = BlockedCell;
+	}
+	return bClear;
+}
+
+bool AGAGridActor::IsLineTraversable(const FVector& Start, const FVector& End, FCellRef& BlockedCellOut) const
+{
+	const FTransform& GridTransform = GetActorTransform();
+	return IsCellSpaceLineTraversable(GetCellSpacePosition(Start, GridTransform), GetCellSpacePosition(End, GridTransform), &BlockedCellOut);
+}
+
+void AGAGridActor::AreLinesTraversable(const FVector& Start, TConstArrayView<FVector> Ends, TArrayView<bool> ClearOut) const
+{
+	check(ClearOut.Num() >= Ends.Num());
+
+	const FTransform& GridTransform = GetActorTransform();
+	const FVector2D CellStart = GetCellSpacePosition(Start, GridTransform);
+
+	for (int32 Index = 0; Index < Ends.Num(); Index++)
+	{
+		ClearOut[Index] = IsCellSpaceLineTraversable(CellStart, GetCellSpacePosition(Ends[Index], GridTransform));
+	}
+}
+
+int32 AGAGridActor::FindFirstBlockedLine(const FVector& Start, TConstArrayView<FVector> Ends) const
+{
+	const FTransform& GridTransform = GetActorTransform();
+	const FVector2D CellStart = GetCellSpacePosition(Start, GridTransform);
+
+	for (int32 Index = 0; Index < Ends.Num(); Index++)
+	{
+		if (!IsCellSpaceLineTraversable(CellStart, GetCellSpacePosition(Ends[Index], GridTransform)))
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
 
+
+// Dynamic stamps --------------------------------
+
+
+int32 AGAGridActor::StampBox(const FVector& Center, const FVector2D& HalfSize, float Yaw, ECellData Flags, bool bBlock)
+{
+	const FQuat Rotation(FVector::UpVector, FMath::DegreesToRadians(Yaw));
+
+	TArray<FVector> Corners;
+	Corners.Add(Center + Rotation.RotateVector(FVector(-HalfSize.X, -HalfSize.Y, 0.0f)));
+	Corners.Add(Center + Rotation.RotateVector(FVector(HalfSize.X, -HalfSize.Y, 0.0f)));
+	Corners.Add(Center + Rotation.RotateVector(FVector(HalfSize.X, HalfSize.Y, 0.0f)));
+	Corners.Add(Center + Rotation.RotateVector(FVector(-HalfSize.X, HalfSize.Y, 0.0f)));
+	return StampPolygon(Corners, Flags, bBlock);
 }
 
-void AGAGridActor::PostLoad()
+int32 AGAGridActor::StampCircle(const FVector& Center, float Radius, ECellData Flags, bool bBlock)
 {
-#if WITH_EDITORONLY_DATA
-	RefreshBoxComponent();
-#endif //WITH_EDITORONLY_DATA
+	const FTransform& GridTransform = GetActorTransform();
+	const FVector2D GridCenter = FVector2D(GridTransform.InverseTransformPosition(Center)) + HalfExtents;
+	const float GridRadius = Radius / FMath::Max(GridTransform.GetScale3D().X, UE_KINDA_SMALL_NUMBER);
+
+	FGAGridStamp Stamp;
+	Stamp.Flags = Flags;
+	Stamp.bBlock = bBlock;
+
+	// Row by row, the cells whose centers are within the radius
+	const int32 MinY = FMath::Max(FMath::CeilToInt32((GridCenter.Y - GridRadius) / CellScale - 0.5f), 0);
+	const int32 MaxY = FMath::Min(FMath::FloorToInt32((GridCenter.Y + GridRadius) / CellScale - 0.5f), YCount - 1);
+	for (int32 Y = MinY; Y <= MaxY; Y++)
+	{
+		const float DY = (float(Y) + 0.5f) * CellScale - GridCenter.Y;
+		const float HalfWidth = FMath::Sqrt(FMath::Max(FMath::Square(GridRadius) - FMath::Square(DY), 0.0f));
+		const int32 MinX = FMath::Max(FMath::CeilToInt32((GridCenter.X - HalfWidth) / CellScale - 0.5f), 0);
+		const int32 MaxX = FMath::Min(FMath::FloorToInt32((GridCenter.X + HalfWidth) / CellScale - 0.5f), XCount - 1);
+		if (MinX <= MaxX)
+		{
+			Stamp.Spans.Add(FIntVector(Y, MinX, MaxX));
+		}
+	}
 
-	RefreshDerivedValues();
-	Super::PostLoad();
+	return AddStamp(MoveTemp(Stamp));
 }
 
-
-#if WITH_EDITORONLY_DATA
-void AGAGridActor::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+int32 AGAGridActor::StampPolygon(const TArray<FVector>& Points, ECellData Flags, bool bBlock)
 {
-	FName ChangedPropertyName = PropertyChangedEvent.GetMemberPropertyName();
+	const FTransform& GridTransform = GetActorTransform();
 
-	// If the width, height or scale change, refresh the scale of the BoxComponent
-	if ((ChangedPropertyName == FName("XCount")) || (ChangedPropertyName == FName("YCount")) || (ChangedPropertyName == FName("CellScale")))
+	TArray<FVector2D, TInlineAllocator<8>> Verts;
+	for (const FVector& Point : Points)
 	{
-		RefreshBoxComponent();
+		Verts.Add(FVector2D(GridTransform.InverseTransformPosition(Point)) + HalfExtents);
 	}
 
-	RefreshDerivedValues();
+	FGAGridStamp Stamp;
+	Stamp.Flags = Flags;
+	Stamp.bBlock = bBlock;
 
-	Super::PostEditChangeProperty(PropertyChangedEvent);
+	FGAPolyRasterizer Rasterizer(CellScale);
+	Rasterizer.RasterizeScanline(Verts, GetGridRect(), [&Stamp](int32 Y, int32 MinX, int32 MaxX)
+	{
+		Stamp.Spans.Add(FIntVector(Y, MinX, MaxX));
+	});
+
+	return AddStamp(MoveTemp(Stamp));
 }
 
-void AGAGridActor::RefreshBoxComponent()
+int32 AGAGridActor::AddStamp(FGAGridStamp&& Stamp)
 {
-	FVector DesiredExtents;
+	if ((Stamp.Spans.Num() == 0) || (Data.Num() != GetCellCount()))
+	{
+		return INDEX_NONE;
+	}
 
-	DesiredExtents.X = 0.5f * float(XCount) * CellScale;
-	DesiredExtents.Y = 0.5f * float(YCount) * CellScale;
-	DesiredExtents.Z = 10.0f;
+	Stamp.Bounds = FIntRect(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+	for (const FIntVector& Span : Stamp.Spans)
+	{
+		Stamp.Bounds.Include(FIntPoint(Span.Y, Span.X));
+		Stamp.Bounds.Include(FIntPoint(Span.Z, Span.X));
+	}
 
-	BoxComponent->SetBoxExtent(DesiredExtents);
+	if (!HasStampCounts())
+	{
+		StampBlockCounts.SetNumZeroed(GetCellCount());
+		for (TArray<uint16>& Counts : StampFlagCounts)
+		{
+			Counts.SetNumZeroed(GetCellCount());
+		}
+	}
+
+	const int32 Handle = NextStampHandle++;
+	const FGAGridStamp& Added = Stamps.Add(Handle, MoveTemp(Stamp));
+	ApplyStamp(Added, 1);
+	return Handle;
 }
 
-#endif // WITH_EDITORONLY_DATA
+bool AGAGridActor::RemoveStamp(int32 StampHandle)
+{
+	FGAGridStamp Stamp;
+	if (!Stamps.RemoveAndCopyValue(StampHandle, Stamp))
+	{
+		return false;
+	}
 
+	if (HasStampCounts())
+	{
+		ApplyStamp(Stamp, -1);
+	}
+	return true;
+}
 
-void AGAGridActor::RefreshDerivedValues()
+void AGAGridActor::ApplyStamp(const FGAGridStamp& Stamp, int32 Delta)
 {
-	// Refresh HalfExtents
-	HalfExtents.X = 0.5f * CellScale * float(XCount);
-	HalfExtents.Y = 0.5f * CellScale * float(YCount);
+	const uint8 Flags = uint8(Stamp.Flags);
+
+	for (const FIntVector& Span : Stamp.Spans)
+	{
+		const int32 RowStart = CellRefToIndex(FCellRef(0, Span.X));
+		for (int32 CellIndex = RowStart + Span.Y; CellIndex <= RowStart + Span.Z; CellIndex++)
+		{
+			if (Stamp.bBlock)
+			{
+				StampBlockCounts[CellIndex] = uint16(StampBlockCounts[CellIndex] + Delta);
+			}
+			for (int32 Channel = 0; Channel < CellDataChannelCount; Channel++)
+			{
+				if ((Flags >> Channel) & 1)
+				{
+					StampFlagCounts[Channel][CellIndex] = uint16(StampFlagCounts[Channel][CellIndex] + Delta);
+				}
+			}
+		}
+	}
+
+	NotifyCellsChanged(Stamp.Bounds);
 }
 
 
-bool AGAGridActor::ResetData()
+// Cell flags and costs --------------------------------
+
+
+const FGAGridBitPlane& AGAGridActor::GetFlagBits(ECellData Flag) const
 {
-	bool Result = false;
-	Data.SetNum(GetCellCount());
+	const uint32 FlagBit = uint32(Flag);
+	check(FMath::IsPowerOfTwo(FlagBit) && (FlagBit < (1u << CellDataChannelCount)));
 
-	ECellData* GridData = GetData();
-	if (GridData)
+	const int32 Channel = int32(FMath::CountTrailingZeros(FlagBit));
+	return (Channel == 0) ? TraversableBits : FlagBits[Channel - 1];
+}
+
+int32 AGAGridActor::GetCellCost(const FCellRef& CellRef) const
+{
+	if ((CellRef.X < 0) || (CellRef.X >= XCount) || (CellRef.Y < 0) || (CellRef.Y >= YCount))
 	{
-		memset(GridData, 0, GetCellCount() * sizeof(ECellData));
+		return 0;
 	}
-
-	return Result;
+	return HasCostField() ? int32(CellCosts[CellRefToIndex(CellRef)]) : 1;
 }
 
-// Return the cell the given point is inside of
-// If bClamp = true, then any point outside of the grid will be clamped to the bounds of the grid
-// Otherwise, if the point is outside the grid, it will return FCellRef::Invalid
 
-FCellRef AGAGridActor::GetCellRef(const FVector& Point, bool bClamp) const
-{
-	// First, transform the point into grid-local space
-	// note, we drop the Z dimension at this point, by casting to a FVector2D
-	FTransform GridTransform = GetActorTransform();
-	FVector2D LocalPoint = FVector2D(GridTransform.InverseTransformPosition(Point));
+// Clearance --------------------------------
 
-	if (bClamp)
+
+float AGAGridActor::GetCellClearance(const FCellRef& CellRef) const
+{
+	if (!TraversableBits.IsValidCell(CellRef.X, CellRef.Y) || !ClearanceField.IsBuilt(TraversableBits))
 	{
-		LocalPoint.X = FMath::Clamp(LocalPoint.X, -HalfExtents.X, HalfExtents.X);
-		LocalPoint.Y = FMath::Clamp(LocalPoint.Y, -HalfExtents.Y, HalfExtents.Y);
+		return 0.0f;
 	}
-	else if (FMath::Abs(LocalPoint.X) > HalfExtents.X || FMath::Abs(LocalPoint.Y) > HalfExtents.Y)
+
+	// The field is center to center, the blocker's near edge is half a cell closer
+	const float Distance = ClearanceField.GetDistance(CellRef.X, CellRef.Y);
+	return FMath::Max(Distance - 0.5f, 0.0f) * CellScale;
+}
+
+bool AGAGridActor::HasClearance(const FCellRef& CellRef, float Radius) const
+{
+	if (Radius <= 0.0f)
 	{
-		return FCellRef::Invalid;
+		return IsCellTraversable(CellRef);
 	}
+	return IsCellTraversable(CellRef) && (GetCellClearance(CellRef) >= FMath::Min(Radius, GetMaxClearance()));
+}
 
-	LocalPoint += HalfExtents;		// Now LocalPoint is relative the to the (0, 0) corner of grid
 
-	// Discretize by dividing by scale and flooring
-	// Out of an abundance of caution we also clamp the result to a valid index, to avoid any floating-point issues
+// Regions --------------------------------
 
-	FCellRef Result(
-		FMath::Clamp(FMath::FloorToInt32(LocalPoint.X / CellScale), 0, XCount - 1),
-		FMath::Clamp(FMath::FloorToInt32(LocalPoint.Y / CellScale), 0, YCount - 1)
-	);
-	return Result;
-}
 
-FVector AGAGridActor::GetCellPosition(const FCellRef& CellRef) const
+int32 AGAGridActor::GetCellRegion(const FCellRef& CellRef) const
 {
-	float HalfScale = 0.5f * CellScale;
-
-	// Grab the center of the cell, then offset by -HalfExtents, so that it is relative to the center of the grid
-	FVector LocalResult;
-	LocalResult.X = CellRef.X * CellScale + HalfScale - HalfExtents.X;
-	LocalResult.Y = CellRef.Y * CellScale + HalfScale - HalfExtents.Y;
-	LocalResult.Z = 0.0f;
+	if (!TraversableBits.IsValidCell(CellRef.X, CellRef.Y) || !RegionLabels.IsBuilt(TraversableBits))
+	{
+		return INDEX_NONE;
+	}
+	return RegionLabels.GetLabel(CellRef.X, CellRef.Y);
+}
 
-	FTransform ActorTransform = GetActorTransform();
-	FVector Result = ActorTransform.TransformPosition(LocalResult);
-	return Result;
+bool AGAGridActor::AreCellsConnected(const FCellRef& CellRefA, const FCellRef& CellRefB) const
+{
+	const int32 Region = GetCellRegion(CellRefA);
+	return (Region != INDEX_NONE) && (Region == GetCellRegion(CellRefB));
 }
 
-FVector2D AGAGridActor::GetCellGridSpacePosition(const FCellRef& CellRef) const
+FCellRef AGAGridActor::FindNearestCellInRegion(const FCellRef& CellRef, int32 Region, int32 MaxCellDistance) const
 {
-	float HalfScale = 0.5f * CellScale;
+	if ((Region == INDEX_NONE) || (RegionLabels.GetRegionSize(Region) == 0))
+	{
+		return FCellRef::Invalid;
+	}
 
-	// Grab the center of the cell, then offset by -HalfExtents, so that it is relative to the center of the grid
-	FVector2D LocalResult;
-	LocalResult.X = CellRef.X * CellScale + HalfScale;
-	LocalResult.Y = CellRef.Y * CellScale + HalfScale;
+	FCellRef Result = FCellRef::Invalid;
+	int32 BestDistanceSq = MAX_int32;
 
-	return LocalResult;
+	// Search square rings of growing size. Once a ring is further out than the best cell found, nothing beyond it can be closer.
+	for (int32 Ring = 0; Ring <= MaxCellDistance; Ring++)
+	{
+		if (Ring * Ring > BestDistanceSq)
+		{
+			break;
+		}
+
+		for (int32 DY = -Ring; DY <= Ring; DY++)
+		{
+			// Only the edge of the ring, the inside has already been searched
+			const int32 Step = ((DY == -Ring) || (DY == Ring)) ? 1 : FMath::Max(2 * Ring, 1);
+			for (int32 DX = -Ring; DX <= Ring; DX += Step)
+			{
+				const FCellRef Candidate(CellRef.X + DX, CellRef.Y + DY);
+				const int32 DistanceSq = DX * DX + DY * DY;
+				if ((DistanceSq < BestDistanceSq) && (GetCellRegion(Candidate) == Region))
+				{
+					Result = Candidate;
+					BestDistanceSq = DistanceSq;
+				}
+			}
+		}
+	}
+
+	return Result;
 }
 
 
+// Traversability pyramid --------------------------------
 
-ECellData AGAGridActor::GetCellData(const FCellRef &CellRef) const
+
+EGACellCoverage AGAGridActor::GetPyramidCoverage(int32 Level, const FCellRef& PyramidCellRef) const
 {
-	int32 CellIndex = CellRefToIndex(CellRef);
-	return Data[CellIndex];
-}
+	if ((Level < 0) || (Level >= TraversablePyramid.GetLevelCount()))
+	{
+		return EGACellCoverage::None;
+	}
 
+	const FIntPoint LevelSize = TraversablePyramid.GetLevelSize(Level);
+	if ((PyramidCellRef.X < 0) || (PyramidCellRef.X >= LevelSize.X) || (PyramidCellRef.Y < 0) || (PyramidCellRef.Y >= LevelSize.Y))
+	{
+		return EGACellCoverage::None;
+	}
 
-bool AGAGridActor::GridSpaceBoundsToRect2D(const FBox2D& Box, FIntRect &RectOut) const
-{
-	float HalfScale = 0.5f * CellScale;
+	return TraversablePyramid.GetCoverage(TraversableBits, Level, PyramidCellRef.X, PyramidCellRef.Y);
+}
 
-	RectOut.Min.X = FMath::Max(int32((Box.Min.X + HalfScale) / CellScale), 0);
-	RectOut.Max.X = FMath::Min(int32((Box.Max.X - HalfScale) / CellScale), XCount - 1);	
-	RectOut.Min.Y = FMath::Max(int32((Box.Min.Y + HalfScale) / CellScale), 0);
-	RectOut.Max.Y = FMath::Min(int32((Box.Max.Y - HalfScale) / CellScale), YCount - 1);
+FCellRef AGAGridActor::CellRefToPyramidCell(const FCellRef& CellRef, int32 Level) const
+{
+	const FIntPoint LevelCell = FGAGridPyramid::CellToLevelCell(FIntPoint(CellRef.X, CellRef.Y), Level);
+	return FCellRef(LevelCell.X, LevelCell.Y);
+}
 
-	return (RectOut.Min.X <= RectOut.Max.X) && (RectOut.Min.Y <= RectOut.Max.Y);
+FIntRect AGAGridActor::PyramidCellToCellRect(const FCellRef& PyramidCellRef, int32 Level) const
+{
+	return TraversablePyramid.LevelCellToCellRect(Level, FIntPoint(PyramidCellRef.X, PyramidCellRef.Y));
 }
 
 
-// Data from NavSystem --------------------------------
+// Debugging and Visualization --------------------------------
 
-bool AGAGridActor::RefreshDataFromNav()
-{
-	bool Result = false;
-	UNavigationSystemV1 *NavSystem = UNavigationSystemV1::GetNavigationSystem(this);
-	if (NavSystem)
-	{
-		INavigationDataInterface* NavData = NavSystem->GetMainNavData();		// Note: only using the default nav data here
-		const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(NavData);
-		FTransform ActorTransform = GetActorTransform();
 
-		// Allocate the array and set to 0
-		ResetData();
+void AGAGridActor::TraceDebugMeshHeights(TArray<float>& HeightsOut) const
+{
+	const int32 VertexXCount = XCount + 1;
+	const int32 VertexCount = VertexXCount * (YCount + 1);
+	HeightsOut.SetNumUninitialized(VertexCount);
 
-		ECellData* CellData = GetData();
+	const FTransform& GridTransform = GetActorTransform();
+	const FVector Up = GridTransform.GetUnitAxis(EAxis::Z);
+	UWorld* World = GetWorld();
 
-		// Code for extracting nav polys taken from here:
-		// https://nerivec.github.io/old-ue4-wiki/pages/ai-navigation-in-c-customize-path-following-every-tick.html
+	// Only static geometry, so the mesh drapes over the level and not over whatever happens to be standing on it. The
+	// heights are cached (see RefreshDebugMesh), so tracing on the game thread is only paid when the ground changes.
+	const FCollisionObjectQueryParams ObjectParams(ECollisionChannel::ECC_WorldStatic);
+	const FCollisionQueryParams Params(SCENE_QUERY_STAT(GAGridDebugMesh), false, this);
 
-		for (int32 TileIndex = 0; TileIndex < NavMesh->GetNavMeshTilesCount(); TileIndex++)
+	for (int32 Y = 0; Y <= YCount; Y++)
+	{
+		for (int32 X = 0; X < VertexXCount; X++)
 		{
-			const FBox TileBounds = NavMesh->GetNavMeshTileBounds(TileIndex);
-			if (TileBounds.IsValid)			// reportedly will crash if this is not checked
-			{
-				TArray<FNavPoly> Polys;
+			const FVector LocalPoint(float(X) * CellScale - HalfExtents.X, float(Y) * CellScale - HalfExtents.Y, 0.0f);
+			const FVector Point = GridTransform.TransformPosition(LocalPoint);
 
-				if (NavMesh->GetPolysInTile(TileIndex, Polys))
+			float Height = 0.0f;
+			FHitResult Hit;
+			if (World && World->LineTraceSingleByObjectType(Hit, Point + Up * DebugMeshTraceDistance, Point - Up * DebugMeshTraceDistance, ObjectParams, Params))
+			{
+				Height = GridTransform.InverseTransformPosition(Hit.ImpactPoint).Z;
+			}
+			else
+			{
+				// Nothing to hit (e.g. no world yet), so fall back to the highest of the rasterized heights of the cells touching this vertex
+				bool bFound = false;
+				for (int32 DY = -1; DY <= 0; DY++)
 				{
-					for (FNavPoly& NavPoly : Polys)
+					for (int32 DX = -1; DX <= 0; DX++)
 					{
-						TArray<FVector> PolyVerts;
-						TArray<FVector2D> PolyVerts2D;
-						NavNodeRef Ref = NavPoly.Ref;
-
-						NavMesh->GetPolyVerts(Ref, PolyVerts);
-						PolyVerts2D.SetNum(PolyVerts.Num());
-
-						// transform verts to local space
-						for (int32 VertexIndex = 0; VertexIndex < PolyVerts.Num(); VertexIndex++)
-						{
-							PolyVerts2D[VertexIndex] = FVector2D(ActorTransform.InverseTransformPosition(PolyVerts[VertexIndex])) + HalfExtents;
-						}
-
+						float CellHeight;
+						if (GetCellLocalHeight(FCellRef(X + DX, Y + DY), CellHeight))
 						{
-							FBox2D PolyBounds(EForceInit::ForceInit);
-							for (const FVector2D& Vert : PolyVerts2D)
-							{
-								PolyBounds += Vert;
-							}
-
-							FIntRect GridBox;
-							if (GridSpaceBoundsToRect2D(PolyBounds, GridBox))
-							{
-								TArray<FVector2D> OutsideVectors;
-								OutsideVectors.SetNum(PolyVerts2D.Num());
-
-								// Cache off a set of "outside vectors", so that we can test each cell in the box against the
-								// bounds of the polygons
-
-								for (int32 V0Index = 0; V0Index < PolyVerts2D.Num(); V0Index++)
-								{
-									int32 V1Index = (V0Index + 1) % PolyVerts2D.Num();
-									FVector2D& V0 = PolyVerts2D[V0Index];
-									FVector2D& V1 = PolyVerts2D[V1Index];
-									FVector2D V0V1 = V1 - V0;
-
-									// Rotate 90 degrees
-									FVector2D &OutsideVector = OutsideVectors[V0Index];
-									OutsideVector.X = -V0V1.Y;
-									OutsideVector.Y = V0V1.X;
-								}
-
-								// Grid box now represents the intersection between Grid and the poly in question.
-								// Check each cell in the box to see if it's inside the poly
-
-								// Note, this is way inefficient
-								// A smarter way would be to use some kind of rasterization approach
-
-								for (int Y = GridBox.Min.Y; Y <= GridBox.Max.Y; Y++)
-								{
-									for (int X = GridBox.Min.X; X <= GridBox.Max.X; X++)
-									{
-										FCellRef CellRef(X, Y);
-										FVector2D CellCenter = GetCellGridSpacePosition(CellRef);
-										bool IsOutside = false;
-
-										for (int32 V0Index = 0; (V0Index < PolyVerts2D.Num()) && !IsOutside; V0Index++)
-										{
-											FVector2D& V0 = PolyVerts2D[V0Index];
-											FVector2D &OutsideVector = OutsideVectors[V0Index];
-											FVector2D V0Cell = CellCenter - V0;
-
-											if ((V0Cell | OutsideVector) > 0.0f)		// Dot product
-											{
-												// the cell is outside this edge
-												IsOutside = true;
-											}
-										}
-
-										int32 CellIndex = CellRefToIndex(CellRef);
-										if (!IsOutside)
-										{
-											// turn on the traversable bit
-											EnumAddFlags(CellData[CellIndex], ECellData::CellDataTraversable);
-										}
-									}
-								}
-							}
+							Height = bFound ? FMath::Max(Height, CellHeight) : CellHeight;
+							bFound = true;
 						}
 					}
 				}
 			}
+
+			HeightsOut[Y * VertexXCount + X] = Height;
 		}
 	}
-
-	return Result;
 }
 
-
-// Debugging and Visualization --------------------------------
-
-
 bool AGAGridActor::RefreshDebugMesh()
 {
+	if ((DebugMeshComponent == NULL) || (XCount <= 0) || (YCount <= 0))
+	{
+		return false;
+	}
+
+	// Same layout, heights and placement as last time, so the existing section is still good. Stamps and flag changes
+	// bump GridVersion but don't move the ground, so they don't count.
+	if (bDebugMeshBuilt
+		&& (DebugMeshXCount == XCount) && (DebugMeshYCount == YCount) && (DebugMeshCellScale == CellScale)
+		&& (DebugMeshBuiltZOffset == DebugMeshZOffset) && (DebugMeshHeightsVersion == HeightsVersion)
+		&& DebugMeshBuiltTransform.Equals(GetActorTransform())
+		&& (DebugMeshComponent->GetNumSections() > 0))
+	{
+		return true;
+	}
+
 	TArray<FVector> Vertices;
 	TArray<int32> Triangles;
 	TArray<FVector> Normals;
@@ -319,8 +1602,10 @@ bool AGAGridActor::RefreshDebugMesh()
 
 	int32 VertexCount = (XCount + 1) * (YCount + 1);
 
-	// Generate the vertices array
-	// TODO: do a raycast to to figure out where the ground actually is
+	TArray<float> Heights;
+	TraceDebugMeshHeights(Heights);
+
+	// Generate the vertices array, sitting on the ground
 	{
 		Vertices.SetNumUninitialized(VertexCount);
 
@@ -337,7 +1622,7 @@ bool AGAGridActor::RefreshDebugMesh()
 				FVector VertexPoint;
 				VertexPoint.X = float(X) * CellScale + ZeroZeroCorner.X;
 				VertexPoint.Y = float(Y) * CellScale + ZeroZeroCorner.Y;
-				VertexPoint.Z = DebugMeshZOffset;
+				VertexPoint.Z = Heights[Index] + DebugMeshZOffset;
 				Vertices[Index] = VertexPoint;
 				Index++;
 			}
@@ -403,17 +1688,26 @@ bool AGAGridActor::RefreshDebugMesh()
 		}
 	}
 
-	// Generate the UV coordinates for each vertex
-	// For now, assume all are straight up
+	// Generate the normals for each vertex, from the slope of the draped heights
 	{
 		Normals.SetNumUninitialized(VertexCount);
+		int32 VertexXCount = XCount + 1;
 		int32 Index = 0;
 
 		for (int32 Y = 0; Y <= YCount; Y++)
 		{
 			for (int32 X = 0; X <= XCount; X++)
 			{
-				Normals[Index] = FVector::UpVector;
+				// Central differences, falling back to one-sided at the edges
+				int32 X0 = FMath::Max(X - 1, 0);
+				int32 X1 = FMath::Min(X + 1, XCount);
+				int32 Y0 = FMath::Max(Y - 1, 0);
+				int32 Y1 = FMath::Min(Y + 1, YCount);
+
+				float DZDX = (Heights[Y * VertexXCount + X1] - Heights[Y * VertexXCount + X0]) / (float(X1 - X0) * CellScale);
+				float DZDY = (Heights[Y1 * VertexXCount + X] - Heights[Y0 * VertexXCount + X]) / (float(Y1 - Y0) * CellScale);
+
+				Normals[Index] = FVector(-DZDX, -DZDY, 1.0f).GetSafeNormal();
 				Index++;
 			}
 		}
@@ -430,9 +1724,45 @@ bool AGAGridActor::RefreshDebugMesh()
 		false  // create collision
 	);
 
+	DebugMeshXCount = XCount;
+	DebugMeshYCount = YCount;
+	DebugMeshCellScale = CellScale;
+	DebugMeshBuiltZOffset = DebugMeshZOffset;
+	DebugMeshHeightsVersion = HeightsVersion;
+	DebugMeshBuiltTransform = GetActorTransform();
+	bDebugMeshBuilt = true;
+
 	return true;
 }
 
+bool AGAGridActor::EnsureDebugTexture()
+{
+	bool bNewTexture = false;
+
+	if ((DebugTexture == NULL) || (DebugTexture->GetSizeX() != XCount) || (DebugTexture->GetSizeY() != YCount))
+	{
+		// Transient textures default to PF_B8G8R8A8, which is FColor's memory layout
+		DebugTexture = UTexture2D::CreateTransient(XCount, YCount);
+		DebugTexture->UpdateResource();
+		DebugTexels.Reset();
+		bNewTexture = true;
+	}
+
+	bool bNewMaterial = false;
+	if (DebugMaterialInstance == NULL)
+	{
+		DebugMaterialInstance = DebugMeshComponent->CreateDynamicMaterialInstance(0, DebugMaterial);
+		bNewMaterial = true;
+	}
+
+	if ((bNewTexture || bNewMaterial) && DebugMaterialInstance)
+	{
+		DebugMaterialInstance->SetTextureParameterValue("DebugTexture", DebugTexture);
+	}
+
+	return bNewTexture;
+}
+
 bool AGAGridActor::RefreshDebugTexture()
 {
 	bool Result = false;
@@ -452,82 +1782,127 @@ bool AGAGridActor::RefreshDebugTexture()
 	}
 	*/
 
-	if (DebugMeshComponent)
+	if (DebugMeshComponent && (XCount > 0) && (YCount > 0))
 	{
-		// create a new texture
-		UTexture2D *RuntimeTexture = UTexture2D::CreateTransient(XCount, YCount);
-		FTexture2DMipMap *FirstMip = &RuntimeTexture->GetPlatformData()->Mips[0];
-		FByteBulkData *ImageData = &FirstMip->BulkData;
-		uint8* RawImageData = (uint8*)ImageData->Lock(LOCK_READ_WRITE);
-		int32 ElementCount = ImageData->GetElementCount();
-		int32 ElementSize = ImageData->GetElementSize();
+		const bool bFullUpload = EnsureDebugTexture() || (DebugTexels.Num() != GetCellCount());
+		if (bFullUpload)
+		{
+			DebugTexels.SetNumZeroed(GetCellCount());
+		}
 
-		check(ElementCount == 4 * XCount * YCount);
-		check(ElementSize == sizeof(uint8));
+		float MaxValue = 0.0f;
+		const bool bHasMap = DebugGridMap.IsValid();
+		if (bHasMap)
+		{
+			DebugGridMap.GetMaxValue(MaxValue);
+		}
 
-		int32 Index = 0;
+		// The map's row under the current texel row, scaled to 0..255
+		const FGridBox& MapBounds = DebugGridMap.GridBounds;
+		TArray<float> MapRow;
+		if (bHasMap)
+		{
+			MapRow.SetNumUninitialized(MapBounds.GetWidth());
+		}
 
-		if (DebugGridMap.IsValid())
+		// Regenerate the texels into the shadow copy, noting the changed columns of each row
+		TArray<FIntPoint> DirtySpans;
+		DirtySpans.Init(FIntPoint(XCount, -1), YCount);
+
+		for (int32 Y = 0; Y < YCount; Y++)
 		{
-			float MaxValue;
-			DebugGridMap.GetMaxValue(MaxValue);
+			FColor* Row = DebugTexels.GetData() + Y * XCount;
 
-			for (int32 Y = 0; Y < YCount; Y++)
+			const bool bRowOnMap = bHasMap && (Y >= MapBounds.MinY) && (Y <= MapBounds.MaxY);
+			if (bRowOnMap)
 			{
-				for (int32 X = 0; X < XCount; X++)
-				{
-					FCellRef CellRef(X, Y);
-					ECellData CellData = GetCellData(CellRef);
-					bool Traversable = EnumHasAllFlags(CellData, ECellData::CellDataTraversable);
+				DebugGridMap.GetRowValues(Y, MapBounds.MinX, MapRow.Num(), MapRow.GetData());
+				FGAGridMapKernels::Scale(MapRow.GetData(), MapRow.Num(), 255.0f / MaxValue);
+			}
+
+			for (int32 X = 0; X < XCount; X++)
+			{
+				FCellRef CellRef(X, Y);
+				bool Traversable = IsCellTraversable(CellRef);
+				FColor Texel;
 
-					float MapValue;
-					bool IsOnMap = DebugGridMap.GetValue(CellRef, MapValue);
+				if (bHasMap)
+				{
+					bool IsOnMap = bRowOnMap && (X >= MapBounds.MinX) && (X <= MapBounds.MaxX);
 					int32 IntVal = 0;
 					if (IsOnMap)
 					{
-						IntVal = FMath::RoundToInt(255.0f * (MapValue / MaxValue));
+						IntVal = FMath::RoundToInt(MapRow[X - MapBounds.MinX]);
 					}
 
 					// Note: fade from blue to red as we approach the max value in the debug map
 
-					RawImageData[Index] = IsOnMap ? 255 - IntVal : 0;		// blue		Are we on the map or not?
-					RawImageData[Index + 1] = Traversable ? 50 : 0;			// green	Are we traversable or not?
-					RawImageData[Index + 2] = IntVal;						// red		The value
-					RawImageData[Index + 3] = 255;							// alpha
+					Texel.B = IsOnMap ? 255 - IntVal : 0;		// blue		Are we on the map or not?
+					Texel.G = Traversable ? 50 : 0;				// green	Are we traversable or not?
+					Texel.R = IntVal;							// red		The value
+					Texel.A = 255;								// alpha
+				}
+				else
+				{
+					uint8 Val = Traversable ? 255 : 0;
+					Texel = FColor(Val, Val, Val, 255);
+				}
 
-					Index += 4;
+				if (bFullUpload || (Row[X] != Texel))
+				{
+					Row[X] = Texel;
+					DirtySpans[Y].X = FMath::Min(DirtySpans[Y].X, X);
+					DirtySpans[Y].Y = FMath::Max(DirtySpans[Y].Y, X);
 				}
 			}
-
 		}
-		else
+
+		// One region per run of consecutive dirty rows, covering the union of their dirty columns
+		TArray<FUpdateTextureRegion2D> Regions;
+		for (int32 Y = 0; Y < YCount; Y++)
 		{
-			for (int32 Y = 0; Y < YCount; Y++)
+			if (DirtySpans[Y].Y < 0)
 			{
-				for (int32 X = 0; X < XCount; X++)
-				{
-					ECellData CellData = GetCellData(FCellRef(X, Y));
-					bool Traversable = EnumHasAllFlags(CellData, ECellData::CellDataTraversable);
-					uint8 Val = Traversable ? 255 : 0;
-
-					RawImageData[Index] = Val;			// blue 
-					RawImageData[Index + 1] = Val;		// green
-					RawImageData[Index + 2] = Val;		// red
-					RawImageData[Index + 3] = 255;		// alpha
+				continue;
+			}
 
-					Index += 4;
-				}
+			int32 MinX = DirtySpans[Y].X;
+			int32 MaxX = DirtySpans[Y].Y;
+			int32 EndY = Y + 1;
+			while ((EndY < YCount) && (DirtySpans[EndY].Y >= 0))
+			{
+				MinX = FMath::Min(MinX, DirtySpans[EndY].X);
+				MaxX = FMath::Max(MaxX, DirtySpans[EndY].Y);
+				EndY++;
 			}
-		}
 
-		ImageData->Unlock();
-		RuntimeTexture->UpdateResource();
+			Regions.Emplace(MinX, Y, MinX, Y, MaxX - MinX + 1, EndY - Y);
+			Y = EndY;
+		}
 
-		UMaterialInstanceDynamic* DynamicMaterial = DebugMeshComponent->CreateDynamicMaterialInstance(0, DebugMaterial);
-		if (DynamicMaterial)
+		if (Regions.Num() > 0)
 		{
-			DynamicMaterial->SetTextureParameterValue("DebugTexture", RuntimeTexture);
-			DebugMeshComponent->SetMaterial(0, DynamicMaterial);
+			// The render thread reads the texels after we return, so hand it its own copy of the dirty rows
+			const int32 FirstRow = Regions[0].DestY;
+			const int32 LastRow = Regions.Last().DestY + Regions.Last().Height - 1;
+			const int32 Pitch = XCount * sizeof(FColor);
+
+			uint8* SrcData = (uint8*)FMemory::Malloc((LastRow - FirstRow + 1) * Pitch);
+			FMemory::Memcpy(SrcData, DebugTexels.GetData() + FirstRow * XCount, (LastRow - FirstRow + 1) * Pitch);
+
+			FUpdateTextureRegion2D* SrcRegions = new FUpdateTextureRegion2D[Regions.Num()];
+			for (int32 Index = 0; Index < Regions.Num(); Index++)
+			{
+				SrcRegions[Index] = Regions[Index];
+				SrcRegions[Index].SrcY -= FirstRow;
+			}
+
+			DebugTexture->UpdateTextureRegions(0, Regions.Num(), SrcRegions, Pitch, sizeof(FColor), SrcData,
+				[](uint8* Data, const FUpdateTextureRegion2D* RegionData)
+				{
+					FMemory::Free(Data);
+					delete[] RegionData;
+				});
 		}
 
 		Result = true;
@@ -2,57 +2,67 @@
 
 #include "CoreMinimal.h"
 #include "Math/MathFwd.h"
+#include "GAGridCellRef.h"
 #include "GAGridMap.h"
+#include "GAGridMapPool.h"
+#include "GAGridBitPlane.h"
+#include "GAGridPyramid.h"
+#include "GAGridClearance.h"
+#include "GAGridRegions.h"
+#include "GAGridLineWalk.h"
+#include "GAGridVisibility.h"
+#include "GAGridRasterizer.h"
 #include "GAGridActor.generated.h"
 
+class ANavigationData;
+class ARecastNavMesh;
 class UBoxComponent;
 class USceneComponent;
 class UProceduralMeshComponent;
 class UTexture2D;
+class UNavArea;
+class UMaterialInstanceDynamic;
 
 UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
 enum class ECellData : uint8
 {
 	CellDataNone = 0,
-	CellDataTraversable = 1 << 0
+	CellDataTraversable = 1 << 0,
+	CellDataCover = 1 << 1,
+	CellDataHazard = 1 << 2,
+	CellDataSlow = 1 << 3,
+	CellDataDoor = 1 << 4
 };
 ENUM_CLASS_FLAGS(ECellData);
 
-
+// What the cells covered by polys of a given nav area get flagged with, on top of CellDataTraversable
 USTRUCT(BlueprintType)
-struct FCellRef
+struct FGANavAreaCellData
 {
-	GENERATED_USTRUCT_BODY()
-
-	FCellRef() : X(INDEX_NONE), Y(INDEX_NONE) {}
-	FCellRef(int32 Xin, int32 Yin) : X(Xin), Y(Yin) {}
+	GENERATED_BODY()
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	int32 X;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Bitmask, BitmaskEnum = "/Script/GameAI.ECellData"))
+	uint8 Flags = 0;
+};
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	int32 Y;
+class AGAGridActor;
 
-	bool operator==(const FCellRef& other) const {
-		return (X == other.X) && (Y == other.Y);
-	}
+// Fired when a (re)build of the grid's Data finishes, successfully or not
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FGAGridDataReadyDelegate, AGAGridActor*, GridActor, bool, bSuccess);
 
-	bool operator<(const FCellRef& other) const {
-		// Compare X values first, then Y values
-		if (X == other.X) {
-			return Y < other.Y;
-		}
-		return X < other.X;
-	}
+// Fired whenever a rectangle of cells changes, along with the grid version the change was stamped with.
+// Native only, since FIntRect isn't exposed to blueprint.
+DECLARE_MULTICAST_DELEGATE_TwoParams(FGAGridCellsChangedEvent, const FIntRect& /* CellRect */, uint32 /* GridVersion */);
 
-	//  Note: can't add specifiers, or call from blueprint, because UStructs
-	// don't get UFunctions in Unreal
-	bool IsValid() const
-	{
-		return (X >= 0) && (Y >= 0);
-	}
 
-	static FCellRef Invalid;
+// The cells under a stamp (see AGAGridActor::StampBox etc.), as runs of cells: X is the row, Y and Z the inclusive
+// first and last cells of the run
+struct FGAGridStamp
+{
+	FIntRect Bounds;
+	TArray<FIntVector> Spans;
+	ECellData Flags;
+	bool bBlock;
 };
 
 
@@ -86,10 +96,13 @@ class AGAGridActor : public AActor
 	TObjectPtr<USceneComponent> SceneComponent;
 
 	// Data
+	// Note: if you change this directly, call NotifyCellsChanged afterwards so the derived data (e.g. TraversableBits) keeps up
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	TArray<ECellData> Data;
 
 	virtual void PostLoad() override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 #if WITH_EDITORONLY_DATA
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
@@ -102,7 +115,7 @@ class AGAGridActor : public AActor
 
 private:
 	ECellData* GetData() { return Data.GetData(); }
-	int32 GetCellCount() { return XCount*YCount; }
+	int32 GetCellCount() const { return XCount*YCount; }
 
 	void RefreshDerivedValues();
 
@@ -118,8 +131,26 @@ public:
 	FCellRef GetCellRef(const FVector& Point, bool bClamp = true) const;
 
 	// Get the world position of the center of the given cell
+	// The point sits on the ground if the cell has a height (see GetCellLocalHeight), otherwise on the grid's plane
 	FVector GetCellPosition(const FCellRef& CellRef) const;
 
+	// Ground height of the cell's center in actor space, taken from the nav mesh when the grid was built.
+	// Returns false for cells with no nav poly over them.
+	bool GetCellLocalHeight(const FCellRef& CellRef, float& HeightOut) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool HasCellHeight(const FCellRef& CellRef) const;
+
+	// How far the point is above the ground of the cell it's over. Returns false if that cell has no height.
+	bool GetHeightAboveGround(const FVector& Point, float& HeightOut) const;
+
+	// Batch versions of GetCellRef and GetCellPosition, with the same results.
+	// The actor transform is only inverted when it changes (see GetTransformCache), grids with no rotation skip the full
+	// transform altogether, and the floor/clamp to cell indices is done a pair of points at a time with SIMD.
+	// The output views must be at least as long as the inputs. Game thread only.
+	void GetCellRefs(TConstArrayView<FVector> Points, TArrayView<FCellRef> CellRefsOut, bool bClamp = true) const;
+	void GetCellPositions(TConstArrayView<FCellRef> CellRefs, TArrayView<FVector> PositionsOut) const;
+
  	// Get the grid-space position of the center of the given cell
 	// Note, grid-space is a bit of a weird idea.
 	// In actor space, (0, 0) is the center of the grid
@@ -141,6 +172,230 @@ public:
 	UFUNCTION(BlueprintCallable)
 	ECellData GetCellData(const FCellRef &CellRef) const;
 
+	// Traversability --------------------------------
+	// These read TraversableBits, a 1-bit-per-cell copy of the CellDataTraversable flag. Cells off the grid are never traversable.
+	// The span and rect queries test 64 cells per word, so blocked areas can be rejected wholesale.
+
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	FORCEINLINE bool IsCellTraversable(const FCellRef& CellRef) const
+	{
+		return TraversableBits.IsValidCell(CellRef.X, CellRef.Y) && TraversableBits.Get(CellRef.X, CellRef.Y);
+	}
+
+	// Are all the cells MinX..MaxX (inclusive) of row Y traversable?
+	bool IsSpanTraversable(int32 Y, int32 MinX, int32 MaxX) const { return TraversableBits.IsSpanAllSet(Y, MinX, MaxX); }
+
+	// Is any of the cells MinX..MaxX (inclusive) of row Y traversable?
+	bool IsAnyTraversableInSpan(int32 Y, int32 MinX, int32 MaxX) const { return TraversableBits.IsSpanAnySet(Y, MinX, MaxX); }
+
+	// Are all the cells of the (inclusive) rect traversable?
+	bool IsRectTraversable(const FIntRect& CellRect) const { return TraversableBits.IsRectAllSet(CellRect); }
+
+	// Is any of the cells of the (inclusive) rect traversable?
+	bool IsAnyTraversableInRect(const FIntRect& CellRect) const { return TraversableBits.IsRectAnySet(CellRect); }
+
+	// Which of the 8 neighbors of the cell are traversable. Bit order is given by FGAGridBitPlane::NeighborDX/NeighborDY.
+	uint8 GetTraversableNeighborMask(const FCellRef& CellRef) const { return TraversableBits.GetNeighborMask(CellRef.X, CellRef.Y); }
+
+	const FGAGridBitPlane& GetTraversableBits() const { return TraversableBits; }
+
+	// Iteration --------------------------------
+	// Visit the cells of a rect (inclusive, clipped to the grid) a row at a time, in row order, without the lookups
+	// that going through GetCellData cell by cell costs. Func is called as Func(const FCellRef& CellRef, ECellData Flags),
+	// Flags being what GetCellData would return (stamps included), and is meant to be small enough to inline into the loop.
+
+	template <typename FuncType>
+	void ForEachCell(const FIntRect& CellRect, FuncType&& Func) const
+	{
+		FIntRect Rect;
+		if (ClipToGrid(CellRect, Rect))
+		{
+			const bool bStamped = HasStampCounts();
+			for (int32 Y = Rect.Min.Y; Y <= Rect.Max.Y; Y++)
+			{
+				const int32 RowIndex = Y * XCount;
+				const ECellData* Row = GetRowData(Y);
+				for (int32 X = Rect.Min.X; X <= Rect.Max.X; X++)
+				{
+					Func(FCellRef(X, Y), bStamped ? ApplyStampsToCell(RowIndex + X, Row[X]) : Row[X]);
+				}
+			}
+		}
+	}
+
+	template <typename FuncType>
+	void ForEachCell(FuncType&& Func) const { ForEachCell(GetGridRect(), Forward<FuncType>(Func)); }
+
+	// Same, skipping cells that aren't traversable. Those are found 64 at a time in TraversableBits, so blocked
+	// stretches cost next to nothing.
+	template <typename FuncType>
+	void ForEachTraversableCell(const FIntRect& CellRect, FuncType&& Func) const
+	{
+		FIntRect Rect;
+		if (ClipToGrid(CellRect, Rect))
+		{
+			const bool bStamped = HasStampCounts();
+			for (int32 Y = Rect.Min.Y; Y <= Rect.Max.Y; Y++)
+			{
+				const int32 RowIndex = Y * XCount;
+				const ECellData* Row = GetRowData(Y);
+				TraversableBits.ForEachSetInSpan(Y, Rect.Min.X, Rect.Max.X, [&](int32 X)
+				{
+					Func(FCellRef(X, Y), bStamped ? ApplyStampsToCell(RowIndex + X, Row[X]) : Row[X]);
+				});
+			}
+		}
+	}
+
+	template <typename FuncType>
+	void ForEachTraversableCell(FuncType&& Func) const { ForEachTraversableCell(GetGridRect(), Forward<FuncType>(Func)); }
+
+	// Raw access to the flags of row Y, indexed by X. These are the flags as built, without the stamps.
+	FORCEINLINE const ECellData* GetRowData(int32 Y) const { return Data.GetData() + Y * XCount; }
+
+	// Line traversal --------------------------------
+	// Walks every cell a straight line passes through (see FGAGridLineWalk), stopping at the first one that isn't
+	// traversable. Z is ignored. Cells off the grid count as blocked.
+
+	// Is every cell between Start and End traversable? If not, BlockedCellOut is the first one that isn't.
+	UFUNCTION(BlueprintCallable)
+	bool IsLineTraversable(const FVector& Start, const FVector& End, FCellRef& BlockedCellOut) const;
+
+	// Test the line from Start to each of Ends. ClearOut[i] is whether the line to Ends[i] is traversable.
+	void AreLinesTraversable(const FVector& Start, TConstArrayView<FVector> Ends, TArrayView<bool> ClearOut) const;
+
+	// The index of the first of Ends that can't be reached in a straight line from Start, or INDEX_NONE if they all can.
+	// Lines after the first blocked one aren't tested.
+	int32 FindFirstBlockedLine(const FVector& Start, TConstArrayView<FVector> Ends) const;
+
+	// Cell flags --------------------------------
+	// Every flag of ECellData gets its own bitplane, kept up to date with Data the same way as TraversableBits, so they
+	// support the same span and rect queries. Flag arguments must be a single flag.
+
+	static constexpr int32 CellDataChannelCount = 5;
+
+	const FGAGridBitPlane& GetFlagBits(ECellData Flag) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool HasCellFlag(const FCellRef& CellRef, ECellData Flag) const
+	{
+		const FGAGridBitPlane& Bits = GetFlagBits(Flag);
+		return Bits.IsValidCell(CellRef.X, CellRef.Y) && Bits.Get(CellRef.X, CellRef.Y);
+	}
+
+	// Does any of the cells MinX..MaxX (inclusive) of row Y have the flag?
+	bool IsAnyFlagInSpan(ECellData Flag, int32 Y, int32 MinX, int32 MaxX) const { return GetFlagBits(Flag).IsSpanAnySet(Y, MinX, MaxX); }
+
+	// Does any of the cells of the (inclusive) rect have the flag?
+	bool IsAnyFlagInRect(ECellData Flag, const FIntRect& CellRect) const { return GetFlagBits(Flag).IsRectAnySet(CellRect); }
+
+	// Flags for the cells under each nav area's polys. Areas not listed only mark their cells traversable.
+	// Takes effect on the next refresh from nav.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TMap<TSubclassOf<UNavArea>, FGANavAreaCellData> NavAreaCellData;
+
+	// Dynamic stamps --------------------------------
+	// Temporary changes layered over the nav-built cells, e.g. blockers and hazard zones spawned by attacks.
+	// A stamp adds Flags to the cells under its shape, and if bBlock also makes them non-traversable (blocking wins over a
+	// stamp adding CellDataTraversable). Stamps are reference counted per cell, so overlapping ones can come and go in any order.
+	// Data itself is never touched: stamps are folded in with the derived data, so every query sees them and a rebuild
+	// from nav keeps them. Adding or removing a stamp goes through NotifyCellsChanged with just the stamp's bounds, so
+	// OnCellsChanged tells listeners exactly which cells to invalidate, along with the new grid version.
+	// Shapes are in world space with Z ignored, and a cell is under a shape if its center is.
+	// The Stamp functions return a handle for RemoveStamp, or INDEX_NONE if the shape doesn't cover any cells.
+
+	UFUNCTION(BlueprintCallable)
+	int32 StampBox(const FVector& Center, const FVector2D& HalfSize, float Yaw, ECellData Flags, bool bBlock);
+
+	UFUNCTION(BlueprintCallable)
+	int32 StampCircle(const FVector& Center, float Radius, ECellData Flags, bool bBlock);
+
+	// Points are the corners of a simple (not necessarily convex) polygon, in order
+	UFUNCTION(BlueprintCallable)
+	int32 StampPolygon(const TArray<FVector>& Points, ECellData Flags, bool bBlock);
+
+	UFUNCTION(BlueprintCallable)
+	bool RemoveStamp(int32 StampHandle);
+
+	int32 GetStampCount() const { return Stamps.Num(); }
+
+	// Traversal costs --------------------------------
+	// An optional uint8 cost per cell, for weighted searches. A cell costs the most of CellFlagCosts over the flags
+	// it has, and 1 if it has none of them. Costs below 1 count as 1, so searches can rely on every step costing
+	// something. Only cells that change are re-costed, so edits to CellFlagCosts show up on the next refresh from nav.
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bBuildCostField;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TMap<ECellData, uint8> CellFlagCosts;
+
+	bool HasCostField() const { return CellCosts.Num() == GetCellCount(); }
+
+	// The cost of stepping into the cell. 1 if there's no cost field, 0 for cells off the grid.
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	int32 GetCellCost(const FCellRef& CellRef) const;
+
+	// Traversability pyramid --------------------------------
+	// A coarse-to-fine summary of TraversableBits. A cell of pyramid level L covers a 2^L x 2^L block of grid cells
+	// and records whether none, some or all of them are traversable. Level 0 is the grid itself.
+	// Useful for throwing away big empty or solid areas before looking at individual cells.
+
+	int32 GetPyramidLevelCount() const { return TraversablePyramid.GetLevelCount(); }
+
+	// Coverage of a single pyramid cell. Out of range levels or cells report None.
+	EGACellCoverage GetPyramidCoverage(int32 Level, const FCellRef& PyramidCellRef) const;
+
+	// How much of the (inclusive) rect is traversable. Cells off the grid count as not traversable.
+	EGACellCoverage GetRectCoverage(const FIntRect& CellRect) const { return TraversablePyramid.GetRectCoverage(TraversableBits, CellRect); }
+
+	// The pyramid cell at the given level that contains the grid cell
+	FCellRef CellRefToPyramidCell(const FCellRef& CellRef, int32 Level) const;
+
+	// The (inclusive) rect of grid cells covered by a pyramid cell, clipped to the grid
+	FIntRect PyramidCellToCellRect(const FCellRef& PyramidCellRef, int32 Level) const;
+
+	// Clearance --------------------------------
+	// How far each cell is from the nearest non-traversable cell or the edge of the grid, kept up to date with TraversableBits.
+	// Lets queries treat agents as discs rather than points with a single lookup.
+
+	// Distance in world units from the cell's center to the nearest non-traversable cell. 0 for non-traversable cells.
+	// Distances past GetMaxClearance() read as GetMaxClearance().
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	float GetCellClearance(const FCellRef& CellRef) const;
+
+	// Can an agent of the given radius stand on the cell's center without overlapping a non-traversable cell?
+	// A radius of 0 is the same as IsCellTraversable. Radii past GetMaxClearance() are treated as GetMaxClearance().
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool HasClearance(const FCellRef& CellRef, float Radius) const;
+
+	float GetMaxClearance() const { return (float(FGAGridClearanceField::MaxDistance) - 0.5f) * CellScale; }
+
+	// Regions --------------------------------
+	// Every traversable cell is labeled with the connected region (4-connected) it belongs to, kept up to date with
+	// TraversableBits. Two cells can only be pathed between if they're in the same region.
+
+	// The region of the cell, or INDEX_NONE if it's not traversable
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	int32 GetCellRegion(const FCellRef& CellRef) const;
+
+	// Is there a traversable path between the two cells?
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool AreCellsConnected(const FCellRef& CellRefA, const FCellRef& CellRefB) const;
+
+	// The cell of the given region closest to CellRef (CellRef itself if it's in the region), searching no further than
+	// MaxCellDistance cells away. Returns FCellRef::Invalid if there isn't one.
+	UFUNCTION(BlueprintCallable)
+	FCellRef FindNearestCellInRegion(const FCellRef& CellRef, int32 Region, int32 MaxCellDistance = 32) const;
+
+	int32 GetRegionCount() const { return RegionLabels.GetRegionCount(); }
+
+	// Number of cells in the region
+	int32 GetRegionSize(int32 Region) const { return RegionLabels.GetRegionSize(Region); }
+
+	// The rect (inclusive) covering every cell of the grid
+	FIntRect GetGridRect() const { return FIntRect(0, 0, XCount - 1, YCount - 1); }
+
 	// Returns the bounds of the given box in cell indices
 	// Note, assumes the Box is in grid-space already
 	// Returns an invalid rectangle if the Box and the grid are disjoint
@@ -149,9 +404,265 @@ public:
 
 	// Data from NavSystem --------------------------------
 
+	// Rebuild Data from the nav mesh. If bUseGridSnapshot is set and there is a snapshot baked from the same nav data,
+	// the cells are loaded from it instead of being rasterized.
 	UFUNCTION(BlueprintCallable)
 	bool RefreshDataFromNav();
 
+	// Same as RefreshDataFromNav, but the tiles are rasterized in parallel on worker threads.
+	// Only the gathering of the nav polys happens on the game thread. Data is swapped in on the game thread once
+	// the build is done, at which point OnGridDataReady fires.
+	// Returns false if the build couldn't be started (e.g. no nav mesh).
+	UFUNCTION(BlueprintCallable)
+	bool RefreshDataFromNavAsync();
+
+	// True when Data matches the grid's dimensions and no async build is pending.
+	// AI components check this before reading the grid.
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool IsGridDataReady() const;
+
+	UPROPERTY(BlueprintAssignable)
+	FGAGridDataReadyDelegate OnGridDataReady;
+
+	// If true, the grid listens for the nav system finishing a (re)build and refreshes the cells of whichever tiles changed
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bRefreshOnNavChange;
+
+	// Re-gather the nav mesh and only re-rasterize the cells covered by tiles that were added, removed or changed
+	// since the last build. Falls back to a full RefreshDataFromNav if there is no previous build to compare against.
+	UFUNCTION(BlueprintCallable)
+	bool RefreshDataFromNavIncremental();
+
+	// If true, nav polys are rasterized the original way, by testing every cell in a poly's bounding box against
+	// every edge of the poly. Otherwise they are filled span by span with a scanline rasterizer.
+	// Only really useful for comparing the two -- see CompareRasterizers.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bUseLegacyRasterizer;
+
+	// Rasterize the nav mesh with both rasterizers and report how many cells disagree.
+	// Doesn't touch Data. Returns INDEX_NONE if there is no nav mesh to rasterize.
+	UFUNCTION(BlueprintCallable)
+	int32 CompareRasterizers() const;
+
+	// Snapshots --------------------------------
+	// A snapshot is a baked copy of Data, saved per map under Content/GridSnapshots and staged as a loose file so it
+	// can be memory mapped. A snapshot is only used if the grid's dimensions, transform and nav data all still match it.
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bUseGridSnapshot;
+
+	// Rebuild Data from the nav mesh (ignoring any existing snapshot) and save it as this grid's snapshot
+	UFUNCTION(CallInEditor, BlueprintCallable)
+	bool BakeGridSnapshot();
+
+	FString GetGridSnapshotPath() const;
+
+	// Baked visibility --------------------------------
+	// An optional table of which cells can potentially see which (see FGAGridVisibilityTable), baked against static
+	// geometry and saved with the snapshot. Queries answer "yes" when there is no table, so callers can always use it to
+	// skip traces, and only need a real trace to confirm a "yes" or to account for dynamic actors. Any change to which
+	// cells are traversable (a nav refresh or a stamp) drops the table until it is baked or loaded again.
+
+	// If set, BakeGridSnapshot also bakes the visibility table. Worth it for fixed arenas, where traces are the main cost.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bBakeVisibility;
+
+	// Cells per side of a visibility block. Smaller blocks are more precise, but the table grows with the square of the block count.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+	int32 VisibilityBlockSize;
+
+	// How far above the ground the eyes are, at both ends of the rays traced when baking
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float VisibilityEyeHeight;
+
+	// Trace between the traversable cells of every pair of visibility blocks against static geometry. Slow, meant to be
+	// run in the editor before BakeGridSnapshot saves the result.
+	UFUNCTION(CallInEditor, BlueprintCallable)
+	bool BakeVisibilityTable();
+
+	bool HasVisibilityTable() const { return VisibilityTable.IsBuilt(XCount, YCount); }
+
+	// Could a viewer standing on From see something standing on To? Always true if there is no table.
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool IsCellPotentiallyVisible(const FCellRef& From, const FCellRef& To) const;
+
+	// Is any of the cells MinX..MaxX (inclusive) of row Y potentially visible from From? Always true if there is no table.
+	bool IsAnyCellPotentiallyVisibleInSpan(const FCellRef& From, int32 Y, int32 MinX, int32 MaxX) const;
+
+	// Scratch maps --------------------------------
+	// Temporary maps over this grid should be borrowed from here with FGAPooledGridMap rather than constructed, so
+	// that AI that builds them every tick stops allocating once the pool has warmed up.
+
+	FGAGridMapPool& GetMapPool() const { return MapPool; }
+
+	// The most scratch maps that have been out on loan at once
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	int32 GetMapPoolHighWaterMark() const { return MapPool.GetHighWaterMark(); }
+
+private:
+	const ARecastNavMesh* GetNavMesh() const;
+
+	bool RefreshDataFromNavInternal(bool bAllowSnapshot);
+
+	// Load Data from the snapshot if it matches the grid and the last recorded nav data, and bring everything derived
+	// from it up to date. Leaves Data alone if not.
+	bool LoadGridSnapshot();
+
+	bool SaveGridSnapshot() const;
+
+	// Pull the polys out of every nav mesh tile that overlaps the grid, transformed into grid space.
+	// Must be called on the game thread.
+	void GatherNavTiles(const ARecastNavMesh* NavMesh, TArray<FGANavTilePolys>& TilesOut) const;
+
+	// Takes the result of an async build of a BuildXCount x BuildYCount grid, unless the grid has been resized since
+	void FinishAsyncBuild(int32 BuildXCount, int32 BuildYCount, TArray<ECellData>&& NewData, TArray<uint16>&& NewHeights, const FGAGridHeightQuantizer& Quantizer);
+
+	UFUNCTION()
+	void OnNavigationGenerationFinished(ANavigationData* NavData);
+
+	// Remember the hash and footprint of each gathered tile, for the next incremental refresh to compare against
+	void RecordNavTiles(const TArray<FGANavTilePolys>& Tiles);
+
+	TMap<uint32, FIntRect> NavTileRecords;
+
+	// Checksum of every recorded tile hash, used to spot stale snapshots
+	uint32 NavChecksum;
+
+	// Incremented every time a build starts, so that a stale async build can tell it has been superseded
+	int32 BuildSerial;
+
+	bool bAsyncBuildInProgress;
+
+	// Quantized ground height of each cell's center (actor space), laid out like Data. Built along with Data from the nav polys.
+	TArray<uint16> CellHeights;
+
+	FGAGridHeightQuantizer HeightQuantizer;
+
+	// Bumped whenever CellHeights is rebuilt or rewritten. Unlike GridVersion, stamps and flag changes leave it alone.
+	uint32 HeightsVersion;
+
+public:
+
+	// Versioning --------------------------------
+
+	// The grid is split into square regions of this many cells on a side, each of which remembers when it last changed.
+	// Pathing and spatial caches can compare the versions of the regions they depend on to decide whether they're stale.
+	static constexpr int32 RegionSize = 16;
+
+	// Bumped every time any cell of the grid changes
+	uint32 GetGridVersion() const { return GridVersion; }
+
+	// The grid version at which the region containing the given cell last changed
+	uint32 GetRegionVersion(const FCellRef& CellRef) const;
+
+	// The most recent grid version of any region overlapping the given cell rect
+	uint32 GetRectVersion(const FIntRect& CellRect) const;
+
+	// Call after changing the cells in CellRect (inclusive). Brings the derived data up to date with Data, then bumps the
+	// versions and fires OnCellsChanged.
+	void NotifyCellsChanged(const FIntRect& CellRect);
+
+	FGAGridCellsChangedEvent OnCellsChanged;
+
+private:
+	// Rebuild everything that is derived from Data within the given (clipped) rect
+	void RefreshDerivedData(const FIntRect& CellRect);
+
+	// Where a world-space point is, in cells from the (0, 0) corner of the grid (not rounded to a cell)
+	FVector2D GetCellSpacePosition(const FVector& Point, const FTransform& GridTransform) const;
+
+	// The actor transform, and what the batched conversions need from it
+	struct FGridTransformCache
+	{
+		FGridTransformCache() : Matrix(FMatrix::Identity), InverseMatrix(FMatrix::Identity), InvScale(FVector::OneVector), bNoRotation(true), bValid(false) {}
+
+		FTransform Transform;
+		FMatrix Matrix;
+		FMatrix InverseMatrix;
+		FVector InvScale;
+		bool bNoRotation;
+		bool bValid;
+	};
+
+	// Brings TransformCache up to date with the actor transform, if it has changed since the last call
+	const FGridTransformCache& GetTransformCache() const;
+
+	mutable FGridTransformCache TransformCache;
+
+	// Walks the cells between two cell-space points, see FGAGridLineWalk
+	bool IsCellSpaceLineTraversable(const FVector2D& Start, const FVector2D& End, FCellRef* BlockedCellOut = NULL) const;
+
+	// Stamp the cells of a shape that's already been rasterized
+	int32 AddStamp(FGAGridStamp&& Stamp);
+
+	// Add (Delta = 1) or remove (Delta = -1) a stamp's counts, then refresh its cells
+	void ApplyStamp(const FGAGridStamp& Stamp, int32 Delta);
+
+	// A cell's flags once the stamps covering it are taken into account
+	ECellData ApplyStampsToCell(int32 CellIndex, ECellData Flags) const
+	{
+		uint8 Result = uint8(Flags);
+		for (int32 Channel = 0; Channel < CellDataChannelCount; Channel++)
+		{
+			Result |= (StampFlagCounts[Channel][CellIndex] > 0) ? (1 << Channel) : 0;
+		}
+		if (StampBlockCounts[CellIndex] > 0)
+		{
+			Result &= ~uint8(ECellData::CellDataTraversable);
+		}
+		return ECellData(Result);
+	}
+
+	bool HasStampCounts() const { return StampBlockCounts.Num() == GetCellCount(); }
+
+	// CellRect clipped to the grid. Returns false if nothing is left, or Data isn't there to iterate.
+	bool ClipToGrid(const FIntRect& CellRect, FIntRect& RectOut) const
+	{
+		RectOut = FIntRect(FMath::Max(CellRect.Min.X, 0), FMath::Max(CellRect.Min.Y, 0), FMath::Min(CellRect.Max.X, XCount - 1), FMath::Min(CellRect.Max.Y, YCount - 1));
+		return (Data.Num() == GetCellCount()) && (RectOut.Min.X <= RectOut.Max.X) && (RectOut.Min.Y <= RectOut.Max.Y);
+	}
+
+	TMap<int32, FGAGridStamp> Stamps;
+
+	int32 NextStampHandle;
+
+	// How many stamps block each cell, and add each flag to it. Empty until the first stamp goes down.
+	TArray<uint16> StampBlockCounts;
+	TArray<uint16> StampFlagCounts[CellDataChannelCount];
+
+	FGAGridBitPlane TraversableBits;
+
+	FGAGridVisibilityTable VisibilityTable;
+
+	// Bumped whenever a cell's traversability changes, which also drops the visibility table
+	uint32 TraversableVersion;
+
+	// TraversableVersion when VisibilityTable was baked or loaded
+	uint32 VisibilityTableVersion;
+
+	// The bitplanes of the other flags, FlagBits[i] being flag 1 << (i + 1)
+	FGAGridBitPlane FlagBits[CellDataChannelCount - 1];
+
+	// Empty unless bBuildCostField
+	TArray<uint8> CellCosts;
+
+	FGAGridPyramid TraversablePyramid;
+
+	FGAGridClearanceField ClearanceField;
+
+	FGAGridRegionLabels RegionLabels;
+
+	uint32 GridVersion;
+
+	int32 RegionXCount;
+	int32 RegionYCount;
+	TArray<uint32> RegionVersions;
+
+	// Lent out from const queries too, hence mutable
+	mutable FGAGridMapPool MapPool;
+
+public:
+
 	// Debugging and Visualization --------------------------------
 
 	UPROPERTY(EditAnywhere)
@@ -167,10 +678,45 @@ public:
 	UPROPERTY(EditAnywhere)
 	TObjectPtr<UMaterialInterface> DebugMaterial;
 
+	// How far above and below the grid plane the debug mesh looks for ground to drape itself over
+	UPROPERTY(EditAnywhere)
+	float DebugMeshTraceDistance;
+
+	// Builds the debug mesh, draped over the ground. The mesh is cached, and is only rebuilt when the grid's size, cell
+	// scale, ground heights, the mesh's Z offset or the actor's transform change, so calling this repeatedly is cheap.
 	UFUNCTION(BlueprintCallable)
 	bool RefreshDebugMesh();
 
+	// Re-evaluates the debug texels and uploads only the rows that changed since the last call.
+	// The texture and material instance are created once and reused for as long as the grid size stays the same.
 	UFUNCTION(BlueprintCallable)
 	bool RefreshDebugTexture();
 
+private:
+
+	// Recreates the debug texture if the grid was resized, and the material instance if there isn't one yet
+	// Returns true if the texture is new and so needs a full upload
+	bool EnsureDebugTexture();
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTexture2D> DebugTexture;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UMaterialInstanceDynamic> DebugMaterialInstance;
+
+	// CPU copy of what's currently in DebugTexture, used to find the dirty rows
+	TArray<FColor> DebugTexels;
+
+	// Drops each of the debug mesh's vertices onto the ground, returning their local heights
+	void TraceDebugMeshHeights(TArray<float>& HeightsOut) const;
+
+	// What the current debug mesh section was built from, see RefreshDebugMesh
+	int32 DebugMeshXCount;
+	int32 DebugMeshYCount;
+	float DebugMeshCellScale;
+	float DebugMeshBuiltZOffset;
+	uint32 DebugMeshHeightsVersion;
+	FTransform DebugMeshBuiltTransform;
+	bool bDebugMeshBuilt;
+
 };
\ No newline at end of file
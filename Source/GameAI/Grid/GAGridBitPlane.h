@@ -0,0 +1,296 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+// One bit per grid cell, packed 64 cells to a word.
+// Each row starts on a fresh word, so row spans can be tested a word (64 cells) at a time.
+// All queries treat cells that are off the grid as clear.
+
+struct FGAGridBitPlane
+{
+	FGAGridBitPlane() : XCount(0), YCount(0), WordsPerRow(0) {}
+
+	// Neighbor mask bits, as returned by GetNeighborMask. Bit i corresponds to the offset (NeighborDX[i], NeighborDY[i]).
+	static constexpr int8 NeighborDX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+	static constexpr int8 NeighborDY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+	// Mask of just the four edge-adjacent neighbors
+	static constexpr uint8 SideNeighborsMask = (1 << 0) | (1 << 2) | (1 << 4) | (1 << 6);
+
+	// Resize and clear every bit
+	void Init(int32 XCountIn, int32 YCountIn)
+	{
+		XCount = FMath::Max(XCountIn, 0);
+		YCount = FMath::Max(YCountIn, 0);
+		WordsPerRow = FMath::DivideAndRoundUp(XCount, 64);
+		// SetNumZeroed would only clear the words it adds, and scratch planes are re-inited at the same size every update
+		Words.SetNumUninitialized(WordsPerRow * YCount, false);
+		FMemory::Memzero(Words.GetData(), Words.Num() * sizeof(uint64));
+	}
+
+	int32 GetXCount() const { return XCount; }
+	int32 GetYCount() const { return YCount; }
+	int32 GetWordsPerRow() const { return WordsPerRow; }
+
+	FORCEINLINE bool IsValidCell(int32 X, int32 Y) const
+	{
+		return (X >= 0) && (X < XCount) && (Y >= 0) && (Y < YCount);
+	}
+
+	// Note: no bounds checks on Get and Set, use IsValidCell first if in doubt
+	FORCEINLINE bool Get(int32 X, int32 Y) const
+	{
+		return (Words[Y * WordsPerRow + (X >> 6)] >> (X & 63)) & 1;
+	}
+
+	FORCEINLINE void Set(int32 X, int32 Y, bool bValue)
+	{
+		uint64& Word = Words[Y * WordsPerRow + (X >> 6)];
+		const uint64 Bit = uint64(1) << (X & 63);
+		Word = bValue ? (Word | Bit) : (Word & ~Bit);
+	}
+
+	// Raw access to the words of a row. Bits past XCount in the last word are always clear.
+	FORCEINLINE const uint64* GetRowWords(int32 Y) const { return Words.GetData() + Y * WordsPerRow; }
+	FORCEINLINE uint64* GetRowWords(int32 Y) { return Words.GetData() + Y * WordsPerRow; }
+
+	// Up to 64 bits of row Y starting at StartX, with bit 0 being StartX. Off-grid cells read as clear.
+	uint64 GetRowBits(int32 Y, int32 StartX, int32 Count = 64) const
+	{
+		if ((Y < 0) || (Y >= YCount) || (Count <= 0))
+		{
+			return 0;
+		}
+
+		uint64 Result = 0;
+		int32 Shift = 0;
+
+		// Anything left of the grid reads as zero
+		if (StartX < 0)
+		{
+			Shift = FMath::Min(-StartX, 64);
+			Count -= Shift;
+			StartX = 0;
+		}
+
+		const uint64* Row = GetRowWords(Y);
+		while ((Count > 0) && (StartX < XCount))
+		{
+			const int32 WordIndex = StartX >> 6;
+			const int32 BitIndex = StartX & 63;
+			const int32 Take = FMath::Min(Count, 64 - BitIndex);
+			uint64 Bits = Row[WordIndex] >> BitIndex;
+			if (Take < 64)
+			{
+				Bits &= (uint64(1) << Take) - 1;
+			}
+			Result |= Bits << Shift;
+			Shift += Take;
+			StartX += Take;
+			Count -= Take;
+		}
+
+		return Result;
+	}
+
+	// Set or clear the cells MinX..MaxX (inclusive) of row Y
+	void SetSpan(int32 Y, int32 MinX, int32 MaxX, bool bValue)
+	{
+		ForEachSpanWord(*this, Y, MinX, MaxX, [bValue](uint64& Word, uint64 Mask)
+		{
+			Word = bValue ? (Word | Mask) : (Word & ~Mask);
+			return true;
+		});
+	}
+
+	// True if every cell in MinX..MaxX (inclusive) of row Y is set
+	bool IsSpanAllSet(int32 Y, int32 MinX, int32 MaxX) const
+	{
+		if ((Y < 0) || (Y >= YCount) || (MinX < 0) || (MaxX >= XCount) || (MinX > MaxX))
+		{
+			return false;
+		}
+
+		bool bResult = true;
+		ForEachSpanWord(*this, Y, MinX, MaxX, [&bResult](uint64 Word, uint64 Mask)
+		{
+			bResult = (Word & Mask) == Mask;
+			return bResult;
+		});
+		return bResult;
+	}
+
+	// True if any cell in MinX..MaxX (inclusive) of row Y is set
+	bool IsSpanAnySet(int32 Y, int32 MinX, int32 MaxX) const
+	{
+		bool bResult = false;
+		ForEachSpanWord(*this, Y, MinX, MaxX, [&bResult](uint64 Word, uint64 Mask)
+		{
+			bResult = (Word & Mask) != 0;
+			return !bResult;
+		});
+		return bResult;
+	}
+
+	// Number of set cells in MinX..MaxX (inclusive) of row Y
+	int32 CountSpan(int32 Y, int32 MinX, int32 MaxX) const
+	{
+		int32 Result = 0;
+		ForEachSpanWord(*this, Y, MinX, MaxX, [&Result](uint64 Word, uint64 Mask)
+		{
+			Result += int32(FPlatformMath::CountBits(Word & Mask));
+			return true;
+		});
+		return Result;
+	}
+
+	// The first set cell in MinX..MaxX (inclusive) of row Y, or INDEX_NONE
+	int32 FindFirstSet(int32 Y, int32 MinX, int32 MaxX) const
+	{
+		return FindFirst(Y, MinX, MaxX, false);
+	}
+
+	// The first clear cell in MinX..MaxX (inclusive) of row Y, or INDEX_NONE. Off-grid cells are not reported.
+	int32 FindFirstClear(int32 Y, int32 MinX, int32 MaxX) const
+	{
+		return FindFirst(Y, MinX, MaxX, true);
+	}
+
+	// Rect versions of the above. Rects are inclusive, as elsewhere in the grid code.
+	bool IsRectAllSet(const FIntRect& Rect) const
+	{
+		if ((Rect.Min.Y > Rect.Max.Y) || (Rect.Min.X > Rect.Max.X))
+		{
+			return false;
+		}
+		for (int32 Y = Rect.Min.Y; Y <= Rect.Max.Y; Y++)
+		{
+			if (!IsSpanAllSet(Y, Rect.Min.X, Rect.Max.X))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool IsRectAnySet(const FIntRect& Rect) const
+	{
+		for (int32 Y = FMath::Max(Rect.Min.Y, 0); Y <= FMath::Min(Rect.Max.Y, YCount - 1); Y++)
+		{
+			if (IsSpanAnySet(Y, Rect.Min.X, Rect.Max.X))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int32 CountRect(const FIntRect& Rect) const
+	{
+		int32 Result = 0;
+		for (int32 Y = FMath::Max(Rect.Min.Y, 0); Y <= FMath::Min(Rect.Max.Y, YCount - 1); Y++)
+		{
+			Result += CountSpan(Y, Rect.Min.X, Rect.Max.X);
+		}
+		return Result;
+	}
+
+	// Which of the 8 neighbors of (X, Y) are set. See NeighborDX/NeighborDY for the bit order.
+	uint8 GetNeighborMask(int32 X, int32 Y) const
+	{
+		// Three cells from each of the rows above, at and below (X, Y), bit 0 being X - 1
+		const uint64 Below = GetRowBits(Y - 1, X - 1, 3);
+		const uint64 Middle = GetRowBits(Y, X - 1, 3);
+		const uint64 Above = GetRowBits(Y + 1, X - 1, 3);
+
+		uint8 Mask = 0;
+		Mask |= ((Middle >> 2) & 1) << 0;		// (+1,  0)
+		Mask |= ((Above >> 2) & 1) << 1;		// (+1, +1)
+		Mask |= ((Above >> 1) & 1) << 2;		// ( 0, +1)
+		Mask |= ((Above >> 0) & 1) << 3;		// (-1, +1)
+		Mask |= ((Middle >> 0) & 1) << 4;		// (-1,  0)
+		Mask |= ((Below >> 0) & 1) << 5;		// (-1, -1)
+		Mask |= ((Below >> 1) & 1) << 6;		// ( 0, -1)
+		Mask |= ((Below >> 2) & 1) << 7;		// (+1, -1)
+		return Mask;
+	}
+
+	// Call Func(X) for each set cell MinX..MaxX (inclusive) of row Y, in order. Clear words are skipped whole.
+	template <typename FuncType>
+	void ForEachSetInSpan(int32 Y, int32 MinX, int32 MaxX, FuncType&& Func) const
+	{
+		int32 WordIndex = FMath::Max(MinX, 0) >> 6;
+		ForEachSpanWord(*this, Y, MinX, MaxX, [&Func, &WordIndex](uint64 Word, uint64 Mask)
+		{
+			uint64 Bits = Word & Mask;
+			while (Bits != 0)
+			{
+				Func((WordIndex << 6) + int32(FPlatformMath::CountTrailingZeros64(Bits)));
+				Bits &= Bits - 1;
+			}
+			WordIndex++;
+			return true;
+		});
+	}
+
+private:
+	// Calls Func(Word, Mask) for each word touched by the span, with Mask selecting the span's bits within that word.
+	// The span is clipped to the grid. Stops early if Func returns false.
+	// Templated on the plane so the same code serves both the const and non-const queries.
+	template <typename PlaneType, typename FuncType>
+	static void ForEachSpanWord(PlaneType& Plane, int32 Y, int32 MinX, int32 MaxX, FuncType&& Func)
+	{
+		MinX = FMath::Max(MinX, 0);
+		MaxX = FMath::Min(MaxX, Plane.XCount - 1);
+		if ((Y < 0) || (Y >= Plane.YCount) || (MinX > MaxX))
+		{
+			return;
+		}
+
+		auto* Row = Plane.GetRowWords(Y);
+		const int32 FirstWord = MinX >> 6;
+		const int32 LastWord = MaxX >> 6;
+
+		for (int32 WordIndex = FirstWord; WordIndex <= LastWord; WordIndex++)
+		{
+			uint64 Mask = ~uint64(0);
+			if (WordIndex == FirstWord)
+			{
+				Mask &= ~uint64(0) << (MinX & 63);
+			}
+			if (WordIndex == LastWord)
+			{
+				Mask &= ~uint64(0) >> (63 - (MaxX & 63));
+			}
+
+			if (!Func(Row[WordIndex], Mask))
+			{
+				return;
+			}
+		}
+	}
+
+	int32 FindFirst(int32 Y, int32 MinX, int32 MaxX, bool bFindClear) const
+	{
+		int32 Result = INDEX_NONE;
+		int32 WordIndex = FMath::Max(MinX, 0) >> 6;
+		ForEachSpanWord(*this, Y, MinX, MaxX, [&Result, &WordIndex, bFindClear](uint64 Word, uint64 Mask)
+		{
+			const uint64 Bits = (bFindClear ? ~Word : Word) & Mask;
+			if (Bits != 0)
+			{
+				Result = (WordIndex << 6) + int32(FPlatformMath::CountTrailingZeros64(Bits));
+				return false;
+			}
+			WordIndex++;
+			return true;
+		});
+		return Result;
+	}
+
+	int32 XCount;
+	int32 YCount;
+	int32 WordsPerRow;
+	TArray<uint64> Words;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GAGridCellRef.generated.h"
+
+
+// A cell of a grid, by column and row. In its own header so that the grid maps can work with cells without
+// pulling in the grid actor.
+
+USTRUCT(BlueprintType)
+struct FCellRef
+{
+	GENERATED_USTRUCT_BODY()
+
+	FCellRef() : X(INDEX_NONE), Y(INDEX_NONE) {}
+	FCellRef(int32 Xin, int32 Yin) : X(Xin), Y(Yin) {}
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 X;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 Y;
+
+	bool operator==(const FCellRef& other) const {
+		return (X == other.X) && (Y == other.Y);
+	}
+
+	bool operator<(const FCellRef& other) const {
+		// Compare X values first, then Y values
+		if (X == other.X) {
+			return Y < other.Y;
+		}
+		return X < other.X;
+	}
+
+	//  Note: can't add specifiers, or call from blueprint, because UStructs
+	// don't get UFunctions in Unreal
+	bool IsValid() const
+	{
+		return (X >= 0) && (Y >= 0);
+	}
+
+	static FCellRef Invalid;
+};
@@ -0,0 +1,146 @@
+#include "GAGridClearance.h"
+
+
+namespace
+{
+	// Stands in for infinity on open cells. Big enough that it never wins against a real distance, small enough
+	// that the parabola intersections in the 1D transform don't lose all their precision.
+	constexpr double FarAway = 1.0e12;
+}
+
+
+void FGAGridClearanceField::Build(const FGAGridBitPlane& Bits)
+{
+	XCount = Bits.GetXCount();
+	YCount = Bits.GetYCount();
+	Distances.SetNumUninitialized(XCount * YCount);
+
+	if ((XCount > 0) && (YCount > 0))
+	{
+		const FIntRect GridRect(0, 0, XCount - 1, YCount - 1);
+		TransformWindow(Bits, GridRect, GridRect);
+	}
+}
+
+void FGAGridClearanceField::Refresh(const FGAGridBitPlane& Bits, const FIntRect& CellRect)
+{
+	if (!IsBuilt(Bits))
+	{
+		Build(Bits);
+		return;
+	}
+
+	// Every cell whose distance could change lies within MaxDistance of the rect, and every cell that can be the
+	// nearest blocker of one of those lies within MaxDistance of that
+	const FIntRect WriteRect(
+		FMath::Max(CellRect.Min.X - MaxDistance, 0),
+		FMath::Max(CellRect.Min.Y - MaxDistance, 0),
+		FMath::Min(CellRect.Max.X + MaxDistance, XCount - 1),
+		FMath::Min(CellRect.Max.Y + MaxDistance, YCount - 1));
+	const FIntRect Window(
+		FMath::Max(WriteRect.Min.X - MaxDistance, 0),
+		FMath::Max(WriteRect.Min.Y - MaxDistance, 0),
+		FMath::Min(WriteRect.Max.X + MaxDistance, XCount - 1),
+		FMath::Min(WriteRect.Max.Y + MaxDistance, YCount - 1));
+
+	if ((WriteRect.Min.X <= WriteRect.Max.X) && (WriteRect.Min.Y <= WriteRect.Max.Y))
+	{
+		TransformWindow(Bits, Window, WriteRect);
+	}
+}
+
+void FGAGridClearanceField::TransformWindow(const FGAGridBitPlane& Bits, const FIntRect& Window, const FIntRect& WriteRect)
+{
+	// Pad the window by a cell on each side. Padding that falls off the grid is a wall, which is what gives the
+	// grid's edge its zero distance. Padding that falls on the grid just reads the real cell.
+	const int32 Width = Window.Max.X - Window.Min.X + 3;
+	const int32 Height = Window.Max.Y - Window.Min.Y + 3;
+	const int32 OriginX = Window.Min.X - 1;
+	const int32 OriginY = Window.Min.Y - 1;
+
+	Grid.SetNumUninitialized(Width * Height);
+	for (int32 Y = 0; Y < Height; Y++)
+	{
+		for (int32 X = 0; X < Width; X++)
+		{
+			const int32 CellX = OriginX + X;
+			const int32 CellY = OriginY + Y;
+			const bool bOpen = Bits.IsValidCell(CellX, CellY) && Bits.Get(CellX, CellY);
+			Grid[Y * Width + X] = bOpen ? FarAway : 0.0;
+		}
+	}
+
+	const int32 MaxLength = FMath::Max(Width, Height);
+	LineIn.SetNumUninitialized(MaxLength);
+	LineOut.SetNumUninitialized(MaxLength);
+	Parabolas.SetNumUninitialized(MaxLength);
+	Boundaries.SetNumUninitialized(MaxLength + 1);
+
+	// Columns first
+	for (int32 X = 0; X < Width; X++)
+	{
+		for (int32 Y = 0; Y < Height; Y++)
+		{
+			LineIn[Y] = Grid[Y * Width + X];
+		}
+		Transform1D(LineIn.GetData(), Height, LineOut.GetData());
+		for (int32 Y = 0; Y < Height; Y++)
+		{
+			Grid[Y * Width + X] = LineOut[Y];
+		}
+	}
+
+	// Then rows, but only the ones we're going to write
+	const float Cap = float(MaxDistance);
+	for (int32 CellY = WriteRect.Min.Y; CellY <= WriteRect.Max.Y; CellY++)
+	{
+		const double* Row = Grid.GetData() + (CellY - OriginY) * Width;
+		Transform1D(Row, Width, LineOut.GetData());
+
+		float* OutRow = Distances.GetData() + CellY * XCount;
+		for (int32 CellX = WriteRect.Min.X; CellX <= WriteRect.Max.X; CellX++)
+		{
+			OutRow[CellX] = FMath::Min(float(FMath::Sqrt(LineOut[CellX - OriginX])), Cap);
+		}
+	}
+}
+
+void FGAGridClearanceField::Transform1D(const double* F, int32 N, double* D)
+{
+	int32* V = Parabolas.GetData();
+	double* Z = Boundaries.GetData();
+
+	// Build the lower envelope of the parabolas rooted at each sample
+	int32 K = 0;
+	V[0] = 0;
+	Z[0] = TNumericLimits<double>::Lowest();
+	Z[1] = TNumericLimits<double>::Max();
+
+	for (int32 Q = 1; Q < N; Q++)
+	{
+		// Where the new parabola crosses the rightmost one in the envelope. Anything it hides gets dropped.
+		double S = ((F[Q] + double(Q) * Q) - (F[V[K]] + double(V[K]) * V[K])) / (2.0 * (Q - V[K]));
+		while (S <= Z[K])
+		{
+			K--;
+			S = ((F[Q] + double(Q) * Q) - (F[V[K]] + double(V[K]) * V[K])) / (2.0 * (Q - V[K]));
+		}
+
+		K++;
+		V[K] = Q;
+		Z[K] = S;
+		Z[K + 1] = TNumericLimits<double>::Max();
+	}
+
+	// Then read it back
+	K = 0;
+	for (int32 Q = 0; Q < N; Q++)
+	{
+		while (Z[K + 1] < Q)
+		{
+			K++;
+		}
+		const double Delta = double(Q - V[K]);
+		D[Q] = Delta * Delta + F[V[K]];
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GAGridBitPlane.h"
+
+
+// Euclidean distance transform over a traversability bit plane.
+// Each cell stores the distance (in cells, center to center) to the nearest non-traversable cell, capped at
+// MaxDistance. Non-traversable cells are 0, and everything off the grid counts as non-traversable.
+//
+// Built with the separable lower-envelope-of-parabolas algorithm (Felzenszwalb & Huttenlocher), which is linear
+// in the number of cells. Because of the cap, a change to a rect of cells can only affect distances within
+// MaxDistance of it, so Refresh only recomputes that neighborhood and the result is still exact.
+
+struct FGAGridClearanceField
+{
+	static constexpr int32 MaxDistance = 16;
+
+	void Build(const FGAGridBitPlane& Bits);
+
+	// Recompute the distances that could have been affected by changes to the (inclusive) rect
+	void Refresh(const FGAGridBitPlane& Bits, const FIntRect& CellRect);
+
+	bool IsBuilt(const FGAGridBitPlane& Bits) const
+	{
+		return (XCount == Bits.GetXCount()) && (YCount == Bits.GetYCount()) && (Distances.Num() == XCount * YCount);
+	}
+
+	// No bounds checks, see IsBuilt
+	FORCEINLINE float GetDistance(int32 X, int32 Y) const { return Distances[Y * XCount + X]; }
+
+private:
+	// Transform the window (inclusive rect of cells), writing results for the cells of WriteRect
+	void TransformWindow(const FGAGridBitPlane& Bits, const FIntRect& Window, const FIntRect& WriteRect);
+
+	// 1D squared distance transform of N samples of F (Felzenszwalb & Huttenlocher), into D
+	void Transform1D(const double* F, int32 N, double* D);
+
+	int32 XCount = 0;
+	int32 YCount = 0;
+	TArray<float> Distances;
+
+	// Scratch
+	TArray<double> Grid;
+	TArray<double> LineIn;
+	TArray<double> LineOut;
+	TArray<int32> Parabolas;
+	TArray<double> Boundaries;
+};
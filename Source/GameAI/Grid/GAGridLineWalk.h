@@ -0,0 +1,84 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+// Exact cell-by-cell walk along a line segment, after Amanatides & Woo, "A Fast Voxel Traversal Algorithm".
+// Coordinates are in cells, i.e. cell (X, Y) covers [X, X + 1) x [Y, Y + 1).
+//
+// Every cell the segment passes through is visited once, in order from From to To. Where the segment passes exactly
+// through the corner of a cell (e.g. diagonals between cell centers), both cells beside the corner get visited too,
+// so a line can't slip between two diagonally touching blocked cells.
+
+struct FGAGridLineWalk
+{
+	// Calls Func(X, Y) for each cell, stopping as soon as Func returns false.
+	// Returns true if the walk got all the way to To's cell.
+	template <typename FuncType>
+	static bool Walk(const FVector2D& From, const FVector2D& To, FuncType&& Func)
+	{
+		int32 X = FMath::FloorToInt32(From.X);
+		int32 Y = FMath::FloorToInt32(From.Y);
+		const int32 EndX = FMath::FloorToInt32(To.X);
+		const int32 EndY = FMath::FloorToInt32(To.Y);
+
+		if (!Func(X, Y))
+		{
+			return false;
+		}
+
+		const double DX = To.X - From.X;
+		const double DY = To.Y - From.Y;
+		const int32 StepX = (EndX > X) ? 1 : ((EndX < X) ? -1 : 0);
+		const int32 StepY = (EndY > Y) ? 1 : ((EndY < Y) ? -1 : 0);
+
+		// TMax is how far along the segment (0..1) the next cell boundary on that axis is, TDelta how far apart they are
+		const double Never = TNumericLimits<double>::Max();
+		const double TDeltaX = (StepX != 0) ? 1.0 / FMath::Abs(DX) : Never;
+		const double TDeltaY = (StepY != 0) ? 1.0 / FMath::Abs(DY) : Never;
+		double TMaxX = (StepX > 0) ? (double(X + 1) - From.X) / DX : ((StepX < 0) ? (From.X - double(X)) / -DX : Never);
+		double TMaxY = (StepY > 0) ? (double(Y + 1) - From.Y) / DY : ((StepY < 0) ? (From.Y - double(Y)) / -DY : Never);
+
+		// Counting the boundaries still to cross on each axis, rather than comparing against the end cell, keeps rounding
+		// from overshooting
+		int32 RemainingX = FMath::Abs(EndX - X);
+		int32 RemainingY = FMath::Abs(EndY - Y);
+
+		while ((RemainingX > 0) || (RemainingY > 0))
+		{
+			if ((RemainingX > 0) && (RemainingY > 0) && (TMaxX == TMaxY))
+			{
+				// Straight through a corner
+				if (!Func(X + StepX, Y) || !Func(X, Y + StepY))
+				{
+					return false;
+				}
+				X += StepX;
+				Y += StepY;
+				TMaxX += TDeltaX;
+				TMaxY += TDeltaY;
+				RemainingX--;
+				RemainingY--;
+			}
+			else if ((RemainingY == 0) || ((RemainingX > 0) && (TMaxX < TMaxY)))
+			{
+				X += StepX;
+				TMaxX += TDeltaX;
+				RemainingX--;
+			}
+			else
+			{
+				Y += StepY;
+				TMaxY += TDeltaY;
+				RemainingY--;
+			}
+
+			if (!Func(X, Y))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
@@ -1,7 +1,8 @@
 #include "GAGridMap.h"
 #include "GAGridActor.h"
-
-UE_DISABLE_OPTIMIZATION
+#include "GAGridBitPlane.h"
+#include "GAGridMapKernels.h"
+#include "Async/ParallelFor.h"
 
 // --------------------- FGridBox ---------------------
 
@@ -13,6 +14,40 @@ bool FGridBox::IsValidCell(const FCellRef& Cell) const
 
 // --------------------- FGAGridMap ---------------------
 
+namespace
+{
+	// The smallest box holding both. Either may be invalid (empty).
+	FGridBox UnionBoxes(const FGridBox& A, const FGridBox& B)
+	{
+		if (!A.IsValid())
+		{
+			return B;
+		}
+		if (!B.IsValid())
+		{
+			return A;
+		}
+		return FGridBox(FMath::Min(A.MinX, B.MinX), FMath::Max(A.MaxX, B.MaxX), FMath::Min(A.MinY, B.MinY), FMath::Max(A.MaxY, B.MaxY));
+	}
+
+	// Is every cell of Inner (which may be empty) in Outer?
+	bool ContainsBox(const FGridBox& Outer, const FGridBox& Inner)
+	{
+		return !Inner.IsValid() || ((Inner.MinX >= Outer.MinX) && (Inner.MaxX <= Outer.MaxX) && (Inner.MinY >= Outer.MinY) && (Inner.MaxY <= Outer.MaxY));
+	}
+
+	// Grow Bounds to take in the values of a run (starting at cell X, Y) that aren't DefaultValue
+	FORCEINLINE void AddLiveCells(FGridBox& Bounds, const float* Values, int32 Count, int32 X, int32 Y, float DefaultValue)
+	{
+		int32 First, Last;
+		if (FGAGridMapKernels::FindNotEqual(Values, Count, DefaultValue, First, Last))
+		{
+			Bounds = UnionBoxes(Bounds, FGridBox(X + First, X + Last, Y, Y));
+		}
+	}
+}
+
+
 FGAGridMap::FGAGridMap() : XCount(INDEX_NONE), YCount(INDEX_NONE), GridBounds()
 {
 	// we are empty
@@ -48,7 +83,15 @@ FGAGridMap::FGAGridMap(const AGAGridActor* Grid, const FGridBox& GridBoxIn, floa
 
 void FGAGridMap::ResetData(float InitialValue)
 {
-	if (GridBounds.IsValid())
+	DefaultValue = InitialValue;
+	ActiveBounds = FGridBox();
+
+	if (bChunked)
+	{
+		Data.Empty();
+		ResetChunks();
+	}
+	else if (GridBounds.IsValid())
 	{
 		int32 BoxWidth = GridBounds.GetWidth();
 		int32 BoxHeight = GridBounds.GetHeight();
@@ -57,19 +100,82 @@ void FGAGridMap::ResetData(float InitialValue)
 		check(BoxHeight > 0);
 
 		int32 CellCount = BoxWidth * BoxHeight;
-		Data.SetNum(CellCount);
+		Data.SetNumUninitialized(CellCount);
+		FGAGridMapKernels::Fill(Data.GetData(), CellCount, InitialValue);
+	}
+	else
+	{
+		Data.Empty();
+	}
+}
+
+
+void FGAGridMap::ResetChunks()
+{
+	if (GridBounds.IsValid())
+	{
+		ChunkXCount = FMath::DivideAndRoundUp(GridBounds.GetWidth(), ChunkSize);
+		ChunkYCount = FMath::DivideAndRoundUp(GridBounds.GetHeight(), ChunkSize);
+	}
+	else
+	{
+		ChunkXCount = 0;
+		ChunkYCount = 0;
+	}
 
-		for (int32 Index = 0; Index < CellCount; Index++)
+	Chunks.Reset();
+	Chunks.SetNum(ChunkXCount * ChunkYCount);
+	ChunkLiveCounts.Reset();
+	ChunkLiveCounts.SetNumZeroed(ChunkXCount * ChunkYCount);
+}
+
+void FGAGridMap::SetChunked(bool bChunkedIn)
+{
+	if (bChunkedIn == bChunked)
+	{
+		return;
+	}
+
+	// Grab the current values, switch over, then write them back
+	TArray<float> Values;
+	const bool bHadValues = IsValid();
+	if (bHadValues)
+	{
+		Values.SetNumUninitialized(GridBounds.GetCellCount());
+		for (int32 Y = 0; Y < GridBounds.GetHeight(); Y++)
 		{
-			Data[Index] = InitialValue;
+			for (int32 X = 0; X < GridBounds.GetWidth(); X++)
+			{
+				GetValue(FCellRef(X + GridBounds.MinX, Y + GridBounds.MinY), Values[Y * GridBounds.GetWidth() + X]);
+			}
 		}
 	}
-	else
+
+	bChunked = bChunkedIn;
+	ResetData(DefaultValue);
+
+	if (bHadValues)
 	{
-		Data.Empty();
+		for (int32 Y = 0; Y < GridBounds.GetHeight(); Y++)
+		{
+			for (int32 X = 0; X < GridBounds.GetWidth(); X++)
+			{
+				SetValue(FCellRef(X + GridBounds.MinX, Y + GridBounds.MinY), Values[Y * GridBounds.GetWidth() + X]);
+			}
+		}
 	}
 }
 
+int32 FGAGridMap::GetAllocatedChunkCount() const
+{
+	int32 Result = 0;
+	for (const TArray<float>& Chunk : Chunks)
+	{
+		Result += (Chunk.Num() > 0) ? 1 : 0;
+	}
+	return Result;
+}
+
 
 bool FGAGridMap::CellRefToLocal(const FCellRef& Cell, int32& X, int32& Y) const
 {
@@ -99,6 +205,13 @@ bool FGAGridMap::GetValue(const FCellRef& Cell, float &ValueOut) const
 	int32 X, Y;
 	if (CellRefToLocal(Cell, X, Y))
 	{
+		if (bChunked)
+		{
+			const TArray<float>& Chunk = Chunks[GetChunkIndex(X, Y)];
+			ValueOut = (Chunk.Num() > 0) ? Chunk[GetIndexInChunk(X, Y)] : DefaultValue;
+			return true;
+		}
+
 		int32 Index = GridBounds.GetWidth()* Y + X;
 		check(Data.IsValidIndex(Index));
 		ValueOut = Data[Index];
@@ -111,10 +224,14 @@ bool FGAGridMap::GetMaxValue(float& MaxValueOut) const
 {
 	if (IsValid())
 	{
-		MaxValueOut = -UE_MAX_FLT;
-		for (int32 Index = 0; Index < Data.Num(); Index++)
+		// Everything outside the active bounds is DefaultValue
+		MaxValueOut = ContainsBox(ActiveBounds, GridBounds) ? -UE_MAX_FLT : DefaultValue;
+		if (ActiveBounds.IsValid())
 		{
-			MaxValueOut = FMath::Max(MaxValueOut, Data[Index]);
+			ReadRuns(ActiveBounds, [&MaxValueOut](const float* Values, int32 Count, int32 X, int32 Y)
+			{
+				MaxValueOut = FMath::Max(MaxValueOut, FGAGridMapKernels::Max(Values, Count));
+			});
 		}
 		return true;
 	}
@@ -127,6 +244,44 @@ bool FGAGridMap::SetValue(const FCellRef& Cell, float Value)
 	int32 X, Y;
 	if (CellRefToLocal(Cell, X, Y))
 	{
+		if (Value != DefaultValue)
+		{
+			ActiveBounds = UnionBoxes(ActiveBounds, FGridBox(Cell.X, Cell.X, Cell.Y, Cell.Y));
+		}
+
+		if (bChunked)
+		{
+			const int32 ChunkIndex = GetChunkIndex(X, Y);
+			TArray<float>& Chunk = Chunks[ChunkIndex];
+			if (Chunk.Num() == 0)
+			{
+				if (Value == DefaultValue)
+				{
+					// Nothing to do, and no reason to allocate
+					return true;
+				}
+				Chunk.Init(DefaultValue, ChunkSize * ChunkSize);
+			}
+
+			float& CellValue = Chunk[GetIndexInChunk(X, Y)];
+			const bool bWasDefault = (CellValue == DefaultValue);
+			const bool bIsDefault = (Value == DefaultValue);
+			CellValue = Value;
+
+			if (bWasDefault && !bIsDefault)
+			{
+				ChunkLiveCounts[ChunkIndex]++;
+			}
+			else if (!bWasDefault && bIsDefault)
+			{
+				if (--ChunkLiveCounts[ChunkIndex] == 0)
+				{
+					Chunk.Empty();
+				}
+			}
+			return true;
+		}
+
 		int32 Index = GridBounds.GetWidth()* Y + X;
 		check(Data.IsValidIndex(Index));
 		Data[Index] = Value;
@@ -135,5 +290,610 @@ bool FGAGridMap::SetValue(const FCellRef& Cell, float Value)
 	return false;
 }
 
+void FGAGridMap::GetRowValues(int32 Y, int32 MinX, int32 Count, float* ValuesOut) const
+{
+	check((Y >= GridBounds.MinY) && (Y <= GridBounds.MaxY) && (MinX >= GridBounds.MinX) && (MinX + Count - 1 <= GridBounds.MaxX));
+
+	if (!bChunked)
+	{
+		FMemory::Memcpy(ValuesOut, Data.GetData() + (Y - GridBounds.MinY) * GridBounds.GetWidth() + (MinX - GridBounds.MinX), Count * sizeof(float));
+		return;
+	}
+
+	ReadRuns(FGridBox(MinX, MinX + Count - 1, Y, Y), [ValuesOut, MinX](const float* Values, int32 RunCount, int32 X, int32 RunY)
+	{
+		FMemory::Memcpy(ValuesOut + (X - MinX), Values, RunCount * sizeof(float));
+	});
+}
+
+void FGAGridMap::SetRowValues(int32 Y, int32 MinX, int32 Count, const float* Values)
+{
+	check((Y >= GridBounds.MinY) && (Y <= GridBounds.MaxY) && (MinX >= GridBounds.MinX) && (MinX + Count - 1 <= GridBounds.MaxX));
+
+	ModifyRuns(FGridBox(MinX, MinX + Count - 1, Y, Y), [Values, MinX](float* RunValues, int32 RunCount, int32 X, int32 RunY)
+	{
+		FMemory::Memcpy(RunValues, Values + (X - MinX), RunCount * sizeof(float));
+	});
+}
+
+
+// --------------------- Whole-map operations ---------------------
+
+namespace
+{
+	// Scratch for a run's mask bits. Runs are at most a row, and rows of up to 512 cells fit without touching the heap.
+	typedef TArray<uint64, TInlineAllocator<8>> FMaskWords;
+
+	// Mask bits for Count cells of row Y starting at X, in the layout FGAGridMapKernels expects. NULL if there's no mask.
+	const uint64* GetMaskWords(const FGAGridBitPlane* Mask, int32 X, int32 Y, int32 Count, FMaskWords& WordsOut)
+	{
+		if (Mask == NULL)
+		{
+			return NULL;
+		}
+
+		WordsOut.SetNumUninitialized(FMath::DivideAndRoundUp(Count, 64), false);
+		for (int32 Index = 0; Index < WordsOut.Num(); Index++)
+		{
+			WordsOut[Index] = Mask->GetRowBits(Y, X + (Index << 6), FMath::Min(64, Count - (Index << 6)));
+		}
+		return WordsOut.GetData();
+	}
+}
+
+bool FGAGridMap::ClipBox(const FGridBox& Box, FGridBox& BoxOut) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	if (!Box.IsValid())
+	{
+		BoxOut = GridBounds;
+		return true;
+	}
+
+	BoxOut = FGridBox(FMath::Max(Box.MinX, GridBounds.MinX), FMath::Min(Box.MaxX, GridBounds.MaxX), FMath::Max(Box.MinY, GridBounds.MinY), FMath::Min(Box.MaxY, GridBounds.MaxY));
+	return BoxOut.IsValid();
+}
+
+bool FGAGridMap::ClipOperationBox(const FGridBox& Box, bool bKeepsDefault, const FGridBox& Active, FGridBox& BoxOut) const
+{
+	if (!ClipBox(Box, BoxOut))
+	{
+		return false;
+	}
+
+	if (bKeepsDefault)
+	{
+		if (!Active.IsValid())
+		{
+			return false;
+		}
+		BoxOut = FGridBox(FMath::Max(BoxOut.MinX, Active.MinX), FMath::Min(BoxOut.MaxX, Active.MaxX), FMath::Max(BoxOut.MinY, Active.MinY), FMath::Min(BoxOut.MaxY, Active.MaxY));
+	}
+	return BoxOut.IsValid();
+}
+
+template <typename FuncType>
+void FGAGridMap::ModifyRuns(const FGridBox& Box, FuncType&& Func)
+{
+	// Local (relative to GridBounds) version of the box
+	const int32 MinX = Box.MinX - GridBounds.MinX;
+	const int32 MaxX = Box.MaxX - GridBounds.MinX;
+	const int32 MinY = Box.MinY - GridBounds.MinY;
+	const int32 MaxY = Box.MaxY - GridBounds.MinY;
+
+	// The cells in the box that aren't DefaultValue once Func is done with them
+	FGridBox LiveBounds;
+
+	if (!bChunked)
+	{
+		const int32 Width = GridBounds.GetWidth();
+		for (int32 Y = MinY; Y <= MaxY; Y++)
+		{
+			float* Values = Data.GetData() + Y * Width + MinX;
+			Func(Values, (MaxX - MinX) + 1, Box.MinX, Y + GridBounds.MinY);
+			AddLiveCells(LiveBounds, Values, (MaxX - MinX) + 1, Box.MinX, Y + GridBounds.MinY, DefaultValue);
+		}
+	}
+	else
+	{
+		ModifyChunkRuns(MinX, MaxX, MinY, MaxY, LiveBounds, Func);
+	}
+
+	MergeActiveBounds(Box, LiveBounds);
+}
+
+template <typename FuncType>
+void FGAGridMap::ModifyChunkRuns(int32 MinX, int32 MaxX, int32 MinY, int32 MaxY, FGridBox& LiveBounds, FuncType&& Func)
+{
+	float DefaultRun[ChunkSize];
+
+	for (int32 ChunkY = MinY >> ChunkShift; ChunkY <= (MaxY >> ChunkShift); ChunkY++)
+	{
+		const int32 ChunkMinY = FMath::Max(MinY, ChunkY << ChunkShift);
+		const int32 ChunkMaxY = FMath::Min(MaxY, ((ChunkY + 1) << ChunkShift) - 1);
+
+		for (int32 ChunkX = MinX >> ChunkShift; ChunkX <= (MaxX >> ChunkShift); ChunkX++)
+		{
+			const int32 ChunkMinX = FMath::Max(MinX, ChunkX << ChunkShift);
+			const int32 Count = FMath::Min(MaxX, ((ChunkX + 1) << ChunkShift) - 1) - ChunkMinX + 1;
+			const int32 ChunkIndex = ChunkY * ChunkXCount + ChunkX;
+			TArray<float>& Chunk = Chunks[ChunkIndex];
+
+			for (int32 Y = ChunkMinY; Y <= ChunkMaxY; Y++)
+			{
+				if (Chunk.Num() > 0)
+				{
+					float* Values = Chunk.GetData() + GetIndexInChunk(ChunkMinX, Y);
+					Func(Values, Count, ChunkMinX + GridBounds.MinX, Y + GridBounds.MinY);
+					AddLiveCells(LiveBounds, Values, Count, ChunkMinX + GridBounds.MinX, Y + GridBounds.MinY, DefaultValue);
+					continue;
+				}
+
+				// Run the operation on default values, and only allocate the chunk if that changed any of them
+				FGAGridMapKernels::Fill(DefaultRun, Count, DefaultValue);
+				Func(DefaultRun, Count, ChunkMinX + GridBounds.MinX, Y + GridBounds.MinY);
+				if (FGAGridMapKernels::IsAnyNotEqual(DefaultRun, Count, DefaultValue))
+				{
+					Chunk.Init(DefaultValue, ChunkSize * ChunkSize);
+					FMemory::Memcpy(Chunk.GetData() + GetIndexInChunk(ChunkMinX, Y), DefaultRun, Count * sizeof(float));
+					AddLiveCells(LiveBounds, DefaultRun, Count, ChunkMinX + GridBounds.MinX, Y + GridBounds.MinY, DefaultValue);
+				}
+			}
+
+			// Recount the live cells, and free the chunk if they all went back to DefaultValue
+			if (Chunk.Num() > 0)
+			{
+				int32 LiveCount = 0;
+				for (const float Value : Chunk)
+				{
+					LiveCount += (Value != DefaultValue) ? 1 : 0;
+				}
+
+				ChunkLiveCounts[ChunkIndex] = uint16(LiveCount);
+				if (LiveCount == 0)
+				{
+					Chunk.Empty();
+				}
+			}
+		}
+	}
+}
+
+template <typename FuncType>
+void FGAGridMap::ReadRuns(const FGridBox& Box, FuncType&& Func) const
+{
+	const int32 MinX = Box.MinX - GridBounds.MinX;
+	const int32 MaxX = Box.MaxX - GridBounds.MinX;
+	const int32 MinY = Box.MinY - GridBounds.MinY;
+	const int32 MaxY = Box.MaxY - GridBounds.MinY;
+
+	if (!bChunked)
+	{
+		const int32 Width = GridBounds.GetWidth();
+		for (int32 Y = MinY; Y <= MaxY; Y++)
+		{
+			Func(Data.GetData() + Y * Width + MinX, (MaxX - MinX) + 1, Box.MinX, Y + GridBounds.MinY);
+		}
+		return;
+	}
+
+	float DefaultRun[ChunkSize];
+	FGAGridMapKernels::Fill(DefaultRun, ChunkSize, DefaultValue);
+
+	for (int32 ChunkY = MinY >> ChunkShift; ChunkY <= (MaxY >> ChunkShift); ChunkY++)
+	{
+		const int32 ChunkMinY = FMath::Max(MinY, ChunkY << ChunkShift);
+		const int32 ChunkMaxY = FMath::Min(MaxY, ((ChunkY + 1) << ChunkShift) - 1);
+
+		for (int32 ChunkX = MinX >> ChunkShift; ChunkX <= (MaxX >> ChunkShift); ChunkX++)
+		{
+			const int32 ChunkMinX = FMath::Max(MinX, ChunkX << ChunkShift);
+			const int32 Count = FMath::Min(MaxX, ((ChunkX + 1) << ChunkShift) - 1) - ChunkMinX + 1;
+			const TArray<float>& Chunk = Chunks[ChunkY * ChunkXCount + ChunkX];
+
+			for (int32 Y = ChunkMinY; Y <= ChunkMaxY; Y++)
+			{
+				const float* Values = (Chunk.Num() > 0) ? Chunk.GetData() + GetIndexInChunk(ChunkMinX, Y) : DefaultRun;
+				Func(Values, Count, ChunkMinX + GridBounds.MinX, Y + GridBounds.MinY);
+			}
+		}
+	}
+}
+
+template <typename FuncType>
+void FGAGridMap::ModifyRunsWith(const FGAGridMap& Other, const FGridBox& Box, FuncType&& Func)
+{
+	TArray<float, TInlineAllocator<512>> OtherValues;
+	OtherValues.SetNumUninitialized(Box.GetWidth());
+
+	ModifyRuns(Box, [&Other, &OtherValues, &Func](float* Values, int32 Count, int32 X, int32 Y)
+	{
+		Other.GetRowValues(Y, X, Count, OtherValues.GetData());
+		Func(Values, OtherValues.GetData(), Count, X, Y);
+	});
+}
+
+void FGAGridMap::RecomputeActiveBounds(const FGridBox& Box)
+{
+	if (!IsValid())
+	{
+		ActiveBounds = FGridBox();
+		return;
+	}
+
+	FGridBox Clipped;
+	if (ClipBox(Box, Clipped))
+	{
+		FGridBox LiveBounds;
+		ReadRuns(Clipped, [this, &LiveBounds](const float* Values, int32 Count, int32 X, int32 Y)
+		{
+			AddLiveCells(LiveBounds, Values, Count, X, Y, DefaultValue);
+		});
+		MergeActiveBounds(Clipped, LiveBounds);
+	}
+}
+
+void FGAGridMap::MergeActiveBounds(const FGridBox& Box, const FGridBox& LiveBounds)
+{
+	// If the box covered all of the old active bounds, what's live in it is all there is; otherwise it adds to them
+	ActiveBounds = ContainsBox(Box, ActiveBounds) ? LiveBounds : UnionBoxes(ActiveBounds, LiveBounds);
+}
+
+void FGAGridMap::Fill(float Value, const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	FGridBox Clipped;
+	if (ClipOperationBox(Box, Value == DefaultValue, ActiveBounds, Clipped))
+	{
+		FMaskWords MaskWords;
+		ModifyRuns(Clipped, [&](float* Values, int32 Count, int32 X, int32 Y)
+		{
+			FGAGridMapKernels::Fill(Values, Count, Value, GetMaskWords(Mask, X, Y, Count, MaskWords));
+		});
+	}
+}
+
+void FGAGridMap::Add(float Value, const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	FGridBox Clipped;
+	if (ClipOperationBox(Box, DefaultValue + Value == DefaultValue, ActiveBounds, Clipped))
+	{
+		FMaskWords MaskWords;
+		ModifyRuns(Clipped, [&](float* Values, int32 Count, int32 X, int32 Y)
+		{
+			FGAGridMapKernels::AddScalar(Values, Count, Value, GetMaskWords(Mask, X, Y, Count, MaskWords));
+		});
+	}
+}
+
+void FGAGridMap::Scale(float Factor, const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	FGridBox Clipped;
+	if (ClipOperationBox(Box, DefaultValue * Factor == DefaultValue, ActiveBounds, Clipped))
+	{
+		FMaskWords MaskWords;
+		ModifyRuns(Clipped, [&](float* Values, int32 Count, int32 X, int32 Y)
+		{
+			FGAGridMapKernels::Scale(Values, Count, Factor, GetMaskWords(Mask, X, Y, Count, MaskWords));
+		});
+	}
+}
+
+void FGAGridMap::Clamp(float MinValue, float MaxValue, const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	FGridBox Clipped;
+	if (ClipOperationBox(Box, FMath::Clamp(DefaultValue, MinValue, MaxValue) == DefaultValue, ActiveBounds, Clipped))
+	{
+		FMaskWords MaskWords;
+		ModifyRuns(Clipped, [&](float* Values, int32 Count, int32 X, int32 Y)
+		{
+			FGAGridMapKernels::Clamp(Values, Count, MinValue, MaxValue, GetMaskWords(Mask, X, Y, Count, MaskWords));
+		});
+	}
+}
+
+void FGAGridMap::Add(const FGAGridMap& Other, float Factor, const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	// Where neither map has anything live, this adds Other's default value
+	const bool bKeepsDefault = (DefaultValue + Other.DefaultValue * Factor == DefaultValue);
+
+	FGridBox Clipped;
+	if (ClipOperationBox(Box, bKeepsDefault, UnionBoxes(ActiveBounds, Other.ActiveBounds), Clipped) && Other.ClipBox(Clipped, Clipped))
+	{
+		FMaskWords MaskWords;
+		ModifyRunsWith(Other, Clipped, [&](float* Values, const float* Others, int32 Count, int32 X, int32 Y)
+		{
+			FGAGridMapKernels::Add(Values, Others, Count, Factor, GetMaskWords(Mask, X, Y, Count, MaskWords));
+		});
+	}
+}
+
+void FGAGridMap::Multiply(const FGAGridMap& Other, const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	// Zero stays zero whatever Other holds; otherwise it's down to Other's default value
+	const bool bKeepsDefault = (DefaultValue * Other.DefaultValue == DefaultValue);
+	const FGridBox Active = (DefaultValue == 0.0f) ? ActiveBounds : UnionBoxes(ActiveBounds, Other.ActiveBounds);
+
+	FGridBox Clipped;
+	if (ClipOperationBox(Box, bKeepsDefault, Active, Clipped) && Other.ClipBox(Clipped, Clipped))
+	{
+		FMaskWords MaskWords;
+		ModifyRunsWith(Other, Clipped, [&](float* Values, const float* Others, int32 Count, int32 X, int32 Y)
+		{
+			FGAGridMapKernels::Multiply(Values, Others, Count, GetMaskWords(Mask, X, Y, Count, MaskWords));
+		});
+	}
+}
+
+void FGAGridMap::Lerp(const FGAGridMap& Other, float Alpha, const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	const bool bKeepsDefault = (DefaultValue + (Other.DefaultValue - DefaultValue) * Alpha == DefaultValue);
+
+	FGridBox Clipped;
+	if (ClipOperationBox(Box, bKeepsDefault, UnionBoxes(ActiveBounds, Other.ActiveBounds), Clipped) && Other.ClipBox(Clipped, Clipped))
+	{
+		FMaskWords MaskWords;
+		ModifyRunsWith(Other, Clipped, [&](float* Values, const float* Others, int32 Count, int32 X, int32 Y)
+		{
+			FGAGridMapKernels::Lerp(Values, Others, Count, Alpha, GetMaskWords(Mask, X, Y, Count, MaskWords));
+		});
+	}
+}
+
+float FGAGridMap::Sum(const FGAGridBitPlane* Mask, const FGridBox& Box) const
+{
+	double Result = 0.0;
+
+	// Default values only add to the sum if they aren't 0
+	FGridBox Clipped;
+	if (ClipOperationBox(Box, DefaultValue == 0.0f, ActiveBounds, Clipped))
+	{
+		FMaskWords MaskWords;
+		ReadRuns(Clipped, [&](const float* Values, int32 Count, int32 X, int32 Y)
+		{
+			Result += FGAGridMapKernels::Sum(Values, Count, GetMaskWords(Mask, X, Y, Count, MaskWords));
+		});
+	}
+	return float(Result);
+}
+
+bool FGAGridMap::Normalize(const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	const float Total = Sum(Mask, Box);
+	if (Total == 0.0f)
+	{
+		return false;
+	}
+
+	Scale(1.0f / Total, Mask, Box);
+	return true;
+}
+
+bool FGAGridMap::ArgMax(FCellRef& CellOut, float& ValueOut, const FGAGridBitPlane* Mask, const FGridBox& Box) const
+{
+	FGridBox Clipped;
+	if (!ClipBox(Box, Clipped))
+	{
+		return false;
+	}
+
+	FMaskWords MaskWords;
+	auto FindMax = [&](const FGridBox& SearchBox)
+	{
+		bool bFound = false;
+		ReadRuns(SearchBox, [&](const float* Values, int32 Count, int32 X, int32 Y)
+		{
+			const int32 Index = FGAGridMapKernels::ArgMax(Values, Count, GetMaskWords(Mask, X, Y, Count, MaskWords));
+			if ((Index != INDEX_NONE) && (!bFound || (Values[Index] > ValueOut)))
+			{
+				bFound = true;
+				ValueOut = Values[Index];
+				CellOut = FCellRef(X + Index, Y);
+			}
+		});
+		return bFound;
+	};
+
+	// Look inside the active bounds first. Anything bigger than DefaultValue there beats every cell outside them,
+	// otherwise (or on a tie) the whole box has to be searched to get the same answer.
+	FGridBox ActiveBox;
+	if (!ContainsBox(ActiveBounds, Clipped) && ClipOperationBox(Clipped, true, ActiveBounds, ActiveBox))
+	{
+		if (FindMax(ActiveBox) && (ValueOut > DefaultValue))
+		{
+			return true;
+		}
+	}
+	return FindMax(Clipped);
+}
+
+
+// --------------------- Convolution ---------------------
+
+namespace
+{
+	// Convolve each row of a Width x Height block of values with Kernel, a run of Selected cells at a time (all of the
+	// row if Selected is NULL). Cells that aren't selected are copied across as they are.
+	void ConvolveRows(const float* Values, const uint8* Selected, int32 Width, int32 Height, TConstArrayView<float> Kernel, bool bParallel, float* ValuesOut)
+	{
+		const int32 Radius = Kernel.Num() / 2;
+
+		ParallelFor(Height, [=](int32 Row)
+		{
+			const float* RowValues = Values + Row * Width;
+			float* RowOut = ValuesOut + Row * Width;
+
+			if (Selected == NULL)
+			{
+				FGAGridMapKernels::Convolve(RowValues, Width, Kernel.GetData(), Radius, RowOut);
+				return;
+			}
 
-UE_DISABLE_OPTIMIZATION
+			const uint8* RowSelected = Selected + Row * Width;
+			int32 X = 0;
+			while (X < Width)
+			{
+				const int32 RunStart = X;
+				const uint8 bRunSelected = RowSelected[X];
+				while ((X < Width) && (RowSelected[X] == bRunSelected))
+				{
+					X++;
+				}
+
+				if (bRunSelected)
+				{
+					FGAGridMapKernels::Convolve(RowValues + RunStart, X - RunStart, Kernel.GetData(), Radius, RowOut + RunStart);
+				}
+				else
+				{
+					FMemory::Memcpy(RowOut + RunStart, RowValues + RunStart, (X - RunStart) * sizeof(float));
+				}
+			}
+		}, bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+	}
+
+	// ValuesOut[X * Height + Y] = Values[Y * Width + X], a tile at a time so both sides stay in cache
+	template <typename ValueType>
+	void Transpose(const ValueType* Values, int32 Width, int32 Height, ValueType* ValuesOut)
+	{
+		constexpr int32 TileSize = 32;
+		for (int32 TileY = 0; TileY < Height; TileY += TileSize)
+		{
+			for (int32 TileX = 0; TileX < Width; TileX += TileSize)
+			{
+				const int32 MaxY = FMath::Min(TileY + TileSize, Height);
+				const int32 MaxX = FMath::Min(TileX + TileSize, Width);
+				for (int32 Y = TileY; Y < MaxY; Y++)
+				{
+					for (int32 X = TileX; X < MaxX; X++)
+					{
+						ValuesOut[X * Height + Y] = Values[Y * Width + X];
+					}
+				}
+			}
+		}
+	}
+
+	FGridBox GrowBox(const FGridBox& Box, int32 RadiusX, int32 RadiusY)
+	{
+		return FGridBox(Box.MinX - RadiusX, Box.MaxX + RadiusX, Box.MinY - RadiusY, Box.MaxY + RadiusY);
+	}
+}
+
+void FGAGridMap::Convolve(TConstArrayView<float> KernelX, TConstArrayView<float> KernelY, const FGAGridBitPlane* Mask, bool bParallel)
+{
+	check((KernelX.Num() % 2 == 1) && (KernelY.Num() % 2 == 1));
+
+	const int32 RadiusX = KernelX.Num() / 2;
+	const int32 RadiusY = KernelY.Num() / 2;
+
+	// Convolving a stretch of 0s gives 0s, so with DefaultValue 0 only the cells the kernel reaches from the active
+	// bounds can change. Any other DefaultValue gets scaled by the kernel's weight, so everything changes.
+	FGridBox Written;
+	if (DefaultValue == 0.0f)
+	{
+		if (!IsValid() || !ActiveBounds.IsValid() || !ClipBox(GrowBox(ActiveBounds, RadiusX, RadiusY), Written))
+		{
+			return;
+		}
+	}
+	else if (!ClipBox(FGridBox(), Written))
+	{
+		return;
+	}
+
+	// The cells written to take their values from up to a kernel radius further out
+	FGridBox Read;
+	ClipBox(GrowBox(Written, RadiusX, RadiusY), Read);
+
+	const int32 Width = Read.GetWidth();
+	const int32 Height = Read.GetHeight();
+
+	TArray<float> Values;
+	TArray<float> Convolved;
+	Values.SetNumUninitialized(Width * Height);
+	Convolved.SetNumUninitialized(Width * Height);
+	for (int32 Y = 0; Y < Height; Y++)
+	{
+		GetRowValues(Read.MinY + Y, Read.MinX, Width, Values.GetData() + Y * Width);
+	}
+
+	// A byte per cell, so that runs can be found the same way along rows and columns
+	TArray<uint8> Selected;
+	TArray<uint8> SelectedColumns;
+	if (Mask)
+	{
+		Selected.SetNumUninitialized(Width * Height);
+		for (int32 Y = 0; Y < Height; Y++)
+		{
+			for (int32 X = 0; X < Width; X += 64)
+			{
+				const int32 Count = FMath::Min(64, Width - X);
+				const uint64 Bits = Mask->GetRowBits(Read.MinY + Y, Read.MinX + X, Count);
+				for (int32 Bit = 0; Bit < Count; Bit++)
+				{
+					Selected[Y * Width + X + Bit] = (Bits >> Bit) & 1;
+				}
+			}
+		}
+
+		SelectedColumns.SetNumUninitialized(Width * Height);
+		Transpose(Selected.GetData(), Width, Height, SelectedColumns.GetData());
+	}
+
+	// Along the rows, then along the columns by way of a transpose, so both passes run over contiguous values
+	ConvolveRows(Values.GetData(), Mask ? Selected.GetData() : NULL, Width, Height, KernelX, bParallel, Convolved.GetData());
+	Transpose(Convolved.GetData(), Width, Height, Values.GetData());
+	ConvolveRows(Values.GetData(), Mask ? SelectedColumns.GetData() : NULL, Height, Width, KernelY, bParallel, Convolved.GetData());
+	Transpose(Convolved.GetData(), Height, Width, Values.GetData());
+
+	for (int32 Y = Written.MinY; Y <= Written.MaxY; Y++)
+	{
+		SetRowValues(Y, Written.MinX, Written.GetWidth(), Values.GetData() + (Y - Read.MinY) * Width + (Written.MinX - Read.MinX));
+	}
+
+	// The rows were written one by one, which only ever grows the active bounds; Written holds all of them, so shrink
+	// them back down to what's actually live
+	RecomputeActiveBounds(Written);
+}
+
+void FGAGridMap::GaussianBlur(float Sigma, const FGAGridBitPlane* Mask, bool bParallel)
+{
+	if (Sigma <= 0.0f)
+	{
+		return;
+	}
+
+	const int32 Radius = FMath::CeilToInt(3.0f * Sigma);
+
+	TArray<float, TInlineAllocator<32>> Kernel;
+	Kernel.SetNumUninitialized(2 * Radius + 1);
+	float Total = 0.0f;
+	for (int32 Tap = -Radius; Tap <= Radius; Tap++)
+	{
+		Kernel[Tap + Radius] = FMath::Exp(-float(Tap * Tap) / (2.0f * Sigma * Sigma));
+		Total += Kernel[Tap + Radius];
+	}
+	for (float& Weight : Kernel)
+	{
+		Weight /= Total;
+	}
+
+	Convolve(Kernel, Mask, bParallel);
+}
+
+void FGAGridMap::BoxBlur(int32 Radius, const FGAGridBitPlane* Mask, bool bParallel)
+{
+	if (Radius <= 0)
+	{
+		return;
+	}
+
+	TArray<float, TInlineAllocator<32>> Kernel;
+	Kernel.Init(1.0f / (2 * Radius + 1), 2 * Radius + 1);
+
+	Convolve(Kernel, Mask, bParallel);
+}
@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 #include "Math/MathFwd.h"
+#include "GAGridCellRef.h"
 #include "GAGridMap.generated.h"
 
 
@@ -9,7 +10,7 @@
 // Note that it does not necessarily need to cover the entire grid
 
 class AGAGridActor;
-struct FCellRef;
+struct FGAGridBitPlane;
 
 USTRUCT(BlueprintType)
 struct FGridBox
@@ -78,9 +79,31 @@ struct FGAGridMap
 	UPROPERTY(BlueprintReadOnly)
 	FGridBox GridBounds;
 
+	// Dense storage, one value per cell of GridBounds. Empty when the map is chunked (see SetChunked), so code that
+	// might be handed a chunked map should read through GetValue/GetRowValues instead.
 	UPROPERTY(BlueprintReadOnly)
 	TArray<float> Data;
 
+	// Chunked storage --------------------------------
+	// Instead of one dense array, the map can be split into ChunkSize x ChunkSize chunks that are only allocated
+	// once one of their cells is set to something other than DefaultValue, and freed again when all of them are back
+	// to DefaultValue. Maps that are mostly untouched (e.g. an occupancy map that's zero over most of the level) then
+	// only pay for the chunks they actually use. GetValue/SetValue/GetMaxValue work the same either way.
+
+	static constexpr int32 ChunkShift = 4;
+	static constexpr int32 ChunkSize = 1 << ChunkShift;
+
+	// Switch between dense and chunked storage, keeping the current values
+	void SetChunked(bool bChunkedIn);
+
+	bool IsChunked() const { return bChunked; }
+
+	// Number of chunks holding memory right now (always 0 for a dense map)
+	int32 GetAllocatedChunkCount() const;
+
+	// The value of every cell of an unallocated chunk. Set by ResetData.
+	float GetDefaultValue() const { return DefaultValue; }
+
 
 	bool CellRefToLocal(const FCellRef& Cell, int32& X, int32& Y) const;
 
@@ -92,9 +115,279 @@ struct FGAGridMap
 
 	bool SetValue(const FCellRef& Cell, float Value);
 
+	// Copy Count values of row Y, starting at cell MinX. All of those cells must be inside GridBounds.
+	void GetRowValues(int32 Y, int32 MinX, int32 Count, float* ValuesOut) const;
+
+	// Copy Count values into row Y, starting at cell MinX. All of those cells must be inside GridBounds.
+	void SetRowValues(int32 Y, int32 MinX, int32 Count, const float* Values);
+
+	// Raw access to the values of row Y (which must be inside GridBounds), indexed by X - GridBounds.MinX.
+	// Dense maps only, chunked ones don't keep their rows together and return NULL.
+	// After writing through it, call RecomputeActiveBounds with the cells written.
+	FORCEINLINE const float* GetRowData(int32 Y) const { return bChunked ? NULL : Data.GetData() + (Y - GridBounds.MinY) * GridBounds.GetWidth(); }
+	FORCEINLINE float* GetRowData(int32 Y) { return bChunked ? NULL : Data.GetData() + (Y - GridBounds.MinY) * GridBounds.GetWidth(); }
+
+
+	// Whole-map operations --------------------------------
+	// These run a row at a time through the vectorized loops in FGAGridMapKernels, and work the same for dense and
+	// chunked maps (a chunk the operation leaves at DefaultValue stays unallocated).
+	//
+	// Mask, if given, is a bit plane over the whole grid, e.g. AGAGridActor::GetTraversableBits(); only cells whose
+	// bit is set are touched or counted. Box limits them to a sub-box of cells (in grid cell coordinates, clipped to
+	// GridBounds); the default, invalid box means the whole map. Operations between two maps only cover the cells
+	// both maps are defined over.
+
+	void Fill(float Value, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	void Add(float Value, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	void Scale(float Factor, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	void Clamp(float MinValue, float MaxValue, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	// Add Other * Factor to my values
+	void Add(const FGAGridMap& Other, float Factor = 1.0f, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	void Multiply(const FGAGridMap& Other, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	// Move my values towards Other's, Alpha = 1 being all the way
+	void Lerp(const FGAGridMap& Other, float Alpha, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	float Sum(const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox()) const;
+
+	// Scale the values so that they sum to 1. Returns false, leaving them alone, if they sum to 0.
+	bool Normalize(const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	// The cell with the largest value. Returns false if there were no cells to look at.
+	bool ArgMax(FCellRef& CellOut, float& ValueOut, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox()) const;
+
+
+	// Convolution --------------------------------
+	// Convolve the map with a separable kernel: KernelX along the rows, then KernelY along the columns. Kernels have an
+	// odd number of taps, the middle one weighing the cell itself.
+	//
+	// With a Mask (e.g. AGAGridActor::GetTraversableBits()), each run of consecutive masked cells is convolved on its
+	// own and the rest are left alone, so nothing spreads through a wall. Taps that land past the end of a run or the
+	// map are dropped and the others scaled up to make up for them, so values don't fade out against walls either.
+	//
+	// Rows go through FGAGridMapKernels::Convolve four cells at a time, spread over worker threads with bParallel.
+	// If DefaultValue is 0, only the active bounds and the cells the kernel reaches out of them are worked on.
+
+	void Convolve(TConstArrayView<float> KernelX, TConstArrayView<float> KernelY, const FGAGridBitPlane* Mask = NULL, bool bParallel = false);
+
+	// The same kernel along both axes
+	void Convolve(TConstArrayView<float> Kernel, const FGAGridBitPlane* Mask = NULL, bool bParallel = false) { Convolve(Kernel, Kernel, Mask, bParallel); }
+
+	// Gaussian of standard deviation Sigma cells, cut off at 3 Sigma
+	void GaussianBlur(float Sigma, const FGAGridBitPlane* Mask = NULL, bool bParallel = false);
+
+	// Mean over the square of cells up to Radius away
+	void BoxBlur(int32 Radius, const FGAGridBitPlane* Mask = NULL, bool bParallel = false);
+
+
+	// Active bounds --------------------------------
+	// The map keeps a box around every cell that isn't DefaultValue (for an occupancy map, every cell with some
+	// probability in it). The box is never too small, but may be too big: setting a cell grows it, and only a
+	// whole-map operation that covers all of it shrinks it back down. The whole-map operations skip the cells outside
+	// it whenever they would leave them alone anyway, so for a mostly-default map they cost what the box costs.
+
+	// Invalid if every cell is DefaultValue
+	const FGridBox& GetActiveBounds() const { return ActiveBounds; }
+
+	// Work the active bounds out again after writing to Data (or through GetRowData) directly. Box limits the recount
+	// to the cells that were written; the default, invalid box means the whole map.
+	void RecomputeActiveBounds(const FGridBox& Box = FGridBox());
+
+
+	// Iteration --------------------------------
+	// Visit the cells of Box (clipped to GridBounds, the default being all of them) a row at a time, without the lookup
+	// and checks that GetValue/SetValue go through for every cell. Func is called in row order as
+	// Func(const FCellRef& Cell, float Value), and is meant to be small enough to inline into the loop.
+	// The rows of a chunked map are copied out (and back in, when modifying) whole, so Func mustn't touch other cells
+	// of the map while it runs.
+
+	template <typename FuncType>
+	void ForEachCell(FuncType&& Func, const FGridBox& Box = FGridBox()) const;
+
+	// Same, with Func(const FCellRef& Cell, float& Value) free to change the value
+	template <typename FuncType>
+	void ModifyEachCell(FuncType&& Func, const FGridBox& Box = FGridBox());
+
+	// Paired versions, over the cells both maps are defined over: Func(const FCellRef& Cell, float Value, float OtherValue),
+	// with Value a float& when modifying. Other must not be this map.
+
+	template <typename FuncType>
+	void ForEachCellWith(const FGAGridMap& Other, FuncType&& Func, const FGridBox& Box = FGridBox()) const;
+
+	template <typename FuncType>
+	void ModifyEachCellWith(const FGAGridMap& Other, FuncType&& Func, const FGridBox& Box = FGridBox());
+
 
 	FORCEINLINE bool IsValid() const
 	{
-		return GridBounds.IsValid() && (GridBounds.GetCellCount() == Data.Num());
+		return GridBounds.IsValid() && (bChunked ? (Chunks.Num() == ChunkXCount * ChunkYCount) : (GridBounds.GetCellCount() == Data.Num()));
+	}
+
+private:
+	// Local cell (relative to GridBounds) to chunk index and index within the chunk
+	FORCEINLINE int32 GetChunkIndex(int32 X, int32 Y) const { return (Y >> ChunkShift) * ChunkXCount + (X >> ChunkShift); }
+	FORCEINLINE static int32 GetIndexInChunk(int32 X, int32 Y) { return ((Y & (ChunkSize - 1)) << ChunkShift) + (X & (ChunkSize - 1)); }
+
+	void ResetChunks();
+
+	// Box (invalid meaning all of GridBounds) clipped to GridBounds. Returns false if nothing is left.
+	bool ClipBox(const FGridBox& Box, FGridBox& BoxOut) const;
+
+	// Row scratch for iterating chunked maps. Rows of up to 512 cells fit without touching the heap.
+	typedef TArray<float, TInlineAllocator<512>> FRowScratch;
+
+	// The values of row Y across Box: in place for a dense map, otherwise copied into Scratch
+	FORCEINLINE const float* ReadRow(int32 Y, const FGridBox& Box, FRowScratch& Scratch) const
+	{
+		if (!bChunked)
+		{
+			return GetRowData(Y) + (Box.MinX - GridBounds.MinX);
+		}
+		Scratch.SetNumUninitialized(Box.GetWidth(), false);
+		GetRowValues(Y, Box.MinX, Box.GetWidth(), Scratch.GetData());
+		return Scratch.GetData();
+	}
+
+	// Same, writable. A copied row has to be handed back to WriteRow afterwards.
+	FORCEINLINE float* ModifyRow(int32 Y, const FGridBox& Box, FRowScratch& Scratch)
+	{
+		return bChunked ? const_cast<float*>(ReadRow(Y, Box, Scratch)) : GetRowData(Y) + (Box.MinX - GridBounds.MinX);
+	}
+
+	FORCEINLINE void WriteRow(int32 Y, const FGridBox& Box, const FRowScratch& Scratch)
+	{
+		if (bChunked)
+		{
+			SetRowValues(Y, Box.MinX, Box.GetWidth(), Scratch.GetData());
+		}
+	}
+
+	// The cells of Box have just been gone over, and LiveBounds are the ones that aren't DefaultValue now
+	void MergeActiveBounds(const FGridBox& Box, const FGridBox& LiveBounds);
+
+	// ClipBox, then if the operation leaves DefaultValue alone, also clipped to Active (the only cells it can change)
+	bool ClipOperationBox(const FGridBox& Box, bool bKeepsDefault, const FGridBox& Active, FGridBox& BoxOut) const;
+
+	// Call Func(Values, Count, X, Y) over runs of the (clipped) box, (X, Y) being the cell of Values[0].
+	// A dense map gives one run per row; a chunked one splits rows at chunk edges, and goes a chunk at a time so
+	// that the chunk can be allocated or freed as its values change. Keeps ActiveBounds up to date.
+	template <typename FuncType>
+	void ModifyRuns(const FGridBox& Box, FuncType&& Func);
+
+	// The chunked half of ModifyRuns, over a local (relative to GridBounds) box. Takes what's left live into LiveBounds.
+	template <typename FuncType>
+	void ModifyChunkRuns(int32 MinX, int32 MaxX, int32 MinY, int32 MaxY, FGridBox& LiveBounds, FuncType&& Func);
+
+	// Same, read only. Cells of unallocated chunks read as DefaultValue.
+	template <typename FuncType>
+	void ReadRuns(const FGridBox& Box, FuncType&& Func) const;
+
+	// Same as ModifyRuns, also passing Func Other's values for the same cells. Box must be inside both maps.
+	template <typename FuncType>
+	void ModifyRunsWith(const FGAGridMap& Other, const FGridBox& Box, FuncType&& Func);
+
+	// See GetActiveBounds
+	FGridBox ActiveBounds;
+
+	bool bChunked = false;
+
+	float DefaultValue = 0.0f;
+
+	int32 ChunkXCount = 0;
+	int32 ChunkYCount = 0;
+
+	// ChunkSize * ChunkSize values for each allocated chunk, empty for the rest.
+	// Cells of edge chunks that fall outside GridBounds are kept at DefaultValue.
+	TArray<TArray<float>> Chunks;
+
+	// Number of cells in each chunk that aren't DefaultValue. A chunk is freed when this gets back to 0.
+	TArray<uint16> ChunkLiveCounts;
+};
+
+
+// Iteration --------------------------------
+
+template <typename FuncType>
+void FGAGridMap::ForEachCell(FuncType&& Func, const FGridBox& Box) const
+{
+	FGridBox Clipped;
+	if (ClipBox(Box, Clipped))
+	{
+		FRowScratch Row;
+		for (int32 Y = Clipped.MinY; Y <= Clipped.MaxY; Y++)
+		{
+			const float* Values = ReadRow(Y, Clipped, Row);
+			for (int32 X = Clipped.MinX; X <= Clipped.MaxX; X++)
+			{
+				Func(FCellRef(X, Y), Values[X - Clipped.MinX]);
+			}
+		}
+	}
+}
+
+template <typename FuncType>
+void FGAGridMap::ModifyEachCell(FuncType&& Func, const FGridBox& Box)
+{
+	FGridBox Clipped;
+	if (ClipBox(Box, Clipped))
+	{
+		FRowScratch Row;
+		for (int32 Y = Clipped.MinY; Y <= Clipped.MaxY; Y++)
+		{
+			float* Values = ModifyRow(Y, Clipped, Row);
+			for (int32 X = Clipped.MinX; X <= Clipped.MaxX; X++)
+			{
+				Func(FCellRef(X, Y), Values[X - Clipped.MinX]);
+			}
+			WriteRow(Y, Clipped, Row);
+		}
+		RecomputeActiveBounds(Clipped);
+	}
+}
+
+template <typename FuncType>
+void FGAGridMap::ForEachCellWith(const FGAGridMap& Other, FuncType&& Func, const FGridBox& Box) const
+{
+	FGridBox Clipped;
+	if (ClipBox(Box, Clipped) && Other.ClipBox(Clipped, Clipped))
+	{
+		FRowScratch Row, OtherRow;
+		for (int32 Y = Clipped.MinY; Y <= Clipped.MaxY; Y++)
+		{
+			const float* Values = ReadRow(Y, Clipped, Row);
+			const float* OtherValues = Other.ReadRow(Y, Clipped, OtherRow);
+			for (int32 X = Clipped.MinX; X <= Clipped.MaxX; X++)
+			{
+				Func(FCellRef(X, Y), Values[X - Clipped.MinX], OtherValues[X - Clipped.MinX]);
+			}
+		}
+	}
+}
+
+template <typename FuncType>
+void FGAGridMap::ModifyEachCellWith(const FGAGridMap& Other, FuncType&& Func, const FGridBox& Box)
+{
+	check(&Other != this);
+
+	FGridBox Clipped;
+	if (ClipBox(Box, Clipped) && Other.ClipBox(Clipped, Clipped))
+	{
+		FRowScratch Row, OtherRow;
+		for (int32 Y = Clipped.MinY; Y <= Clipped.MaxY; Y++)
+		{
+			float* Values = ModifyRow(Y, Clipped, Row);
+			const float* OtherValues = Other.ReadRow(Y, Clipped, OtherRow);
+			for (int32 X = Clipped.MinX; X <= Clipped.MaxX; X++)
+			{
+				Func(FCellRef(X, Y), Values[X - Clipped.MinX], OtherValues[X - Clipped.MinX]);
+			}
+			WriteRow(Y, Clipped, Row);
+		}
+		RecomputeActiveBounds(Clipped);
 	}
-};
\ No newline at end of file
+}
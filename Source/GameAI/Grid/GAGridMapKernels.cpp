@@ -0,0 +1,477 @@
+#include "GAGridMapKernels.h"
+
+
+namespace
+{
+	// Lane masks for each combination of four mask bits, bit 0 being lane 0
+	struct FLaneMasks
+	{
+		FLaneMasks()
+		{
+			for (int32 Bits = 0; Bits < 16; Bits++)
+			{
+				const VectorRegister4Float Lanes = MakeVectorRegister(float(Bits & 1), float((Bits >> 1) & 1), float((Bits >> 2) & 1), float((Bits >> 3) & 1));
+				Masks[Bits] = VectorCompareGT(Lanes, VectorZero());
+			}
+		}
+
+		VectorRegister4Float Masks[16];
+	};
+
+	const FLaneMasks& GetLaneMasks()
+	{
+		static const FLaneMasks LaneMasks;
+		return LaneMasks;
+	}
+
+	// The mask bits of values Index..Index + 3. Index is always a multiple of 4, so they never straddle two words.
+	FORCEINLINE uint32 GetLaneBits(const uint64* Mask, int32 Index)
+	{
+		return uint32(Mask[Index >> 6] >> (Index & 63)) & 15;
+	}
+
+	FORCEINLINE bool IsSelected(const uint64* Mask, int32 Index)
+	{
+		return (Mask == NULL) || ((Mask[Index >> 6] >> (Index & 63)) & 1);
+	}
+
+	// Values[i] = Op(Values[i], Others[i]) for every selected value. Others may be NULL for operations that don't need it.
+	template <typename VectorOpType, typename ScalarOpType>
+	FORCEINLINE void Transform(float* Values, const float* Others, int32 Count, const uint64* Mask, VectorOpType&& VectorOp, ScalarOpType&& ScalarOp)
+	{
+		const VectorRegister4Float* LaneMasks = GetLaneMasks().Masks;
+		const VectorRegister4Float Zero = VectorZero();
+
+		int32 Index = 0;
+		for (; Index + 4 <= Count; Index += 4)
+		{
+			uint32 Bits = 15;
+			if (Mask)
+			{
+				Bits = GetLaneBits(Mask, Index);
+				if (Bits == 0)
+				{
+					continue;
+				}
+			}
+
+			const VectorRegister4Float Old = VectorLoad(Values + Index);
+			VectorRegister4Float New = VectorOp(Old, Others ? VectorLoad(Others + Index) : Zero);
+			if (Bits != 15)
+			{
+				New = VectorSelect(LaneMasks[Bits], New, Old);
+			}
+			VectorStore(New, Values + Index);
+		}
+
+		for (; Index < Count; Index++)
+		{
+			if (IsSelected(Mask, Index))
+			{
+				Values[Index] = ScalarOp(Values[Index], Others ? Others[Index] : 0.0f);
+			}
+		}
+	}
+
+	// Combine the four lanes of a vector with Op
+	template <typename ScalarOpType>
+	FORCEINLINE float ReduceLanes(const VectorRegister4Float& Vector, ScalarOpType&& Op)
+	{
+		float Lanes[4];
+		VectorStore(Vector, Lanes);
+		return Op(Op(Lanes[0], Lanes[1]), Op(Lanes[2], Lanes[3]));
+	}
+}
+
+
+void FGAGridMapKernels::Fill(float* Values, int32 Count, float Value, const uint64* Mask)
+{
+	const VectorRegister4Float ValueV = VectorSetFloat1(Value);
+	Transform(Values, NULL, Count, Mask,
+		[&ValueV](const VectorRegister4Float&, const VectorRegister4Float&) { return ValueV; },
+		[Value](float, float) { return Value; });
+}
+
+void FGAGridMapKernels::AddScalar(float* Values, int32 Count, float Value, const uint64* Mask)
+{
+	const VectorRegister4Float ValueV = VectorSetFloat1(Value);
+	Transform(Values, NULL, Count, Mask,
+		[&ValueV](const VectorRegister4Float& A, const VectorRegister4Float&) { return VectorAdd(A, ValueV); },
+		[Value](float A, float) { return A + Value; });
+}
+
+void FGAGridMapKernels::Scale(float* Values, int32 Count, float Factor, const uint64* Mask)
+{
+	const VectorRegister4Float FactorV = VectorSetFloat1(Factor);
+	Transform(Values, NULL, Count, Mask,
+		[&FactorV](const VectorRegister4Float& A, const VectorRegister4Float&) { return VectorMultiply(A, FactorV); },
+		[Factor](float A, float) { return A * Factor; });
+}
+
+void FGAGridMapKernels::Clamp(float* Values, int32 Count, float MinValue, float MaxValue, const uint64* Mask)
+{
+	const VectorRegister4Float MinV = VectorSetFloat1(MinValue);
+	const VectorRegister4Float MaxV = VectorSetFloat1(MaxValue);
+	Transform(Values, NULL, Count, Mask,
+		[&MinV, &MaxV](const VectorRegister4Float& A, const VectorRegister4Float&) { return VectorMin(VectorMax(A, MinV), MaxV); },
+		[MinValue, MaxValue](float A, float) { return FMath::Min(FMath::Max(A, MinValue), MaxValue); });
+}
+
+void FGAGridMapKernels::Add(float* Values, const float* Others, int32 Count, float Factor, const uint64* Mask)
+{
+	const VectorRegister4Float FactorV = VectorSetFloat1(Factor);
+	Transform(Values, Others, Count, Mask,
+		[&FactorV](const VectorRegister4Float& A, const VectorRegister4Float& B) { return VectorMultiplyAdd(B, FactorV, A); },
+		[Factor](float A, float B) { return A + B * Factor; });
+}
+
+void FGAGridMapKernels::Multiply(float* Values, const float* Others, int32 Count, const uint64* Mask)
+{
+	Transform(Values, Others, Count, Mask,
+		[](const VectorRegister4Float& A, const VectorRegister4Float& B) { return VectorMultiply(A, B); },
+		[](float A, float B) { return A * B; });
+}
+
+void FGAGridMapKernels::Lerp(float* Values, const float* Others, int32 Count, float Alpha, const uint64* Mask)
+{
+	const VectorRegister4Float AlphaV = VectorSetFloat1(Alpha);
+	Transform(Values, Others, Count, Mask,
+		[&AlphaV](const VectorRegister4Float& A, const VectorRegister4Float& B) { return VectorMultiplyAdd(VectorSubtract(B, A), AlphaV, A); },
+		[Alpha](float A, float B) { return A + (B - A) * Alpha; });
+}
+
+float FGAGridMapKernels::Sum(const float* Values, int32 Count, const uint64* Mask)
+{
+	const VectorRegister4Float* LaneMasks = GetLaneMasks().Masks;
+	VectorRegister4Float SumV = VectorZero();
+
+	int32 Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const VectorRegister4Float V = VectorLoad(Values + Index);
+		SumV = VectorAdd(SumV, Mask ? VectorBitwiseAnd(V, LaneMasks[GetLaneBits(Mask, Index)]) : V);
+	}
+
+	float Result = ReduceLanes(SumV, [](float A, float B) { return A + B; });
+	for (; Index < Count; Index++)
+	{
+		if (IsSelected(Mask, Index))
+		{
+			Result += Values[Index];
+		}
+	}
+	return Result;
+}
+
+float FGAGridMapKernels::Max(const float* Values, int32 Count, const uint64* Mask)
+{
+	const VectorRegister4Float* LaneMasks = GetLaneMasks().Masks;
+	const VectorRegister4Float Lowest = VectorSetFloat1(-UE_MAX_FLT);
+	VectorRegister4Float MaxV = Lowest;
+
+	int32 Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		const VectorRegister4Float V = VectorLoad(Values + Index);
+		MaxV = VectorMax(MaxV, Mask ? VectorSelect(LaneMasks[GetLaneBits(Mask, Index)], V, Lowest) : V);
+	}
+
+	float Result = ReduceLanes(MaxV, [](float A, float B) { return FMath::Max(A, B); });
+	for (; Index < Count; Index++)
+	{
+		if (IsSelected(Mask, Index))
+		{
+			Result = FMath::Max(Result, Values[Index]);
+		}
+	}
+	return Result;
+}
+
+int32 FGAGridMapKernels::ArgMax(const float* Values, int32 Count, const uint64* Mask)
+{
+	// Find the largest value with the vector loop, then where it first is
+	const float MaxValue = Max(Values, Count, Mask);
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		if ((Values[Index] == MaxValue) && IsSelected(Mask, Index))
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+bool FGAGridMapKernels::IsAnyNotEqual(const float* Values, int32 Count, float Value)
+{
+	const VectorRegister4Float ValueV = VectorSetFloat1(Value);
+
+	int32 Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		if (VectorMaskBits(VectorCompareNE(VectorLoad(Values + Index), ValueV)) != 0)
+		{
+			return true;
+		}
+	}
+
+	for (; Index < Count; Index++)
+	{
+		if (Values[Index] != Value)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FGAGridMapKernels::FindNotEqual(const float* Values, int32 Count, float Value, int32& FirstOut, int32& LastOut)
+{
+	const VectorRegister4Float ValueV = VectorSetFloat1(Value);
+	const int32 VectorCount = Count & ~3;
+
+	// Forwards for the first one...
+	FirstOut = INDEX_NONE;
+	for (int32 Index = 0; (Index < VectorCount) && (FirstOut == INDEX_NONE); Index += 4)
+	{
+		const uint32 Bits = VectorMaskBits(VectorCompareNE(VectorLoad(Values + Index), ValueV));
+		if (Bits != 0)
+		{
+			FirstOut = Index + FPlatformMath::CountTrailingZeros(Bits);
+		}
+	}
+	for (int32 Index = VectorCount; (Index < Count) && (FirstOut == INDEX_NONE); Index++)
+	{
+		if (Values[Index] != Value)
+		{
+			FirstOut = Index;
+		}
+	}
+
+	if (FirstOut == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// ...then backwards for the last, which can't be before it
+	for (int32 Index = Count - 1; Index >= VectorCount; Index--)
+	{
+		if (Values[Index] != Value)
+		{
+			LastOut = Index;
+			return true;
+		}
+	}
+	for (int32 Index = VectorCount - 4; Index >= 0; Index -= 4)
+	{
+		const uint32 Bits = VectorMaskBits(VectorCompareNE(VectorLoad(Values + Index), ValueV));
+		if (Bits != 0)
+		{
+			LastOut = Index + FPlatformMath::FloorLog2(Bits);
+			return true;
+		}
+	}
+
+	LastOut = FirstOut;
+	return true;
+}
+
+void FGAGridMapKernels::Convolve(const float* Values, int32 Count, const float* Kernel, int32 Radius, float* ValuesOut)
+{
+	const int32 TapCount = 2 * Radius + 1;
+
+	float KernelWeight = 0.0f;
+	TArray<VectorRegister4Float, TInlineAllocator<32>> Taps;
+	Taps.SetNumUninitialized(TapCount);
+	for (int32 Tap = 0; Tap < TapCount; Tap++)
+	{
+		KernelWeight += Kernel[Tap];
+		Taps[Tap] = VectorSetFloat1(Kernel[Tap]);
+	}
+
+	// Near the ends of the run, only some of the taps land on it
+	auto ConvolveEnd = [=](int32 Index)
+	{
+		const int32 FirstTap = FMath::Max(0, Radius - Index);
+		const int32 LastTap = FMath::Min(TapCount - 1, Count - 1 - Index + Radius);
+		float Sum = 0.0f;
+		float Weight = 0.0f;
+		for (int32 Tap = FirstTap; Tap <= LastTap; Tap++)
+		{
+			Sum += Kernel[Tap] * Values[Index + Tap - Radius];
+			Weight += Kernel[Tap];
+		}
+		ValuesOut[Index] = (Weight != 0.0f) ? Sum * (KernelWeight / Weight) : Sum;
+	};
+
+	// Every tap of the values in between fits, so they're done four at a time
+	const int32 InnerMin = FMath::Min(Radius, Count);
+	const int32 InnerMax = FMath::Max(Count - Radius, InnerMin);
+
+	for (int32 Index = 0; Index < InnerMin; Index++)
+	{
+		ConvolveEnd(Index);
+	}
+
+	int32 Index = InnerMin;
+	for (; Index + 4 <= InnerMax; Index += 4)
+	{
+		const float* Window = Values + Index - Radius;
+		VectorRegister4Float Sum = VectorZero();
+		for (int32 Tap = 0; Tap < TapCount; Tap++)
+		{
+			Sum = VectorMultiplyAdd(VectorLoad(Window + Tap), Taps[Tap], Sum);
+		}
+		VectorStore(Sum, ValuesOut + Index);
+	}
+
+	for (; Index < InnerMax; Index++)
+	{
+		const float* Window = Values + Index - Radius;
+		float Sum = 0.0f;
+		for (int32 Tap = 0; Tap < TapCount; Tap++)
+		{
+			Sum += Kernel[Tap] * Window[Tap];
+		}
+		ValuesOut[Index] = Sum;
+	}
+
+	for (Index = InnerMax; Index < Count; Index++)
+	{
+		ConvolveEnd(Index);
+	}
+}
+
+
+namespace
+{
+	template <typename StoredType>
+	void QuantizeToInt(const float* Values, int32 Count, StoredType* StoredOut, float Scale, float Offset)
+	{
+		const float MaxStored = float(TNumericLimits<StoredType>::Max());
+		const float InvScale = 1.0f / Scale;
+		const VectorRegister4Float InvScaleV = VectorSetFloat1(InvScale);
+		const VectorRegister4Float OffsetV = VectorSetFloat1(Offset);
+		const VectorRegister4Float HalfV = VectorSetFloat1(0.5f);
+		const VectorRegister4Float MaxV = VectorSetFloat1(MaxStored);
+
+		// Scale, round and clamp four at a time; only the narrowing is done per value
+		int32 Index = 0;
+		for (; Index + 4 <= Count; Index += 4)
+		{
+			const VectorRegister4Float Steps = VectorMultiplyAdd(VectorSubtract(VectorLoad(Values + Index), OffsetV), InvScaleV, HalfV);
+			float Lanes[4];
+			VectorStore(VectorMin(VectorMax(Steps, VectorZero()), MaxV), Lanes);
+			for (int32 Lane = 0; Lane < 4; Lane++)
+			{
+				StoredOut[Index + Lane] = StoredType(Lanes[Lane]);
+			}
+		}
+
+		for (; Index < Count; Index++)
+		{
+			StoredOut[Index] = StoredType(FMath::Clamp((Values[Index] - Offset) * InvScale + 0.5f, 0.0f, MaxStored));
+		}
+	}
+
+	template <typename StoredType>
+	void DequantizeFromInt(const StoredType* Stored, int32 Count, float* ValuesOut, float Scale, float Offset)
+	{
+		const StoredType MaxStored = TNumericLimits<StoredType>::Max();
+		const VectorRegister4Float ScaleV = VectorSetFloat1(Scale);
+		const VectorRegister4Float OffsetV = VectorSetFloat1(Offset);
+		const VectorRegister4Float MaxV = VectorSetFloat1(float(MaxStored));
+		const VectorRegister4Float SaturatedV = VectorSetFloat1(UE_MAX_FLT);
+
+		int32 Index = 0;
+		for (; Index + 4 <= Count; Index += 4)
+		{
+			const VectorRegister4Float Steps = MakeVectorRegister(float(Stored[Index]), float(Stored[Index + 1]), float(Stored[Index + 2]), float(Stored[Index + 3]));
+			const VectorRegister4Float Values = VectorMultiplyAdd(Steps, ScaleV, OffsetV);
+			VectorStore(VectorSelect(VectorCompareEQ(Steps, MaxV), SaturatedV, Values), ValuesOut + Index);
+		}
+
+		for (; Index < Count; Index++)
+		{
+			ValuesOut[Index] = (Stored[Index] == MaxStored) ? UE_MAX_FLT : float(Stored[Index]) * Scale + Offset;
+		}
+	}
+}
+
+void FGAGridMapKernels::Quantize(const float* Values, int32 Count, uint8* StoredOut, float Scale, float Offset)
+{
+	QuantizeToInt(Values, Count, StoredOut, Scale, Offset);
+}
+
+void FGAGridMapKernels::Quantize(const float* Values, int32 Count, uint16* StoredOut, float Scale, float Offset)
+{
+	QuantizeToInt(Values, Count, StoredOut, Scale, Offset);
+}
+
+void FGAGridMapKernels::Quantize(const float* Values, int32 Count, FFloat16* StoredOut, float Scale, float Offset)
+{
+	const float InvScale = 1.0f / Scale;
+	const VectorRegister4Float InvScaleV = VectorSetFloat1(InvScale);
+	const VectorRegister4Float OffsetV = VectorSetFloat1(Offset);
+
+	int32 Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		float Lanes[4];
+		VectorStore(VectorMultiply(VectorSubtract(VectorLoad(Values + Index), OffsetV), InvScaleV), Lanes);
+		FPlatformMath::VectorStoreHalf(&StoredOut[Index].Encoded, Lanes);
+	}
+
+	for (; Index < Count; Index++)
+	{
+		StoredOut[Index] = FFloat16((Values[Index] - Offset) * InvScale);
+	}
+}
+
+void FGAGridMapKernels::Quantize(const float* Values, int32 Count, float* StoredOut, float Scale, float Offset)
+{
+	FMemory::Memcpy(StoredOut, Values, Count * sizeof(float));
+	if ((Scale != 1.0f) || (Offset != 0.0f))
+	{
+		AddScalar(StoredOut, Count, -Offset);
+		FGAGridMapKernels::Scale(StoredOut, Count, 1.0f / Scale);
+	}
+}
+
+void FGAGridMapKernels::Dequantize(const uint8* Stored, int32 Count, float* ValuesOut, float Scale, float Offset)
+{
+	DequantizeFromInt(Stored, Count, ValuesOut, Scale, Offset);
+}
+
+void FGAGridMapKernels::Dequantize(const uint16* Stored, int32 Count, float* ValuesOut, float Scale, float Offset)
+{
+	DequantizeFromInt(Stored, Count, ValuesOut, Scale, Offset);
+}
+
+void FGAGridMapKernels::Dequantize(const FFloat16* Stored, int32 Count, float* ValuesOut, float Scale, float Offset)
+{
+	const VectorRegister4Float ScaleV = VectorSetFloat1(Scale);
+	const VectorRegister4Float OffsetV = VectorSetFloat1(Offset);
+
+	int32 Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		float Lanes[4];
+		FPlatformMath::VectorLoadHalf(Lanes, &Stored[Index].Encoded);
+		VectorStore(VectorMultiplyAdd(VectorLoad(Lanes), ScaleV, OffsetV), ValuesOut + Index);
+	}
+
+	for (; Index < Count; Index++)
+	{
+		ValuesOut[Index] = float(Stored[Index]) * Scale + Offset;
+	}
+}
+
+void FGAGridMapKernels::Dequantize(const float* Stored, int32 Count, float* ValuesOut, float Scale, float Offset)
+{
+	FMemory::Memcpy(ValuesOut, Stored, Count * sizeof(float));
+	if ((Scale != 1.0f) || (Offset != 0.0f))
+	{
+		FGAGridMapKernels::Scale(ValuesOut, Count, Scale);
+		AddScalar(ValuesOut, Count, Offset);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+// Vectorized loops over runs of float values, the building blocks of FGAGridMap's whole-map operations.
+//
+// Runs can be any length and alignment. The bulk of a run is done four values at a time with the engine's
+// VectorRegister ops, and whatever is left over one at a time.
+//
+// Every kernel takes an optional Mask, one bit per value with bit (i & 63) of word (i >> 6) standing for Values[i]
+// (the same layout as FGAGridBitPlane::GetRowBits). Values whose bit is clear are left alone, or skipped when reducing.
+
+struct FGAGridMapKernels
+{
+	static void Fill(float* Values, int32 Count, float Value, const uint64* Mask = NULL);
+
+	static void AddScalar(float* Values, int32 Count, float Value, const uint64* Mask = NULL);
+
+	static void Scale(float* Values, int32 Count, float Factor, const uint64* Mask = NULL);
+
+	static void Clamp(float* Values, int32 Count, float MinValue, float MaxValue, const uint64* Mask = NULL);
+
+	// Values += Others * Factor
+	static void Add(float* Values, const float* Others, int32 Count, float Factor, const uint64* Mask = NULL);
+
+	// Values *= Others
+	static void Multiply(float* Values, const float* Others, int32 Count, const uint64* Mask = NULL);
+
+	// Values += (Others - Values) * Alpha
+	static void Lerp(float* Values, const float* Others, int32 Count, float Alpha, const uint64* Mask = NULL);
+
+	static float Sum(const float* Values, int32 Count, const uint64* Mask = NULL);
+
+	// -UE_MAX_FLT if there's nothing to look at
+	static float Max(const float* Values, int32 Count, const uint64* Mask = NULL);
+
+	// Index of the largest value (the first of them on ties), or INDEX_NONE if there's nothing to look at
+	static int32 ArgMax(const float* Values, int32 Count, const uint64* Mask = NULL);
+
+	// True if any of the values isn't Value
+	static bool IsAnyNotEqual(const float* Values, int32 Count, float Value);
+
+	// Indices of the first and last values that aren't Value. Returns false if there are none.
+	static bool FindNotEqual(const float* Values, int32 Count, float Value, int32& FirstOut, int32& LastOut);
+
+	// ValuesOut[i] = the sum of Kernel[Tap] * Values[i + Tap - Radius] over the 2 * Radius + 1 taps. Taps that fall off
+	// either end of the run are dropped, and the rest scaled up to the kernel's full weight, so a constant run stays
+	// constant. ValuesOut must not overlap Values.
+	static void Convolve(const float* Values, int32 Count, const float* Kernel, int32 Radius, float* ValuesOut);
+
+	// Conversions between float values and the storage of typed maps (see TGAGridMap), Value = Stored * Scale + Offset.
+	// Integer storage rounds to the nearest step and saturates at both ends of its range; the top of the range is
+	// reserved for "too big to store" and reads back as UE_MAX_FLT, while values below Offset (e.g. negative values with
+	// an Offset of 0) are clamped to a stored 0 and read back as Offset. Half and float storage just apply the scale and offset.
+	static void Quantize(const float* Values, int32 Count, uint8* StoredOut, float Scale, float Offset);
+	static void Quantize(const float* Values, int32 Count, uint16* StoredOut, float Scale, float Offset);
+	static void Quantize(const float* Values, int32 Count, FFloat16* StoredOut, float Scale, float Offset);
+	static void Quantize(const float* Values, int32 Count, float* StoredOut, float Scale, float Offset);
+
+	static void Dequantize(const uint8* Stored, int32 Count, float* ValuesOut, float Scale, float Offset);
+	static void Dequantize(const uint16* Stored, int32 Count, float* ValuesOut, float Scale, float Offset);
+	static void Dequantize(const FFloat16* Stored, int32 Count, float* ValuesOut, float Scale, float Offset);
+	static void Dequantize(const float* Stored, int32 Count, float* ValuesOut, float Scale, float Offset);
+};
@@ -0,0 +1,41 @@
+#include "GAGridMapPool.h"
+#include "GAGridActor.h"
+
+
+void FGAGridMapPool::Acquire(FGAGridMap& Map, const AGAGridActor* Grid, const FGridBox& Box, float InitialValue)
+{
+	Map = FGAGridMap();
+	Map.XCount = Grid->XCount;
+	Map.YCount = Grid->YCount;
+	Map.GridBounds = Box;
+	Map.Data = TakeBuffer<float>(Box.IsValid() ? Box.GetCellCount() : 0);
+
+	// A pooled buffer is already the right size, so this just fills it
+	Map.ResetData(InitialValue);
+}
+
+void FGAGridMapPool::Release(FGAGridMap& Map)
+{
+	ReturnBuffer(Map.Data);
+	Map = FGAGridMap();
+}
+
+void FGAGridMapPool::Trim()
+{
+	auto TrimBuffers = [this](auto& Buffers)
+	{
+		for (const auto& Pair : Buffers)
+		{
+			for (const auto& Buffer : Pair.Value)
+			{
+				TotalBytes -= int64(Buffer.Num()) * Buffer.GetTypeSize();
+			}
+		}
+		Buffers.Empty();
+	};
+
+	TrimBuffers(FreeBuffers);
+	TrimBuffers(FreeHalfBuffers);
+	TrimBuffers(FreeUInt16Buffers);
+	TrimBuffers(FreeUInt8Buffers);
+}
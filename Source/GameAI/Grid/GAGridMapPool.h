@@ -0,0 +1,160 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GAGridMap.h"
+
+template <typename StoredType> struct TGAGridMap;
+
+
+// Recycles the dense storage of temporary FGAGridMaps and TGAGridMaps.
+//
+// Code that needs scratch maps every tick (spatial queries, occupancy updates) borrows them through TGAPooledGridMap,
+// which hands the buffer back when it goes out of scope. Buffers are matched on type and cell count, so once every
+// size in use has been seen the pool stops going to the heap at all.
+//
+// Game thread only. Borrowed maps are dense, and shouldn't be resized or made chunked while they're out.
+
+class FGAGridMapPool
+{
+public:
+	FGAGridMapPool() : OutstandingCount(0), HighWaterMark(0), AllocationCount(0), TotalBytes(0), PeakBytes(0) {}
+
+	// Set Map up over Box (as the FGAGridMap constructor would), reusing a pooled buffer of the right size if there is one
+	void Acquire(FGAGridMap& Map, const AGAGridActor* Grid, const FGridBox& Box, float InitialValue);
+
+	// Take Map's storage back into the pool, leaving Map empty
+	void Release(FGAGridMap& Map);
+
+	// Same for typed maps, which also take their quantization (see TGAGridMap). Needs GAGridMapTyped.h.
+	template <typename StoredType>
+	void Acquire(TGAGridMap<StoredType>& Map, const AGAGridActor* Grid, const FGridBox& Box, float InitialValue, float Scale = 1.0f, float Offset = 0.0f)
+	{
+		Map = TGAGridMap<StoredType>();
+		Map.Init(Grid, Box, Scale, Offset);
+		Map.Data = TakeBuffer<StoredType>(Box.IsValid() ? Box.GetCellCount() : 0);
+		Map.ResetData(InitialValue);
+	}
+
+	template <typename StoredType>
+	void Release(TGAGridMap<StoredType>& Map)
+	{
+		ReturnBuffer(Map.Data);
+		Map = TGAGridMap<StoredType>();
+	}
+
+	// Free every pooled buffer. Buffers that are out on loan are unaffected.
+	void Trim();
+
+	// Number of buffers out on loan right now
+	int32 GetOutstandingCount() const { return OutstandingCount; }
+
+	// The most buffers that have been out on loan at once
+	int32 GetHighWaterMark() const { return HighWaterMark; }
+
+	// How many times Acquire had to allocate a new buffer
+	int32 GetAllocationCount() const { return AllocationCount; }
+
+	// Bytes of buffers owned by the pool, whether pooled or out on loan, now and at most
+	int64 GetTotalBytes() const { return TotalBytes; }
+	int64 GetPeakBytes() const { return PeakBytes; }
+
+private:
+	// A free buffer of Count values if there is one, otherwise an empty array (which the map then allocates).
+	// Every call counts as a loan, even for an empty map, and has to be matched by a ReturnBuffer.
+	template <typename StoredType>
+	TArray<StoredType> TakeBuffer(int32 Count)
+	{
+		check(IsInGameThread());
+
+		TArray<StoredType> Result;
+		TArray<TArray<StoredType>>* FreeList = GetFreeBuffers<StoredType>().Find(Count);
+		if (FreeList && (FreeList->Num() > 0))
+		{
+			Result = FreeList->Pop(false);
+		}
+		else if (Count > 0)
+		{
+			AllocationCount++;
+			TotalBytes += int64(Count) * sizeof(StoredType);
+			PeakBytes = FMath::Max(PeakBytes, TotalBytes);
+		}
+
+		OutstandingCount++;
+		if (OutstandingCount > HighWaterMark)
+		{
+			HighWaterMark = OutstandingCount;
+			UE_LOG(LogTemp, Verbose, TEXT("Grid map pool high-water mark is now %d buffers (%lld bytes)"), HighWaterMark, PeakBytes);
+		}
+		return Result;
+	}
+
+	// End a loan, and move Buffer (if it holds anything) onto its free list
+	template <typename StoredType>
+	void ReturnBuffer(TArray<StoredType>& Buffer)
+	{
+		check(IsInGameThread());
+		check(OutstandingCount > 0);
+
+		OutstandingCount--;
+		if (Buffer.Num() > 0)
+		{
+			GetFreeBuffers<StoredType>().FindOrAdd(Buffer.Num()).Add(MoveTemp(Buffer));
+		}
+	}
+
+	template <typename StoredType>
+	TMap<int32, TArray<TArray<StoredType>>>& GetFreeBuffers();
+
+	// Free buffers of each type, by cell count
+	TMap<int32, TArray<TArray<float>>> FreeBuffers;
+	TMap<int32, TArray<TArray<FFloat16>>> FreeHalfBuffers;
+	TMap<int32, TArray<TArray<uint16>>> FreeUInt16Buffers;
+	TMap<int32, TArray<TArray<uint8>>> FreeUInt8Buffers;
+
+	int32 OutstandingCount;
+	int32 HighWaterMark;
+	int32 AllocationCount;
+	int64 TotalBytes;
+	int64 PeakBytes;
+};
+
+
+template <> inline TMap<int32, TArray<TArray<float>>>& FGAGridMapPool::GetFreeBuffers<float>() { return FreeBuffers; }
+template <> inline TMap<int32, TArray<TArray<FFloat16>>>& FGAGridMapPool::GetFreeBuffers<FFloat16>() { return FreeHalfBuffers; }
+template <> inline TMap<int32, TArray<TArray<uint16>>>& FGAGridMapPool::GetFreeBuffers<uint16>() { return FreeUInt16Buffers; }
+template <> inline TMap<int32, TArray<TArray<uint8>>>& FGAGridMapPool::GetFreeBuffers<uint8>() { return FreeUInt8Buffers; }
+
+
+// A map borrowed from a pool for the current scope. The arguments after the pool are those of FGAGridMapPool::Acquire.
+//
+//	FGAPooledGridMap GridMap(Grid->GetMapPool(), Grid, GridBox, 0.0f);
+//	EvaluateLayer(Layer, *GridMap);
+
+template <typename MapType>
+struct TGAPooledGridMap
+{
+	template <typename... ArgTypes>
+	TGAPooledGridMap(FGAGridMapPool& PoolIn, ArgTypes&&... Args) : Pool(PoolIn)
+	{
+		Pool.Acquire(Map, Forward<ArgTypes>(Args)...);
+	}
+
+	~TGAPooledGridMap()
+	{
+		Pool.Release(Map);
+	}
+
+	TGAPooledGridMap(const TGAPooledGridMap&) = delete;
+	TGAPooledGridMap& operator=(const TGAPooledGridMap&) = delete;
+
+	MapType& operator*() { return Map; }
+	const MapType& operator*() const { return Map; }
+	MapType* operator->() { return &Map; }
+	const MapType* operator->() const { return &Map; }
+
+private:
+	FGAGridMapPool& Pool;
+	MapType Map;
+};
+
+typedef TGAPooledGridMap<FGAGridMap> FGAPooledGridMap;
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GAGridMap.h"
+#include "GAGridMapKernels.h"
+#include "GAGridActor.h"
+
+
+// A grid map that stores its values as uint8, uint16, FFloat16 or float, for maps that don't need a full float per
+// cell: step-count distances, binary or coarse visibility, probabilities.
+//
+// Values go in and out as floats, Value = Stored * Scale + Offset. Integer storage rounds to the nearest step and
+// saturates at both ends of its range, and the top of the range reads back as UE_MAX_FLT, so "unreached" or "too far"
+// survives the trip (see FGAGridMapKernels::Quantize). Pick Scale and Offset so the values that matter fit in range.
+// The bottom end has no such meaning: anything below Offset (so any negative value, with the default Offset of 0)
+// would silently read back as Offset, so SetValue and FromFloatMap check for it in slow-check builds.
+//
+// Always dense, and not exposed to blueprint. ToFloatMap/FromFloatMap convert to and from the FGAGridMap float view
+// a row at a time with the conversion kernels.
+
+template <typename StoredType>
+struct TGAGridMap
+{
+	TGAGridMap() : XCount(INDEX_NONE), YCount(INDEX_NONE), GridBounds(), Scale(1.0f), Offset(0.0f) {}
+
+	TGAGridMap(const AGAGridActor* Grid, const FGridBox& GridBoxIn, float InitialValue, float ScaleIn = 1.0f, float OffsetIn = 0.0f)
+	{
+		Init(Grid, GridBoxIn, ScaleIn, OffsetIn);
+		ResetData(InitialValue);
+	}
+
+	// Set up the bounds and quantization, without touching the values
+	void Init(const AGAGridActor* Grid, const FGridBox& GridBoxIn, float ScaleIn = 1.0f, float OffsetIn = 0.0f)
+	{
+		check(ScaleIn != 0.0f);
+		XCount = Grid->XCount;
+		YCount = Grid->YCount;
+		GridBounds = GridBoxIn;
+		Scale = ScaleIn;
+		Offset = OffsetIn;
+	}
+
+	void ResetData(float InitialValue)
+	{
+		if (GridBounds.IsValid())
+		{
+			StoredType Stored;
+			FGAGridMapKernels::Quantize(&InitialValue, 1, &Stored, Scale, Offset);
+
+			// Keeps the allocation if it's already the right size (e.g. a pooled buffer)
+			Data.SetNumUninitialized(GridBounds.GetCellCount(), false);
+			for (StoredType& Value : Data)
+			{
+				Value = Stored;
+			}
+		}
+		else
+		{
+			Data.Empty();
+		}
+	}
+
+	int32 XCount;
+	int32 YCount;
+	FGridBox GridBounds;
+
+	// Dense storage, one value per cell of GridBounds
+	TArray<StoredType> Data;
+
+	float GetScale() const { return Scale; }
+	float GetOffset() const { return Offset; }
+
+	// Would Value be stored as is (to within a step), rather than saturating? Always true for half and float storage.
+	bool CanStore(float Value) const
+	{
+		if constexpr (TIsIntegral<StoredType>::Value)
+		{
+			return !IsBelowRange(Value) && ((Value - Offset) / Scale + 0.5f < float(TNumericLimits<StoredType>::Max()));
+		}
+		else
+		{
+			return true;
+		}
+	}
+
+	// Would Value be clamped up to Offset? Saturating at the top is how "too far" is stored, but nothing should be
+	// stored below the range.
+	bool IsBelowRange(float Value) const
+	{
+		if constexpr (TIsIntegral<StoredType>::Value)
+		{
+			return (Value - Offset) / Scale + 0.5f < 0.0f;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	FORCEINLINE bool IsValid() const
+	{
+		return GridBounds.IsValid() && (GridBounds.GetCellCount() == Data.Num());
+	}
+
+	bool GetValue(const FCellRef& Cell, float& ValueOut) const
+	{
+		if (IsValid() && GridBounds.IsValidCell(Cell))
+		{
+			FGAGridMapKernels::Dequantize(&Data[GetIndex(Cell)], 1, &ValueOut, Scale, Offset);
+			return true;
+		}
+		return false;
+	}
+
+	bool SetValue(const FCellRef& Cell, float Value)
+	{
+		if (IsValid() && GridBounds.IsValidCell(Cell))
+		{
+			checkSlow(!IsBelowRange(Value));
+			FGAGridMapKernels::Quantize(&Value, 1, &Data[GetIndex(Cell)], Scale, Offset);
+			return true;
+		}
+		return false;
+	}
+
+	// Copy Count values of row Y, starting at cell MinX. All of those cells must be inside GridBounds.
+	void GetRowValues(int32 Y, int32 MinX, int32 Count, float* ValuesOut) const
+	{
+		FGAGridMapKernels::Dequantize(&Data[GetIndex(FCellRef(MinX, Y))], Count, ValuesOut, Scale, Offset);
+	}
+
+	void SetRowValues(int32 Y, int32 MinX, int32 Count, const float* Values)
+	{
+		FGAGridMapKernels::Quantize(Values, Count, &Data[GetIndex(FCellRef(MinX, Y))], Scale, Offset);
+	}
+
+	// Set MapOut up as a float map over the same cells, with the same values
+	void ToFloatMap(FGAGridMap& MapOut) const
+	{
+		MapOut = FGAGridMap();
+		MapOut.XCount = XCount;
+		MapOut.YCount = YCount;
+		MapOut.GridBounds = GridBounds;
+		MapOut.ResetData(0.0f);
+
+		if (IsValid())
+		{
+			// Same bounds and both dense, so the whole map converts in one go
+			FGAGridMapKernels::Dequantize(Data.GetData(), Data.Num(), MapOut.Data.GetData(), Scale, Offset);
+			MapOut.RecomputeActiveBounds();
+		}
+	}
+
+	// Take on Map's bounds and values, keeping my Scale and Offset
+	void FromFloatMap(const FGAGridMap& Map)
+	{
+		XCount = Map.XCount;
+		YCount = Map.YCount;
+		GridBounds = Map.GridBounds;
+		ResetData(0.0f);
+
+		if (IsValid() && Map.IsValid())
+		{
+			ConvertRows(Map);
+		}
+	}
+
+	// Take on another typed map's bounds and values, keeping my Scale and Offset
+	template <typename OtherStoredType>
+	void FromMap(const TGAGridMap<OtherStoredType>& Map)
+	{
+		XCount = Map.XCount;
+		YCount = Map.YCount;
+		GridBounds = Map.GridBounds;
+		ResetData(0.0f);
+
+		if (IsValid() && Map.IsValid())
+		{
+			ConvertRows(Map);
+		}
+	}
+
+private:
+	FORCEINLINE int32 GetIndex(const FCellRef& Cell) const
+	{
+		return (Cell.Y - GridBounds.MinY) * GridBounds.GetWidth() + (Cell.X - GridBounds.MinX);
+	}
+
+	// Convert a row at a time through a float scratch row. Map must have the same bounds as me.
+	template <typename MapType>
+	void ConvertRows(const MapType& Map)
+	{
+		TArray<float, TInlineAllocator<512>> Row;
+		Row.SetNumUninitialized(GridBounds.GetWidth());
+		for (int32 Y = GridBounds.MinY; Y <= GridBounds.MaxY; Y++)
+		{
+			Map.GetRowValues(Y, GridBounds.MinX, Row.Num(), Row.GetData());
+#if DO_GUARD_SLOW
+			for (float Value : Row)
+			{
+				checkSlow(!IsBelowRange(Value));
+			}
+#endif
+			SetRowValues(Y, GridBounds.MinX, Row.Num(), Row.GetData());
+		}
+	}
+
+	float Scale;
+	float Offset;
+};
+
+// Whole-number distances (e.g. Dijkstra step costs) up to 65534, with unreached cells reading back as UE_MAX_FLT
+typedef TGAGridMap<uint16> FGAGridDistanceMap;
@@ -0,0 +1,178 @@
+#include "GAGridPyramid.h"
+
+
+void FGAGridPyramid::Build(const FGAGridBitPlane& Bits)
+{
+	LevelSizes.Reset();
+	Levels.Reset();
+
+	FIntPoint Size(Bits.GetXCount(), Bits.GetYCount());
+	LevelSizes.Add(Size);
+
+	if ((Size.X == 0) || (Size.Y == 0))
+	{
+		return;
+	}
+
+	while ((Size.X > 1) || (Size.Y > 1))
+	{
+		Size = FIntPoint(FMath::DivideAndRoundUp(Size.X, 2), FMath::DivideAndRoundUp(Size.Y, 2));
+		LevelSizes.Add(Size);
+		Levels.AddDefaulted_GetRef().SetNumUninitialized(Size.X * Size.Y);
+	}
+
+	for (int32 Level = 1; Level < LevelSizes.Num(); Level++)
+	{
+		RefreshLevel(Bits, Level, FIntRect(0, 0, LevelSizes[Level].X - 1, LevelSizes[Level].Y - 1));
+	}
+}
+
+void FGAGridPyramid::Refresh(const FGAGridBitPlane& Bits, const FIntRect& CellRect)
+{
+	if ((LevelSizes.Num() == 0) || (LevelSizes[0] != FIntPoint(Bits.GetXCount(), Bits.GetYCount())))
+	{
+		Build(Bits);
+		return;
+	}
+
+	for (int32 Level = 1; Level < LevelSizes.Num(); Level++)
+	{
+		const FIntPoint& Size = LevelSizes[Level];
+		FIntRect LevelRect(
+			FMath::Max(CellRect.Min.X >> Level, 0),
+			FMath::Max(CellRect.Min.Y >> Level, 0),
+			FMath::Min(CellRect.Max.X >> Level, Size.X - 1),
+			FMath::Min(CellRect.Max.Y >> Level, Size.Y - 1));
+
+		RefreshLevel(Bits, Level, LevelRect);
+	}
+}
+
+EGACellCoverage FGAGridPyramid::GetCoverage(const FGAGridBitPlane& Bits, int32 Level, int32 X, int32 Y) const
+{
+	if (Level == 0)
+	{
+		return Bits.Get(X, Y) ? EGACellCoverage::All : EGACellCoverage::None;
+	}
+	return Levels[Level - 1][Y * LevelSizes[Level].X + X];
+}
+
+void FGAGridPyramid::RefreshLevel(const FGAGridBitPlane& Bits, int32 Level, const FIntRect& LevelRect)
+{
+	const FIntPoint& ChildSize = LevelSizes[Level - 1];
+	const int32 LevelWidth = LevelSizes[Level].X;
+	TArray<EGACellCoverage>& Coverage = Levels[Level - 1];
+
+	for (int32 Y = LevelRect.Min.Y; Y <= LevelRect.Max.Y; Y++)
+	{
+		for (int32 X = LevelRect.Min.X; X <= LevelRect.Max.X; X++)
+		{
+			bool bAnyAll = false;
+			bool bAnyNone = false;
+			bool bAnySome = false;
+
+			// Up to four children, fewer along the far edges
+			for (int32 ChildY = 2 * Y; ChildY <= FMath::Min(2 * Y + 1, ChildSize.Y - 1); ChildY++)
+			{
+				for (int32 ChildX = 2 * X; ChildX <= FMath::Min(2 * X + 1, ChildSize.X - 1); ChildX++)
+				{
+					switch (GetCoverage(Bits, Level - 1, ChildX, ChildY))
+					{
+					case EGACellCoverage::All:	bAnyAll = true; break;
+					case EGACellCoverage::None:	bAnyNone = true; break;
+					default:					bAnySome = true; break;
+					}
+				}
+			}
+
+			EGACellCoverage Result = EGACellCoverage::Some;
+			if (!bAnySome && !bAnyNone)
+			{
+				Result = EGACellCoverage::All;
+			}
+			else if (!bAnySome && !bAnyAll)
+			{
+				Result = EGACellCoverage::None;
+			}
+			Coverage[Y * LevelWidth + X] = Result;
+		}
+	}
+}
+
+EGACellCoverage FGAGridPyramid::GetRectCoverage(const FGAGridBitPlane& Bits, const FIntRect& CellRect) const
+{
+	if (LevelSizes.Num() == 0)
+	{
+		return EGACellCoverage::None;
+	}
+
+	// Clip to the grid. Cells off the grid aren't traversable.
+	const FIntPoint& GridSize = LevelSizes[0];
+	FIntRect Clipped(
+		FMath::Max(CellRect.Min.X, 0),
+		FMath::Max(CellRect.Min.Y, 0),
+		FMath::Min(CellRect.Max.X, GridSize.X - 1),
+		FMath::Min(CellRect.Max.Y, GridSize.Y - 1));
+
+	if ((Clipped.Min.X > Clipped.Max.X) || (Clipped.Min.Y > Clipped.Max.Y))
+	{
+		return EGACellCoverage::None;
+	}
+
+	EGACellCoverage Result = GetRectCoverage(Bits, Clipped, LevelSizes.Num() - 1, 0, 0);
+
+	// Anything hanging off the grid makes an "All" into a "Some"
+	const bool bClipped = (Clipped.Min != CellRect.Min) || (Clipped.Max != CellRect.Max);
+	if (bClipped && (Result == EGACellCoverage::All))
+	{
+		Result = EGACellCoverage::Some;
+	}
+	return Result;
+}
+
+EGACellCoverage FGAGridPyramid::GetRectCoverage(const FGAGridBitPlane& Bits, const FIntRect& CellRect, int32 Level, int32 X, int32 Y) const
+{
+	const EGACellCoverage Coverage = GetCoverage(Bits, Level, X, Y);
+	const FIntRect BlockRect = LevelCellToCellRect(Level, FIntPoint(X, Y));
+
+	// Uniform blocks, and blocks entirely inside the rect, answer for themselves
+	const bool bInside = (BlockRect.Min.X >= CellRect.Min.X) && (BlockRect.Max.X <= CellRect.Max.X)
+		&& (BlockRect.Min.Y >= CellRect.Min.Y) && (BlockRect.Max.Y <= CellRect.Max.Y);
+	if ((Coverage != EGACellCoverage::Some) || bInside)
+	{
+		return Coverage;
+	}
+
+	// Otherwise combine the children that overlap the rect
+	bool bAnyAll = false;
+	bool bAnyNone = false;
+	const FIntPoint& ChildSize = LevelSizes[Level - 1];
+
+	for (int32 ChildY = 2 * Y; ChildY <= FMath::Min(2 * Y + 1, ChildSize.Y - 1); ChildY++)
+	{
+		for (int32 ChildX = 2 * X; ChildX <= FMath::Min(2 * X + 1, ChildSize.X - 1); ChildX++)
+		{
+			const FIntRect ChildRect = LevelCellToCellRect(Level - 1, FIntPoint(ChildX, ChildY));
+			const bool bOverlaps = (ChildRect.Min.X <= CellRect.Max.X) && (ChildRect.Max.X >= CellRect.Min.X)
+				&& (ChildRect.Min.Y <= CellRect.Max.Y) && (ChildRect.Max.Y >= CellRect.Min.Y);
+			if (!bOverlaps)
+			{
+				continue;
+			}
+
+			switch (GetRectCoverage(Bits, CellRect, Level - 1, ChildX, ChildY))
+			{
+			case EGACellCoverage::All:	bAnyAll = true; break;
+			case EGACellCoverage::None:	bAnyNone = true; break;
+			default:					return EGACellCoverage::Some;
+			}
+
+			if (bAnyAll && bAnyNone)
+			{
+				return EGACellCoverage::Some;
+			}
+		}
+	}
+
+	return bAnyAll ? EGACellCoverage::All : EGACellCoverage::None;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GAGridBitPlane.h"
+
+
+// How much of an area is traversable
+enum class EGACellCoverage : uint8
+{
+	None,		// no traversable cells
+	Some,		// a mix
+	All			// every cell is traversable
+};
+
+
+// A mip-style pyramid over a traversability bit plane.
+// Level 0 is the bit plane itself. Each cell of level L covers a 2^L x 2^L block of grid cells, so the
+// coarse cell containing grid cell (X, Y) at level L is (X >> L, Y >> L). The top level is a single cell.
+// Blocks that hang off the far edges of the grid only count the grid cells they actually contain.
+
+struct FGAGridPyramid
+{
+	// Rebuild every level from scratch
+	void Build(const FGAGridBitPlane& Bits);
+
+	// Rebuild only the coarse cells that overlap the given (inclusive) rect of grid cells
+	void Refresh(const FGAGridBitPlane& Bits, const FIntRect& CellRect);
+
+	// Number of levels, including level 0
+	int32 GetLevelCount() const { return LevelSizes.Num(); }
+
+	FIntPoint GetLevelSize(int32 Level) const { return LevelSizes[Level]; }
+
+	EGACellCoverage GetCoverage(const FGAGridBitPlane& Bits, int32 Level, int32 X, int32 Y) const;
+
+	// Coverage of an arbitrary (inclusive) rect of grid cells. Walks down from the top of the pyramid,
+	// only descending into blocks that are mixed and straddle the rect's edge.
+	EGACellCoverage GetRectCoverage(const FGAGridBitPlane& Bits, const FIntRect& CellRect) const;
+
+	// Conversions between grid cells and coarse cells
+
+	static FIntPoint CellToLevelCell(const FIntPoint& Cell, int32 Level)
+	{
+		return FIntPoint(Cell.X >> Level, Cell.Y >> Level);
+	}
+
+	// The (inclusive) rect of grid cells covered by the given coarse cell, clipped to the grid
+	FIntRect LevelCellToCellRect(int32 Level, const FIntPoint& LevelCell) const
+	{
+		const FIntPoint& GridSize = LevelSizes[0];
+		return FIntRect(
+			LevelCell.X << Level,
+			LevelCell.Y << Level,
+			FMath::Min(((LevelCell.X + 1) << Level) - 1, GridSize.X - 1),
+			FMath::Min(((LevelCell.Y + 1) << Level) - 1, GridSize.Y - 1));
+	}
+
+private:
+	void RefreshLevel(const FGAGridBitPlane& Bits, int32 Level, const FIntRect& LevelRect);
+
+	EGACellCoverage GetRectCoverage(const FGAGridBitPlane& Bits, const FIntRect& CellRect, int32 Level, int32 X, int32 Y) const;
+
+	// Sizes of every level, level 0 included
+	TArray<FIntPoint> LevelSizes;
+
+	// Coverage for levels 1 and up, i.e. Levels[L - 1] holds level L
+	TArray<TArray<EGACellCoverage>> Levels;
+};
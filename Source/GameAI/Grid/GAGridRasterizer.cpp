@@ -0,0 +1,228 @@
+#include "GAGridRasterizer.h"
+#include "GAGridActor.h"
+#include "Async/ParallelFor.h"
+
+
+FGAGridHeightQuantizer FGAGridHeightQuantizer::FromTiles(TConstArrayView<FGANavTilePolys> Tiles, float Margin, float MinStep)
+{
+	float MinHeight = MAX_flt;
+	float MaxHeight = -MAX_flt;
+	for (const FGANavTilePolys& Tile : Tiles)
+	{
+		for (float Height : Tile.VertHeights)
+		{
+			MinHeight = FMath::Min(MinHeight, Height);
+			MaxHeight = FMath::Max(MaxHeight, Height);
+		}
+	}
+
+	FGAGridHeightQuantizer Result;
+	if (MinHeight <= MaxHeight)
+	{
+		Result.Offset = MinHeight - Margin;
+		Result.Step = FMath::Max((MaxHeight - MinHeight + 2.0f * Margin) / float(NoHeight - 1), MinStep);
+	}
+	return Result;
+}
+
+
+void FGAPolyRasterizer::RasterizeTile(const FGANavTilePolys& Tile, const FIntRect& ClipRect, bool bLegacy, TArray<ECellData>& TileCellsOut,
+	TArray<uint16>* TileHeightsOut, const FGAGridHeightQuantizer& Quantizer)
+{
+	const int32 ClipWidth = ClipRect.Max.X - ClipRect.Min.X + 1;
+	const int32 ClipHeight = ClipRect.Max.Y - ClipRect.Min.Y + 1;
+
+	TileCellsOut.SetNumZeroed(ClipWidth * ClipHeight);
+
+	const bool bHeights = (TileHeightsOut != NULL) && (Tile.VertHeights.Num() == Tile.Verts.Num());
+	if (TileHeightsOut)
+	{
+		TileHeightsOut->Init(FGAGridHeightQuantizer::NoHeight, ClipWidth * ClipHeight);
+	}
+
+	// The plane of the poly being rasterized, as Z = PlaneZ + (X - PlaneX) * DZDX + (Y - PlaneY) * DZDY in grid space
+	FVector2D PlaneOrigin = FVector2D::ZeroVector;
+	float PlaneZ = 0.0f;
+	float DZDX = 0.0f;
+	float DZDY = 0.0f;
+
+	// The flags of the poly being rasterized
+	ECellData PolyFlags = ECellData::CellDataTraversable;
+
+	auto FillSpan = [&](int32 Y, int32 MinX, int32 MaxX)
+	{
+		const int32 RowStart = (Y - ClipRect.Min.Y) * ClipWidth - ClipRect.Min.X;
+		ECellData* Row = TileCellsOut.GetData() + RowStart;
+		for (int32 X = MinX; X <= MaxX; X++)
+		{
+			EnumAddFlags(Row[X], PolyFlags);
+		}
+
+		if (bHeights)
+		{
+			uint16* HeightRow = TileHeightsOut->GetData() + RowStart;
+			const float CenterY = (float(Y) + 0.5f) * CellScale;
+			for (int32 X = MinX; X <= MaxX; X++)
+			{
+				const float CenterX = (float(X) + 0.5f) * CellScale;
+				const uint16 Height = Quantizer.Quantize(PlaneZ + (CenterX - PlaneOrigin.X) * DZDX + (CenterY - PlaneOrigin.Y) * DZDY);
+
+				// Where polys overlap (bridges, ramps over floors) keep the highest
+				if ((HeightRow[X] == FGAGridHeightQuantizer::NoHeight) || (Height > HeightRow[X]))
+				{
+					HeightRow[X] = Height;
+				}
+			}
+		}
+	};
+
+	const float HalfScale = 0.5f * CellScale;
+	int32 FirstVert = 0;
+	const bool bPolyFlags = (Tile.PolyFlags.Num() == Tile.PolyVertCounts.Num());
+
+	for (int32 PolyIndex = 0; PolyIndex < Tile.PolyVertCounts.Num(); PolyIndex++)
+	{
+		const int32 VertCount = Tile.PolyVertCounts[PolyIndex];
+		TConstArrayView<FVector2D> PolyVerts(Tile.Verts.GetData() + FirstVert, VertCount);
+
+		PolyFlags = ECellData::CellDataTraversable;
+		if (bPolyFlags)
+		{
+			EnumAddFlags(PolyFlags, Tile.PolyFlags[PolyIndex]);
+		}
+
+		if (bHeights)
+		{
+			TConstArrayView<float> PolyHeights(Tile.VertHeights.GetData() + FirstVert, VertCount);
+			ComputePolyPlane(PolyVerts, PolyHeights, PlaneOrigin, PlaneZ, DZDX, DZDY);
+		}
+
+		FirstVert += VertCount;
+
+		if (bLegacy)
+		{
+			FBox2D PolyBounds(EForceInit::ForceInit);
+			for (const FVector2D& Vert : PolyVerts)
+			{
+				PolyBounds += Vert;
+			}
+
+			// Same rounding as AGAGridActor::GridSpaceBoundsToRect2D, clipped to ClipRect
+			FIntRect PolyRect;
+			PolyRect.Min.X = FMath::Max(int32((PolyBounds.Min.X + HalfScale) / CellScale), ClipRect.Min.X);
+			PolyRect.Max.X = FMath::Min(int32((PolyBounds.Max.X - HalfScale) / CellScale), ClipRect.Max.X);
+			PolyRect.Min.Y = FMath::Max(int32((PolyBounds.Min.Y + HalfScale) / CellScale), ClipRect.Min.Y);
+			PolyRect.Max.Y = FMath::Min(int32((PolyBounds.Max.Y - HalfScale) / CellScale), ClipRect.Max.Y);
+
+			if ((PolyRect.Min.X <= PolyRect.Max.X) && (PolyRect.Min.Y <= PolyRect.Max.Y))
+			{
+				RasterizeHalfPlane(PolyVerts, PolyRect, FillSpan);
+			}
+		}
+		else
+		{
+			RasterizeScanline(PolyVerts, ClipRect, FillSpan);
+		}
+	}
+}
+
+void FGAPolyRasterizer::ComputePolyPlane(TConstArrayView<FVector2D> Verts, TConstArrayView<float> Heights, FVector2D& OriginOut, float& ZOut, float& DZDXOut, float& DZDYOut)
+{
+	// Newell's method, which copes with polys that aren't quite planar
+	FVector Normal = FVector::ZeroVector;
+	FVector Centroid = FVector::ZeroVector;
+	const int32 VertCount = Verts.Num();
+	float MaxHeight = -MAX_flt;
+
+	for (int32 V0Index = 0; V0Index < VertCount; V0Index++)
+	{
+		const int32 V1Index = (V0Index + 1) % VertCount;
+		const FVector V0(Verts[V0Index], Heights[V0Index]);
+		const FVector V1(Verts[V1Index], Heights[V1Index]);
+
+		Normal.X += (V0.Y - V1.Y) * (V0.Z + V1.Z);
+		Normal.Y += (V0.Z - V1.Z) * (V0.X + V1.X);
+		Normal.Z += (V0.X - V1.X) * (V0.Y + V1.Y);
+		Centroid += V0;
+		MaxHeight = FMath::Max(MaxHeight, Heights[V0Index]);
+	}
+	Centroid /= float(FMath::Max(VertCount, 1));
+
+	OriginOut = FVector2D(Centroid);
+	if (FMath::Abs(Normal.Z) > UE_KINDA_SMALL_NUMBER * Normal.Size())
+	{
+		ZOut = Centroid.Z;
+		DZDXOut = -Normal.X / Normal.Z;
+		DZDYOut = -Normal.Y / Normal.Z;
+	}
+	else
+	{
+		// A (nearly) vertical poly has no sensible plane over the ground, so use its top
+		ZOut = MaxHeight;
+		DZDXOut = 0.0f;
+		DZDYOut = 0.0f;
+	}
+}
+
+void FGAPolyRasterizer::RasterizeTiles(TConstArrayView<FGANavTilePolys> Tiles, const FIntRect& ClipRect, float CellScale, int32 XCount, bool bLegacy, bool bParallel, ECellData* CellDataOut,
+	uint16* HeightsOut, const FGAGridHeightQuantizer& Quantizer)
+{
+	// The part of each tile that falls inside ClipRect. Tiles that miss it entirely are skipped.
+	TArray<int32> ClippedTiles;
+	TArray<FIntRect> ClippedRects;
+	for (int32 TileIndex = 0; TileIndex < Tiles.Num(); TileIndex++)
+	{
+		FIntRect ClippedRect;
+		if (IntersectCellRects(Tiles[TileIndex].CellRect, ClipRect, ClippedRect))
+		{
+			ClippedTiles.Add(TileIndex);
+			ClippedRects.Add(ClippedRect);
+		}
+	}
+
+	// One scratch buffer per tile, so the workers never write to the same memory
+	TArray<TArray<ECellData>> TileCells;
+	TArray<TArray<uint16>> TileHeights;
+	TileCells.SetNum(ClippedTiles.Num());
+	TileHeights.SetNum(HeightsOut ? ClippedTiles.Num() : 0);
+
+	ParallelFor(ClippedTiles.Num(), [&Tiles, &ClippedTiles, &ClippedRects, &TileCells, &TileHeights, &Quantizer, CellScale, bLegacy, HeightsOut](int32 Index)
+	{
+		FGAPolyRasterizer Rasterizer(CellScale);
+		Rasterizer.RasterizeTile(Tiles[ClippedTiles[Index]], ClippedRects[Index], bLegacy, TileCells[Index], HeightsOut ? &TileHeights[Index] : NULL, Quantizer);
+	},
+	bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	// Merge. Neighboring tiles can share border cells, so this part stays serial.
+	for (int32 Index = 0; Index < ClippedTiles.Num(); Index++)
+	{
+		const FIntRect& TileRect = ClippedRects[Index];
+		const int32 TileWidth = TileRect.Max.X - TileRect.Min.X + 1;
+		const ECellData* TileRow = TileCells[Index].GetData();
+		const uint16* TileHeightRow = HeightsOut ? TileHeights[Index].GetData() : NULL;
+
+		for (int32 Y = TileRect.Min.Y; Y <= TileRect.Max.Y; Y++)
+		{
+			ECellData* GridRow = CellDataOut + Y * XCount + TileRect.Min.X;
+			for (int32 X = 0; X < TileWidth; X++)
+			{
+				EnumAddFlags(GridRow[X], TileRow[X]);
+			}
+			TileRow += TileWidth;
+
+			if (TileHeightRow)
+			{
+				uint16* GridHeightRow = HeightsOut + Y * XCount + TileRect.Min.X;
+				for (int32 X = 0; X < TileWidth; X++)
+				{
+					const uint16 Height = TileHeightRow[X];
+					if ((Height != FGAGridHeightQuantizer::NoHeight) && ((GridHeightRow[X] == FGAGridHeightQuantizer::NoHeight) || (Height > GridHeightRow[X])))
+					{
+						GridHeightRow[X] = Height;
+					}
+				}
+				TileHeightRow += TileWidth;
+			}
+		}
+	}
+}
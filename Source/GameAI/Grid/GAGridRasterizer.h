@@ -0,0 +1,291 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ECellData : uint8;
+
+
+// Helpers for turning nav mesh polygons into cells of an AGAGridActor.
+//
+// All vertex coordinates are in grid space (see AGAGridActor::GetCellGridSpacePosition), i.e. (0, 0)
+// is the min corner of the (0, 0) cell. A cell is covered by a polygon if its center lies inside the polygon.
+//
+// Results are reported as horizontal runs of cells through a callback of the form
+//		void OnSpan(int32 Y, int32 MinX, int32 MaxX)		// MinX and MaxX are inclusive
+// Only cells inside ClipRect (also inclusive on both ends, same convention as GridSpaceBoundsToRect2D) are reported.
+//
+// The rasterizer keeps its edge buffers around between calls, so reuse one instance for a whole batch of polys.
+
+
+// The polys of a single nav mesh tile, already transformed into grid space.
+// Gathering has to happen on the game thread, but once gathered a tile can be rasterized anywhere.
+struct FGANavTilePolys
+{
+	// The cells this tile's polys can possibly cover (inclusive, clipped to the grid)
+	FIntRect CellRect;
+
+	// The verts of every poly, back to back. PolyVertCounts says how to split them up.
+	TArray<FVector2D> Verts;
+	TArray<int32> PolyVertCounts;
+
+	// Actor-space Z of each vert, parallel to Verts
+	TArray<float> VertHeights;
+
+	// Extra flags (from the poly's nav area) for the cells each poly covers, parallel to PolyVertCounts
+	TArray<ECellData> PolyFlags;
+
+	// Hash of the tile's grid-space polys. If this changes between two gathers, the tile's cells need refreshing.
+	uint32 Hash = 0;
+
+	void RefreshHash()
+	{
+		Hash = FCrc::MemCrc32(Verts.GetData(), Verts.Num() * Verts.GetTypeSize());
+		Hash = FCrc::MemCrc32(PolyVertCounts.GetData(), PolyVertCounts.Num() * PolyVertCounts.GetTypeSize(), Hash);
+		Hash = FCrc::MemCrc32(VertHeights.GetData(), VertHeights.Num() * VertHeights.GetTypeSize(), Hash);
+		Hash = FCrc::MemCrc32(PolyFlags.GetData(), PolyFlags.Num() * PolyFlags.GetTypeSize(), Hash);
+	}
+};
+
+
+// Ground heights are stored per cell as a uint16, meaning Offset + Value * Step.
+// NoHeight marks cells with no ground under them.
+struct FGAGridHeightQuantizer
+{
+	static constexpr uint16 NoHeight = MAX_uint16;
+
+	float Offset = 0.0f;
+	float Step = 1.0f;
+
+	// Heights outside the representable range get clamped
+	uint16 Quantize(float Height) const
+	{
+		return uint16(FMath::Clamp(FMath::RoundToInt32((Height - Offset) / Step), 0, int32(NoHeight) - 1));
+	}
+
+	float Dequantize(uint16 Value) const
+	{
+		return Offset + float(Value) * Step;
+	}
+
+	// Cover the heights of every vert of the tiles, plus Margin above and below for geometry that shows up later
+	static FGAGridHeightQuantizer FromTiles(TConstArrayView<FGANavTilePolys> Tiles, float Margin = 1000.0f, float MinStep = 0.5f);
+};
+
+
+struct FGAPolyRasterizer
+{
+	explicit FGAPolyRasterizer(float CellScaleIn) : CellScale(CellScaleIn) {}
+
+	// Rasterize every poly of the tile into TileCellsOut, a scratch buffer covering ClipRect row by row.
+	// ClipRect must lie within Tile.CellRect.
+	// If TileHeightsOut is given, it gets the quantized ground height of each covered cell in the same layout, taken from
+	// the plane of the highest poly covering the cell's center.
+	void RasterizeTile(const FGANavTilePolys& Tile, const FIntRect& ClipRect, bool bLegacy, TArray<ECellData>& TileCellsOut,
+		TArray<uint16>* TileHeightsOut = NULL, const FGAGridHeightQuantizer& Quantizer = FGAGridHeightQuantizer());
+
+	// Rasterize a batch of tiles into the cells of ClipRect in CellDataOut, a full XCount-wide grid.
+	// The cells in ClipRect are assumed to be zeroed, nothing outside of it is touched.
+	// HeightsOut is optional and laid out like CellDataOut. Its cells in ClipRect are assumed to be NoHeight.
+	// If bParallel, each tile gets rasterized into its own scratch buffer on a worker thread, and the buffers
+	// are merged once they're all done. Safe to call from any thread.
+	static void RasterizeTiles(TConstArrayView<FGANavTilePolys> Tiles, const FIntRect& ClipRect, float CellScale, int32 XCount, bool bLegacy, bool bParallel, ECellData* CellDataOut,
+		uint16* HeightsOut = NULL, const FGAGridHeightQuantizer& Quantizer = FGAGridHeightQuantizer());
+
+	// Intersection of two inclusive cell rects. Returns false if they are disjoint.
+	static bool IntersectCellRects(const FIntRect& A, const FIntRect& B, FIntRect& RectOut)
+	{
+		RectOut.Min.X = FMath::Max(A.Min.X, B.Min.X);
+		RectOut.Min.Y = FMath::Max(A.Min.Y, B.Min.Y);
+		RectOut.Max.X = FMath::Min(A.Max.X, B.Max.X);
+		RectOut.Max.Y = FMath::Min(A.Max.Y, B.Max.Y);
+		return (RectOut.Min.X <= RectOut.Max.X) && (RectOut.Min.Y <= RectOut.Max.Y);
+	}
+
+	// Edge-table scanline rasterizer.
+	// Walks the rows covered by the poly and emits one span per pair of edge crossings at the row's center line.
+	// Works for any simple polygon, not just convex ones.
+	template <typename SpanFuncType>
+	void RasterizeScanline(TConstArrayView<FVector2D> Verts, const FIntRect& ClipRect, SpanFuncType&& OnSpan);
+
+	// The original approach: test every cell center in ClipRect against every edge of the poly.
+	// Assumes a convex poly with the nav mesh's winding. Kept around for comparison against RasterizeScanline.
+	template <typename SpanFuncType>
+	void RasterizeHalfPlane(TConstArrayView<FVector2D> Verts, const FIntRect& ClipRect, SpanFuncType&& OnSpan);
+
+	// Fit a plane through a poly's grid-space verts and their heights
+	static void ComputePolyPlane(TConstArrayView<FVector2D> Verts, TConstArrayView<float> Heights, FVector2D& OriginOut, float& ZOut, float& DZDXOut, float& DZDYOut);
+
+private:
+	struct FEdge
+	{
+		int32 RowStart;			// first row whose center line crosses this edge
+		int32 RowEnd;			// last row whose center line crosses this edge
+		double XAtRowStart;		// x crossing (in cells) at RowStart's center line
+		double DXDY;			// change in x crossing per row
+	};
+
+	float CellScale;
+
+	// Scratch, reused between polys
+	TArray<FEdge, TInlineAllocator<16>> Edges;
+	TArray<int32, TInlineAllocator<16>> ActiveEdges;
+	TArray<double, TInlineAllocator<16>> Crossings;
+	TArray<FVector2D, TInlineAllocator<16>> OutsideVectors;
+};
+
+
+template <typename SpanFuncType>
+void FGAPolyRasterizer::RasterizeScanline(TConstArrayView<FVector2D> Verts, const FIntRect& ClipRect, SpanFuncType&& OnSpan)
+{
+	const int32 VertCount = Verts.Num();
+	if ((VertCount < 3) || (ClipRect.Min.X > ClipRect.Max.X) || (ClipRect.Min.Y > ClipRect.Max.Y))
+	{
+		return;
+	}
+
+	const double InvScale = 1.0 / double(CellScale);
+
+	// Build the edge table
+	// Row R's center line is at y = R + 0.5 (in cells). An edge crosses row R if Top <= R + 0.5 < Bottom.
+	// The half-open test means a vertex shared by two edges is only counted once, so every row gets an even number of crossings.
+
+	Edges.Reset();
+	for (int32 V0Index = 0; V0Index < VertCount; V0Index++)
+	{
+		const FVector2D& V0 = Verts[V0Index];
+		const FVector2D& V1 = Verts[(V0Index + 1) % VertCount];
+
+		const double Y0 = V0.Y * InvScale;
+		const double Y1 = V1.Y * InvScale;
+		if (Y0 == Y1)
+		{
+			// Horizontal edges never cross a center line
+			continue;
+		}
+
+		const bool bV0IsTop = Y0 < Y1;
+		const double TopX = (bV0IsTop ? V0.X : V1.X) * InvScale;
+		const double TopY = bV0IsTop ? Y0 : Y1;
+		const double BottomY = bV0IsTop ? Y1 : Y0;
+
+		FEdge Edge;
+		Edge.RowStart = FMath::CeilToInt32(TopY - 0.5);
+		Edge.RowEnd = FMath::CeilToInt32(BottomY - 0.5) - 1;
+		Edge.DXDY = ((V1.X - V0.X) * InvScale) / (Y1 - Y0);
+
+		// Clip to the rows we care about
+		Edge.RowStart = FMath::Max(Edge.RowStart, ClipRect.Min.Y);
+		Edge.RowEnd = FMath::Min(Edge.RowEnd, ClipRect.Max.Y);
+		if (Edge.RowStart > Edge.RowEnd)
+		{
+			continue;
+		}
+
+		Edge.XAtRowStart = TopX + ((double(Edge.RowStart) + 0.5) - TopY) * Edge.DXDY;
+		Edges.Add(Edge);
+	}
+
+	if (Edges.Num() < 2)
+	{
+		return;
+	}
+
+	Edges.Sort([](const FEdge& A, const FEdge& B) { return A.RowStart < B.RowStart; });
+
+	int32 LastRow = Edges[0].RowEnd;
+	for (const FEdge& Edge : Edges)
+	{
+		LastRow = FMath::Max(LastRow, Edge.RowEnd);
+	}
+
+	// Walk the rows, maintaining the active edge list
+
+	ActiveEdges.Reset();
+	int32 NextEdge = 0;
+
+	for (int32 Row = Edges[0].RowStart; Row <= LastRow; Row++)
+	{
+		while ((NextEdge < Edges.Num()) && (Edges[NextEdge].RowStart == Row))
+		{
+			ActiveEdges.Add(NextEdge);
+			NextEdge++;
+		}
+
+		ActiveEdges.RemoveAllSwap([this, Row](int32 EdgeIndex) { return Edges[EdgeIndex].RowEnd < Row; }, false);
+
+		Crossings.Reset();
+		for (int32 EdgeIndex : ActiveEdges)
+		{
+			const FEdge& Edge = Edges[EdgeIndex];
+			// Evaluate directly rather than accumulating DXDY, so long edges don't drift
+			Crossings.Add(Edge.XAtRowStart + double(Row - Edge.RowStart) * Edge.DXDY);
+		}
+		Crossings.Sort();
+
+		// Fill between pairs of crossings. A cell is in if its center (X + 0.5) lies within [Left, Right]
+		for (int32 CrossingIndex = 0; CrossingIndex + 1 < Crossings.Num(); CrossingIndex += 2)
+		{
+			const int32 MinX = FMath::Max(FMath::CeilToInt32(Crossings[CrossingIndex] - 0.5), ClipRect.Min.X);
+			const int32 MaxX = FMath::Min(FMath::FloorToInt32(Crossings[CrossingIndex + 1] - 0.5), ClipRect.Max.X);
+			if (MinX <= MaxX)
+			{
+				OnSpan(Row, MinX, MaxX);
+			}
+		}
+	}
+}
+
+
+template <typename SpanFuncType>
+void FGAPolyRasterizer::RasterizeHalfPlane(TConstArrayView<FVector2D> Verts, const FIntRect& ClipRect, SpanFuncType&& OnSpan)
+{
+	const int32 VertCount = Verts.Num();
+	if (VertCount < 3)
+	{
+		return;
+	}
+
+	// Cache off a set of "outside vectors", so that we can test each cell in the box against the
+	// bounds of the polygons
+
+	OutsideVectors.SetNum(VertCount, false);
+	for (int32 V0Index = 0; V0Index < VertCount; V0Index++)
+	{
+		int32 V1Index = (V0Index + 1) % VertCount;
+		FVector2D V0V1 = Verts[V1Index] - Verts[V0Index];
+
+		// Rotate 90 degrees
+		FVector2D& OutsideVector = OutsideVectors[V0Index];
+		OutsideVector.X = -V0V1.Y;
+		OutsideVector.Y = V0V1.X;
+	}
+
+	// Check each cell in the box to see if it's inside the poly
+
+	const float HalfScale = 0.5f * CellScale;
+
+	for (int32 Y = ClipRect.Min.Y; Y <= ClipRect.Max.Y; Y++)
+	{
+		for (int32 X = ClipRect.Min.X; X <= ClipRect.Max.X; X++)
+		{
+			FVector2D CellCenter(X * CellScale + HalfScale, Y * CellScale + HalfScale);
+			bool IsOutside = false;
+
+			for (int32 V0Index = 0; (V0Index < VertCount) && !IsOutside; V0Index++)
+			{
+				FVector2D V0Cell = CellCenter - Verts[V0Index];
+
+				if ((V0Cell | OutsideVectors[V0Index]) > 0.0f)		// Dot product
+				{
+					// the cell is outside this edge
+					IsOutside = true;
+				}
+			}
+
+			if (!IsOutside)
+			{
+				OnSpan(Y, X, X);
+			}
+		}
+	}
+}
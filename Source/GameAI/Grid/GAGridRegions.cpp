@@ -0,0 +1,194 @@
+#include "GAGridRegions.h"
+
+
+void FGAGridRegionLabels::Build(const FGAGridBitPlane& Bits)
+{
+	XCount = Bits.GetXCount();
+	YCount = Bits.GetYCount();
+
+	Runs.Reset();
+	Parents.Reset();
+
+	// Split every row into runs, merging each with the runs it touches in the row before
+	int32 PrevRowStart = 0;
+	for (int32 Y = 0; Y < YCount; Y++)
+	{
+		const int32 RowStart = Runs.Num();
+
+		int32 X = Bits.FindFirstSet(Y, 0, XCount - 1);
+		while (X != INDEX_NONE)
+		{
+			int32 End = Bits.FindFirstClear(Y, X, XCount - 1);
+			End = (End == INDEX_NONE) ? XCount : End;
+
+			Runs.Add({ Y, X, End - 1 });
+			Parents.Add(Runs.Num() - 1);
+
+			X = (End < XCount) ? Bits.FindFirstSet(Y, End, XCount - 1) : INDEX_NONE;
+		}
+
+		// Both rows' runs are sorted by X, so one pass over each finds all the overlaps
+		int32 Prev = PrevRowStart;
+		for (int32 Cur = RowStart; Cur < Runs.Num(); Cur++)
+		{
+			while ((Prev < RowStart) && (Runs[Prev].MaxX < Runs[Cur].MinX))
+			{
+				Prev++;
+			}
+			for (int32 Other = Prev; (Other < RowStart) && (Runs[Other].MinX <= Runs[Cur].MaxX); Other++)
+			{
+				Union(Cur, Other);
+			}
+		}
+
+		PrevRowStart = RowStart;
+	}
+
+	// Hand out compact labels, then paint them in
+	RootLabels.Init(INDEX_NONE, Runs.Num());
+	RegionSizes.Reset();
+	Labels.Init(INDEX_NONE, XCount * YCount);
+
+	for (int32 RunIndex = 0; RunIndex < Runs.Num(); RunIndex++)
+	{
+		const int32 Root = FindRoot(RunIndex);
+		if (RootLabels[Root] == INDEX_NONE)
+		{
+			RootLabels[Root] = RegionSizes.Add(0);
+		}
+
+		const int32 Label = RootLabels[Root];
+		const FRun& Run = Runs[RunIndex];
+		int32* Row = Labels.GetData() + Run.Y * XCount;
+		for (int32 X = Run.MinX; X <= Run.MaxX; X++)
+		{
+			Row[X] = Label;
+		}
+		RegionSizes[Label] += Run.MaxX - Run.MinX + 1;
+	}
+}
+
+void FGAGridRegionLabels::Refresh(const FGAGridBitPlane& Bits, const FIntRect& Rect)
+{
+	if (!IsBuilt(Bits))
+	{
+		Build(Bits);
+		return;
+	}
+
+	const int32 MinX = FMath::Max(Rect.Min.X, 0);
+	const int32 MaxX = FMath::Min(Rect.Max.X, XCount - 1);
+	const int32 MinY = FMath::Max(Rect.Min.Y, 0);
+	const int32 MaxY = FMath::Min(Rect.Max.Y, YCount - 1);
+
+	// Cells that were just traversable before get marked Pending, then labelled a connected group at a time
+	constexpr int32 Pending = INDEX_NONE - 1;
+	constexpr int32 Grouped = INDEX_NONE - 2;
+
+	AddedCells.Reset();
+	for (int32 Y = MinY; Y <= MaxY; Y++)
+	{
+		for (int32 X = MinX; X <= MaxX; X++)
+		{
+			const int32 Index = Y * XCount + X;
+			const bool bWasSet = (Labels[Index] != INDEX_NONE);
+			const bool bIsSet = Bits.Get(X, Y);
+			if (bWasSet && !bIsSet)
+			{
+				Build(Bits);
+				return;
+			}
+			if (bIsSet && !bWasSet)
+			{
+				Labels[Index] = Pending;
+				AddedCells.Add(Index);
+			}
+		}
+	}
+
+	for (const int32 Start : AddedCells)
+	{
+		if (Labels[Start] != Pending)
+		{
+			continue;
+		}
+
+		// Flood the group of new cells, noting the one existing region it touches, if any
+		int32 Label = INDEX_NONE;
+		GroupCells.Reset();
+		GroupCells.Add(Start);
+		Labels[Start] = Grouped;
+		for (int32 Next = 0; Next < GroupCells.Num(); Next++)
+		{
+			const int32 Index = GroupCells[Next];
+			const int32 X = Index % XCount;
+			const int32 Y = Index / XCount;
+			for (int32 Side = 0; Side < 8; Side += 2)
+			{
+				const int32 NX = X + FGAGridBitPlane::NeighborDX[Side];
+				const int32 NY = Y + FGAGridBitPlane::NeighborDY[Side];
+				if ((NX < 0) || (NX >= XCount) || (NY < 0) || (NY >= YCount))
+				{
+					continue;
+				}
+
+				const int32 NeighborIndex = NY * XCount + NX;
+				const int32 NeighborLabel = Labels[NeighborIndex];
+				if (NeighborLabel == Pending)
+				{
+					Labels[NeighborIndex] = Grouped;
+					GroupCells.Add(NeighborIndex);
+				}
+				else if (NeighborLabel >= 0)
+				{
+					if ((Label != INDEX_NONE) && (Label != NeighborLabel))
+					{
+						// Joins two regions
+						Build(Bits);
+						return;
+					}
+					Label = NeighborLabel;
+				}
+			}
+		}
+
+		if (Label == INDEX_NONE)
+		{
+			Label = RegionSizes.Add(0);
+		}
+		for (const int32 Index : GroupCells)
+		{
+			Labels[Index] = Label;
+		}
+		RegionSizes[Label] += GroupCells.Num();
+	}
+}
+
+int32 FGAGridRegionLabels::FindRoot(int32 RunIndex)
+{
+	int32 Root = RunIndex;
+	while (Parents[Root] != Root)
+	{
+		Root = Parents[Root];
+	}
+
+	// Path compression
+	while (Parents[RunIndex] != Root)
+	{
+		const int32 Next = Parents[RunIndex];
+		Parents[RunIndex] = Root;
+		RunIndex = Next;
+	}
+	return Root;
+}
+
+void FGAGridRegionLabels::Union(int32 A, int32 B)
+{
+	const int32 RootA = FindRoot(A);
+	const int32 RootB = FindRoot(B);
+	if (RootA != RootB)
+	{
+		// Keep the earlier run as the root, so labels come out in scan order
+		Parents[FMath::Max(RootA, RootB)] = FMath::Min(RootA, RootB);
+	}
+}
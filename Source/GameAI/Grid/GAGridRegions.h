@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GAGridBitPlane.h"
+
+
+// Connected components of a traversability bit plane, 4-connected (cells sharing an edge).
+// Each traversable cell gets the label of its component, 0 .. GetRegionCount() - 1. Non-traversable cells get INDEX_NONE.
+//
+// Built a run at a time: each row is split into runs of traversable cells, runs that overlap a run in the previous
+// row are merged with a union-find, and the labels are written out run by run.
+//
+// After a local edit, Refresh labels cells that became traversable in place when they only extend one region or form a
+// new one. Anything that could merge or split regions falls back to a full Build.
+
+struct FGAGridRegionLabels
+{
+	void Build(const FGAGridBitPlane& Bits);
+
+	// Bring the labels up to date after the bits in Rect (inclusive) changed. The labels still hold the old
+	// traversability, which is what the bits are compared against. Cells becoming blocked may split a region, and new
+	// cells touching two regions merge them, so either of those rebuilds everything.
+	void Refresh(const FGAGridBitPlane& Bits, const FIntRect& Rect);
+
+	bool IsBuilt(const FGAGridBitPlane& Bits) const
+	{
+		return (XCount == Bits.GetXCount()) && (YCount == Bits.GetYCount()) && (Labels.Num() == XCount * YCount);
+	}
+
+	// No bounds checks, see IsBuilt
+	FORCEINLINE int32 GetLabel(int32 X, int32 Y) const { return Labels[Y * XCount + X]; }
+
+	int32 GetRegionCount() const { return RegionSizes.Num(); }
+
+	// Number of cells in the region
+	int32 GetRegionSize(int32 Label) const { return RegionSizes.IsValidIndex(Label) ? RegionSizes[Label] : 0; }
+
+private:
+	struct FRun
+	{
+		int32 Y;
+		int32 MinX;
+		int32 MaxX;
+	};
+
+	int32 FindRoot(int32 RunIndex);
+
+	void Union(int32 A, int32 B);
+
+	int32 XCount = 0;
+	int32 YCount = 0;
+	TArray<int32> Labels;
+	TArray<int32> RegionSizes;
+
+	// Scratch
+	TArray<FRun> Runs;
+	TArray<int32> Parents;
+	TArray<int32> RootLabels;
+	TArray<int32> AddedCells;
+	TArray<int32> GroupCells;
+};
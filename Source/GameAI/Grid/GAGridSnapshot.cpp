@@ -0,0 +1,183 @@
+#include "GAGridSnapshot.h"
+
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+// Writer --------------------------------
+
+void FGAGridSnapshotWriter::AddSection(uint32 Id, const void* Bytes, int64 Size)
+{
+	FPendingSection& Section = Sections.AddDefaulted_GetRef();
+	Section.Id = Id;
+	Section.Bytes.Append(static_cast<const uint8*>(Bytes), Size);
+}
+
+void FGAGridSnapshotWriter::AddInfo(FGAGridSnapshotInfo Info)
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << Info;
+	AddSection(GAGridSnapshot::InfoSection, Bytes.GetData(), Bytes.Num());
+}
+
+bool FGAGridSnapshotWriter::SaveToFile(const FString& Path) const
+{
+	FGAGridSnapshotHeader Header;
+	Header.Magic = GAGridSnapshot::Magic;
+	Header.Version = GAGridSnapshot::Version;
+	Header.SectionCount = Sections.Num();
+	Header.Reserved = 0;
+
+	// Lay out the payloads after the section table
+	TArray<FGAGridSnapshotSection> Table;
+	uint64 Offset = Align(sizeof(FGAGridSnapshotHeader) + Sections.Num() * sizeof(FGAGridSnapshotSection), GAGridSnapshot::SectionAlignment);
+	for (const FPendingSection& Section : Sections)
+	{
+		FGAGridSnapshotSection& Entry = Table.AddDefaulted_GetRef();
+		Entry.Id = Section.Id;
+		Entry.Reserved = 0;
+		Entry.Offset = Offset;
+		Entry.Size = Section.Bytes.Num();
+		Offset = Align(Offset + Entry.Size, GAGridSnapshot::SectionAlignment);
+	}
+
+	TArray<uint8> FileBytes;
+	FileBytes.SetNumZeroed(Offset);
+	FMemory::Memcpy(FileBytes.GetData(), &Header, sizeof(Header));
+	FMemory::Memcpy(FileBytes.GetData() + sizeof(Header), Table.GetData(), Table.Num() * sizeof(FGAGridSnapshotSection));
+	for (int32 SectionIndex = 0; SectionIndex < Sections.Num(); SectionIndex++)
+	{
+		FMemory::Memcpy(FileBytes.GetData() + Table[SectionIndex].Offset, Sections[SectionIndex].Bytes.GetData(), Sections[SectionIndex].Bytes.Num());
+	}
+
+	return FFileHelper::SaveArrayToFile(FileBytes, *Path);
+}
+
+
+// Reader --------------------------------
+
+FGAGridSnapshotReader::FGAGridSnapshotReader()
+: FileData(NULL), FileSize(0)
+{
+}
+
+FGAGridSnapshotReader::~FGAGridSnapshotReader()
+{
+	Close();
+}
+
+void FGAGridSnapshotReader::Close()
+{
+	MappedRegion.Reset();
+	MappedHandle.Reset();
+	FallbackBytes.Empty();
+	Sections.Reset();
+	FileData = NULL;
+	FileSize = 0;
+}
+
+bool FGAGridSnapshotReader::Open(const FString& Path)
+{
+	Close();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.FileExists(*Path))
+	{
+		return false;
+	}
+
+	MappedHandle.Reset(PlatformFile.OpenMapped(*Path));
+	if (MappedHandle.IsValid())
+	{
+		MappedRegion.Reset(MappedHandle->MapRegion(0, MappedHandle->GetFileSize()));
+	}
+
+	if (MappedRegion.IsValid())
+	{
+		FileData = MappedRegion->GetMappedPtr();
+		FileSize = MappedRegion->GetMappedSize();
+	}
+	else
+	{
+		MappedHandle.Reset();
+		if (!FFileHelper::LoadFileToArray(FallbackBytes, *Path))
+		{
+			return false;
+		}
+		FileData = FallbackBytes.GetData();
+		FileSize = FallbackBytes.Num();
+	}
+
+	if (!ValidateLayout())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Grid snapshot %s is corrupt or from a different version, ignoring it"), *Path);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool FGAGridSnapshotReader::ValidateLayout()
+{
+	if ((FileData == NULL) || (FileSize < int64(sizeof(FGAGridSnapshotHeader))))
+	{
+		return false;
+	}
+
+	FGAGridSnapshotHeader Header;
+	FMemory::Memcpy(&Header, FileData, sizeof(Header));
+	if ((Header.Magic != GAGridSnapshot::Magic) || (Header.Version != GAGridSnapshot::Version))
+	{
+		return false;
+	}
+
+	const uint64 TableEnd = sizeof(FGAGridSnapshotHeader) + uint64(Header.SectionCount) * sizeof(FGAGridSnapshotSection);
+	if (TableEnd > uint64(FileSize))
+	{
+		return false;
+	}
+
+	Sections.SetNumUninitialized(Header.SectionCount);
+	FMemory::Memcpy(Sections.GetData(), FileData + sizeof(FGAGridSnapshotHeader), Header.SectionCount * sizeof(FGAGridSnapshotSection));
+
+	for (const FGAGridSnapshotSection& Section : Sections)
+	{
+		// Every section has to sit inside the file, after the table. Sizes are capped so views can use int32.
+		if ((Section.Offset < TableEnd) || (Section.Size > uint64(MAX_int32)) || (Section.Offset + Section.Size > uint64(FileSize)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TConstArrayView<uint8> FGAGridSnapshotReader::FindSection(uint32 Id) const
+{
+	for (const FGAGridSnapshotSection& Section : Sections)
+	{
+		if (Section.Id == Id)
+		{
+			return TConstArrayView<uint8>(FileData + Section.Offset, int32(Section.Size));
+		}
+	}
+	return TConstArrayView<uint8>();
+}
+
+bool FGAGridSnapshotReader::ReadInfo(FGAGridSnapshotInfo& InfoOut) const
+{
+	TConstArrayView<uint8> Bytes = FindSection(GAGridSnapshot::InfoSection);
+	if (Bytes.Num() == 0)
+	{
+		return false;
+	}
+
+	FMemoryReaderView Reader(Bytes);
+	Reader << InfoOut;
+	return !Reader.IsError();
+}
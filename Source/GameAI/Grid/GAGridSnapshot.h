@@ -0,0 +1,134 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+
+// A baked copy of an AGAGridActor's cells, so the grid doesn't have to be rebuilt from the nav mesh at startup.
+//
+// File layout (little endian):
+//		FGAGridSnapshotHeader
+//		FGAGridSnapshotSection[SectionCount]
+//		section payloads, each starting on a SectionAlignment boundary
+//
+// Sections are looked up by id, so new ones can be added without breaking older readers, which just ignore them.
+// Bump Version for any change to the layout of an existing section.
+
+namespace GAGridSnapshot
+{
+	constexpr uint32 MakeId(char A, char B, char C, char D)
+	{
+		return uint32(uint8(A)) | (uint32(uint8(B)) << 8) | (uint32(uint8(C)) << 16) | (uint32(uint8(D)) << 24);
+	}
+
+	constexpr uint32 Magic = MakeId('G', 'A', 'G', 'S');
+	constexpr uint32 Version = 1;
+	constexpr uint32 SectionAlignment = 16;
+
+	// Section ids
+	constexpr uint32 InfoSection = MakeId('I', 'N', 'F', 'O');			// FGAGridSnapshotInfo, serialized with an FArchive
+	constexpr uint32 CellDataSection = MakeId('C', 'E', 'L', 'L');		// XCount * YCount ECellData, X-major like AGAGridActor::Data
+	constexpr uint32 HeightsSection = MakeId('H', 'G', 'H', 'T');		// FGAGridSnapshotHeights, then XCount * YCount quantized uint16 heights
+	constexpr uint32 VisibilitySection = MakeId('P', 'V', 'S', ' ');	// Optional, FGAGridVisibilityTable::Encode
+}
+
+struct FGAGridSnapshotHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 SectionCount;
+	uint32 Reserved;
+};
+
+struct FGAGridSnapshotSection
+{
+	uint32 Id;
+	uint32 Reserved;
+	uint64 Offset;		// from the start of the file
+	uint64 Size;		// in bytes
+};
+
+struct FGAGridSnapshotHeights
+{
+	float Offset;		// see FGAGridHeightQuantizer
+	float Step;
+	uint32 CellCount;
+	uint32 Reserved;
+};
+
+// Everything needed to tell whether a snapshot still matches its grid
+struct FGAGridSnapshotInfo
+{
+	int32 XCount = 0;
+	int32 YCount = 0;
+	float CellScale = 0.0f;
+	FTransform Transform;
+
+	// Checksum of the nav tiles the cells were built from (see AGAGridActor::RecordNavTiles)
+	uint32 NavChecksum = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FGAGridSnapshotInfo& Info)
+	{
+		Ar << Info.XCount << Info.YCount << Info.CellScale << Info.Transform << Info.NavChecksum;
+		return Ar;
+	}
+};
+
+
+// Collects sections and writes them out
+class FGAGridSnapshotWriter
+{
+public:
+	void AddSection(uint32 Id, const void* Bytes, int64 Size);
+
+	void AddInfo(FGAGridSnapshotInfo Info);
+
+	bool SaveToFile(const FString& Path) const;
+
+private:
+	struct FPendingSection
+	{
+		uint32 Id;
+		TArray<uint8> Bytes;
+	};
+
+	TArray<FPendingSection> Sections;
+};
+
+
+// Memory maps a snapshot file and hands out views of its sections.
+// The views point straight into the mapping, so they are only good for as long as the reader is alive.
+// If the platform can't map the file (e.g. it ended up inside a pak), it gets read into memory instead.
+class FGAGridSnapshotReader
+{
+public:
+	FGAGridSnapshotReader();
+	~FGAGridSnapshotReader();
+
+	// Returns false if the file is missing, can't be mapped or read, or isn't a valid snapshot of the current version
+	bool Open(const FString& Path);
+
+	bool IsOpen() const { return FileData != NULL; }
+
+	// Empty if the section isn't in the file
+	TConstArrayView<uint8> FindSection(uint32 Id) const;
+
+	bool ReadInfo(FGAGridSnapshotInfo& InfoOut) const;
+
+private:
+	void Close();
+
+	bool ValidateLayout();
+
+	// Declared in this order so the region is released before the file handle
+	TUniquePtr<IMappedFileHandle> MappedHandle;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> FallbackBytes;
+
+	const uint8* FileData;
+	int64 FileSize;
+
+	TArray<FGAGridSnapshotSection> Sections;
+};
@@ -0,0 +1,138 @@
+#include "GAGridSummedArea.h"
+#include "GAGridActor.h"
+#include "GAGridBitPlane.h"
+
+
+void FGAGridSummedAreaTable::Build(const FGAGridMap& Map, const FGAGridBitPlane* Mask, const FGridBox& Box)
+{
+	Reset();
+	if (!Map.IsValid())
+	{
+		return;
+	}
+
+	const FGridBox& MapBounds = Map.GridBounds;
+	const FGridBox BuildBounds = Box.IsValid()
+		? FGridBox(FMath::Max(Box.MinX, MapBounds.MinX), FMath::Min(Box.MaxX, MapBounds.MaxX), FMath::Max(Box.MinY, MapBounds.MinY), FMath::Min(Box.MaxY, MapBounds.MaxY))
+		: MapBounds;
+	if (!BuildBounds.IsValid())
+	{
+		return;
+	}
+
+	Bounds = BuildBounds;
+	const int32 Width = Bounds.GetWidth();
+	const int32 Height = Bounds.GetHeight();
+	Stride = Width + 1;
+
+	Sums.SetNumUninitialized(Stride * (Height + 1));
+	FMemory::Memzero(Sums.GetData(), Stride * sizeof(double));
+	if (Mask)
+	{
+		Counts.SetNumUninitialized(Stride * (Height + 1));
+		FMemory::Memzero(Counts.GetData(), Stride * sizeof(int32));
+	}
+
+	TArray<float, TInlineAllocator<512>> Row;
+	Row.SetNumUninitialized(Width);
+
+	for (int32 Y = 0; Y < Height; Y++)
+	{
+		Map.GetRowValues(Bounds.MinY + Y, Bounds.MinX, Width, Row.GetData());
+
+		// Each entry is the one above plus the sum of the row so far
+		const double* SumsAbove = Sums.GetData() + Y * Stride;
+		double* RowSums = Sums.GetData() + (Y + 1) * Stride;
+		RowSums[0] = 0.0;
+		double RowSum = 0.0;
+
+		if (Mask == NULL)
+		{
+			for (int32 X = 0; X < Width; X++)
+			{
+				RowSum += Row[X];
+				RowSums[X + 1] = SumsAbove[X + 1] + RowSum;
+			}
+			continue;
+		}
+
+		const int32* CountsAbove = Counts.GetData() + Y * Stride;
+		int32* RowCounts = Counts.GetData() + (Y + 1) * Stride;
+		RowCounts[0] = 0;
+		int32 RowCount = 0;
+
+		for (int32 WordX = 0; WordX < Width; WordX += 64)
+		{
+			const int32 WordCount = FMath::Min(64, Width - WordX);
+			const uint64 Bits = Mask->GetRowBits(Bounds.MinY + Y, Bounds.MinX + WordX, WordCount);
+			for (int32 Bit = 0; Bit < WordCount; Bit++)
+			{
+				const int32 X = WordX + Bit;
+				if ((Bits >> Bit) & 1)
+				{
+					RowSum += Row[X];
+					RowCount++;
+				}
+				RowSums[X + 1] = SumsAbove[X + 1] + RowSum;
+				RowCounts[X + 1] = CountsAbove[X + 1] + RowCount;
+			}
+		}
+	}
+}
+
+void FGAGridSummedAreaTable::Reset()
+{
+	Bounds = FGridBox();
+	Stride = 0;
+	Sums.Reset();
+	Counts.Reset();
+}
+
+bool FGAGridSummedAreaTable::ClipRect(const FGridBox& Rect, int32& MinX, int32& MaxX, int32& MinY, int32& MaxY) const
+{
+	if (!IsBuilt())
+	{
+		return false;
+	}
+
+	MinX = FMath::Max(Rect.MinX, Bounds.MinX) - Bounds.MinX;
+	MaxX = FMath::Min(Rect.MaxX, Bounds.MaxX) - Bounds.MinX + 1;
+	MinY = FMath::Max(Rect.MinY, Bounds.MinY) - Bounds.MinY;
+	MaxY = FMath::Min(Rect.MaxY, Bounds.MaxY) - Bounds.MinY + 1;
+	return (MinX < MaxX) && (MinY < MaxY);
+}
+
+double FGAGridSummedAreaTable::GetSum(const FGridBox& Rect) const
+{
+	int32 MinX, MaxX, MinY, MaxY;
+	if (!ClipRect(Rect, MinX, MaxX, MinY, MaxY))
+	{
+		return 0.0;
+	}
+	return Sums[MaxY * Stride + MaxX] - Sums[MinY * Stride + MaxX] - Sums[MaxY * Stride + MinX] + Sums[MinY * Stride + MinX];
+}
+
+int32 FGAGridSummedAreaTable::GetCount(const FGridBox& Rect) const
+{
+	int32 MinX, MaxX, MinY, MaxY;
+	if (!ClipRect(Rect, MinX, MaxX, MinY, MaxY))
+	{
+		return 0;
+	}
+	if (Counts.Num() == 0)
+	{
+		return (MaxX - MinX) * (MaxY - MinY);
+	}
+	return Counts[MaxY * Stride + MaxX] - Counts[MinY * Stride + MaxX] - Counts[MaxY * Stride + MinX] + Counts[MinY * Stride + MinX];
+}
+
+float FGAGridSummedAreaTable::GetMean(const FGridBox& Rect) const
+{
+	const int32 Count = GetCount(Rect);
+	return (Count > 0) ? float(GetSum(Rect) / Count) : 0.0f;
+}
+
+FGridBox FGAGridSummedAreaTable::GetSquareAround(const FCellRef& Cell, int32 Radius)
+{
+	return FGridBox(FMath::Max(Cell.X - Radius, 0), Cell.X + Radius, FMath::Max(Cell.Y - Radius, 0), Cell.Y + Radius);
+}
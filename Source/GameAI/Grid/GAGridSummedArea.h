@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GAGridMap.h"
+
+struct FCellRef;
+struct FGAGridBitPlane;
+
+
+// Summed-area table (integral image) of a grid map: the sum, count or mean of any rect of cells in constant time,
+// e.g. the total probability of an occupancy map around each candidate search point.
+//
+// Built over a box of the map (all of it by default), with cells outside the box counting as 0. Entry (X, Y) is the
+// sum of every cell of the box before row Y and column X, kept in double so that the small values of a big map
+// don't get lost. With a mask, only the cells whose bit is set are summed, and a second table counts them so that
+// means are over those cells alone.
+//
+// The table is a snapshot, and has to be rebuilt once the map has changed.
+
+struct FGAGridSummedAreaTable
+{
+	void Build(const FGAGridMap& Map, const FGAGridBitPlane* Mask = NULL, const FGridBox& Box = FGridBox());
+
+	void Reset();
+
+	bool IsBuilt() const { return Bounds.IsValid(); }
+
+	// The cells the table was built over
+	const FGridBox& GetBounds() const { return Bounds; }
+
+	// Sum of the cells of Rect (inclusive, in grid cell coordinates). Cells outside the table count as 0.
+	double GetSum(const FGridBox& Rect) const;
+
+	// Number of cells of Rect that went into the table: inside its bounds and, with a mask, set in it
+	int32 GetCount(const FGridBox& Rect) const;
+
+	// GetSum / GetCount, or 0 if there are no cells
+	float GetMean(const FGridBox& Rect) const;
+
+	// The same for the square of cells up to Radius cells from Cell in X and Y
+	double GetSumAround(const FCellRef& Cell, int32 Radius) const { return GetSum(GetSquareAround(Cell, Radius)); }
+	float GetMeanAround(const FCellRef& Cell, int32 Radius) const { return GetMean(GetSquareAround(Cell, Radius)); }
+
+	// That square, clipped at 0 so it's never mistaken for an invalid box
+	static FGridBox GetSquareAround(const FCellRef& Cell, int32 Radius);
+
+private:
+	// Rect as table entries, MinX/MinY inclusive and MaxX/MaxY exclusive. Returns false if Rect misses the table.
+	bool ClipRect(const FGridBox& Rect, int32& MinX, int32& MaxX, int32& MinY, int32& MaxY) const;
+
+	FGridBox Bounds;
+
+	// Bounds' width + 1
+	int32 Stride = 0;
+
+	// (width + 1) * (height + 1) entries. The first row and column are 0.
+	TArray<double> Sums;
+
+	// Laid out like Sums. Empty unless built with a mask.
+	TArray<int32> Counts;
+};
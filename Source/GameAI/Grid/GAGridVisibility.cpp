@@ -0,0 +1,165 @@
+#include "GAGridVisibility.h"
+
+
+void FGAGridVisibilityTable::Init(int32 XCountIn, int32 YCountIn, int32 BlockSizeIn)
+{
+	XCount = FMath::Max(XCountIn, 0);
+	YCount = FMath::Max(YCountIn, 0);
+	BlockSize = FMath::Max(BlockSizeIn, 1);
+	BlockXCount = FMath::DivideAndRoundUp(XCount, BlockSize);
+	BlockYCount = FMath::DivideAndRoundUp(YCount, BlockSize);
+	Bits.Init(GetBlockCount(), GetBlockCount());
+}
+
+void FGAGridVisibilityTable::Reset()
+{
+	XCount = 0;
+	YCount = 0;
+	BlockSize = 0;
+	BlockXCount = 0;
+	BlockYCount = 0;
+	Bits.Init(0, 0);
+}
+
+FIntRect FGAGridVisibilityTable::GetBlockCellRect(int32 BlockIndex) const
+{
+	const int32 BlockX = BlockIndex % BlockXCount;
+	const int32 BlockY = BlockIndex / BlockXCount;
+
+	FIntRect Result;
+	Result.Min.X = BlockX * BlockSize;
+	Result.Min.Y = BlockY * BlockSize;
+	Result.Max.X = FMath::Min(Result.Min.X + BlockSize, XCount) - 1;
+	Result.Max.Y = FMath::Min(Result.Min.Y + BlockSize, YCount) - 1;
+	return Result;
+}
+
+bool FGAGridVisibilityTable::IsAnyVisibleInSpan(int32 FromX, int32 FromY, int32 Y, int32 MinX, int32 MaxX) const
+{
+	MinX = FMath::Max(MinX, 0);
+	MaxX = FMath::Min(MaxX, XCount - 1);
+	if ((Y < 0) || (Y >= YCount) || (MinX > MaxX))
+	{
+		return false;
+	}
+
+	// The blocks along a row of cells are next to each other in the bit row
+	const int32 RowStart = (Y / BlockSize) * BlockXCount;
+	return Bits.IsSpanAnySet(GetBlockIndex(FromX, FromY), RowStart + MinX / BlockSize, RowStart + MaxX / BlockSize);
+}
+
+void FGAGridVisibilityTable::Encode(TArray<uint8>& BytesOut) const
+{
+	const int32 BlockCount = GetBlockCount();
+
+	TArray<uint32> RowStarts;
+	TArray<uint16> Runs;
+	RowStarts.Reserve(BlockCount + 1);
+
+	for (int32 Row = 0; Row < BlockCount; Row++)
+	{
+		RowStarts.Add(Runs.Num());
+
+		bool bRunValue = false;
+		int32 Index = 0;
+		while (Index < BlockCount)
+		{
+			// Length of the run of bRunValue bits starting at Index
+			const int32 RunEnd = bRunValue ? Bits.FindFirstClear(Row, Index, BlockCount - 1) : Bits.FindFirstSet(Row, Index, BlockCount - 1);
+			int32 Length = ((RunEnd == INDEX_NONE) ? BlockCount : RunEnd) - Index;
+			Index += Length;
+
+			// Runs too long for a uint16 are split, with an empty run of the other value in between
+			while (Length > MAX_uint16)
+			{
+				Runs.Add(MAX_uint16);
+				Runs.Add(0);
+				Length -= MAX_uint16;
+			}
+			Runs.Add(uint16(Length));
+			bRunValue = !bRunValue;
+		}
+	}
+	RowStarts.Add(Runs.Num());
+
+	FGAGridVisibilityHeader Header;
+	Header.XCount = XCount;
+	Header.YCount = YCount;
+	Header.BlockSize = BlockSize;
+	Header.RunCount = Runs.Num();
+
+	BytesOut.Reset();
+	BytesOut.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	BytesOut.Append(reinterpret_cast<const uint8*>(RowStarts.GetData()), RowStarts.Num() * RowStarts.GetTypeSize());
+	BytesOut.Append(reinterpret_cast<const uint8*>(Runs.GetData()), Runs.Num() * Runs.GetTypeSize());
+}
+
+bool FGAGridVisibilityTable::Decode(TConstArrayView<uint8> Bytes, int32 XCountIn, int32 YCountIn)
+{
+	Reset();
+
+	FGAGridVisibilityHeader Header;
+	if (Bytes.Num() < int32(sizeof(Header)))
+	{
+		return false;
+	}
+	FMemory::Memcpy(&Header, Bytes.GetData(), sizeof(Header));
+
+	if ((Header.XCount != XCountIn) || (Header.YCount != YCountIn) || (Header.BlockSize <= 0))
+	{
+		return false;
+	}
+
+	Init(Header.XCount, Header.YCount, Header.BlockSize);
+	const int32 BlockCount = GetBlockCount();
+
+	const int64 ExpectedSize = int64(sizeof(Header)) + int64(BlockCount + 1) * sizeof(uint32) + int64(Header.RunCount) * sizeof(uint16);
+	if (Bytes.Num() != ExpectedSize)
+	{
+		Reset();
+		return false;
+	}
+
+	// The payload isn't necessarily aligned for uint32/uint16 reads, so copy them out
+	TArray<uint32> RowStarts;
+	TArray<uint16> Runs;
+	RowStarts.SetNumUninitialized(BlockCount + 1);
+	Runs.SetNumUninitialized(Header.RunCount);
+	FMemory::Memcpy(RowStarts.GetData(), Bytes.GetData() + sizeof(Header), RowStarts.Num() * sizeof(uint32));
+	FMemory::Memcpy(Runs.GetData(), Bytes.GetData() + sizeof(Header) + RowStarts.Num() * sizeof(uint32), Runs.Num() * sizeof(uint16));
+
+	for (int32 Row = 0; Row < BlockCount; Row++)
+	{
+		if ((RowStarts[Row] > RowStarts[Row + 1]) || (RowStarts[Row + 1] > Header.RunCount))
+		{
+			Reset();
+			return false;
+		}
+
+		bool bRunValue = false;
+		int32 Index = 0;
+		for (uint32 RunIndex = RowStarts[Row]; RunIndex < RowStarts[Row + 1]; RunIndex++)
+		{
+			const int32 Length = Runs[RunIndex];
+			if (Index + Length > BlockCount)
+			{
+				Reset();
+				return false;
+			}
+			if (bRunValue && (Length > 0))
+			{
+				Bits.SetSpan(Row, Index, Index + Length - 1, true);
+			}
+			Index += Length;
+			bRunValue = !bRunValue;
+		}
+
+		if (Index != BlockCount)
+		{
+			Reset();
+			return false;
+		}
+	}
+
+	return true;
+}
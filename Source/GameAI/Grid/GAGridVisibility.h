@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GAGridBitPlane.h"
+
+
+// A baked, conservative cell-to-cell visibility table (a potentially visible set).
+//
+// The grid is split into BlockSize x BlockSize blocks of cells, and the table records which blocks can see which.
+// Visibility is symmetric, and two cells are potentially visible to each other if their blocks are. Baking traces
+// between every traversable cell of both blocks, so a "no" is a definite no for static geometry seen from eye height,
+// while a "yes" still needs a real trace to confirm.
+//
+// In memory it's a BlockCount x BlockCount bit plane, row = viewing block, so lookups are a single bit test and a
+// row of cells maps onto a contiguous span of bits. On disk each row is run-length encoded, see Encode.
+
+struct FGAGridVisibilityTable
+{
+	FGAGridVisibilityTable() : XCount(0), YCount(0), BlockSize(0), BlockXCount(0), BlockYCount(0) {}
+
+	// Set up a table for a grid of the given size in which nothing can see anything
+	void Init(int32 XCountIn, int32 YCountIn, int32 BlockSizeIn);
+
+	void Reset();
+
+	bool IsBuilt(int32 XCountIn, int32 YCountIn) const
+	{
+		return (XCount == XCountIn) && (YCount == YCountIn) && (GetBlockCount() > 0);
+	}
+
+	int32 GetBlockSize() const { return BlockSize; }
+	int32 GetBlockCount() const { return BlockXCount * BlockYCount; }
+
+	FORCEINLINE int32 GetBlockIndex(int32 X, int32 Y) const { return (Y / BlockSize) * BlockXCount + (X / BlockSize); }
+
+	// The cells of a block (inclusive, clipped to the grid)
+	FIntRect GetBlockCellRect(int32 BlockIndex) const;
+
+	// Mark the two blocks as able to see each other
+	void SetVisible(int32 BlockA, int32 BlockB)
+	{
+		Bits.Set(BlockB, BlockA, true);
+		Bits.Set(BlockA, BlockB, true);
+	}
+
+	// Note: no bounds checks, both cells must be on the grid
+	FORCEINLINE bool IsVisible(int32 FromX, int32 FromY, int32 ToX, int32 ToY) const
+	{
+		return Bits.Get(GetBlockIndex(ToX, ToY), GetBlockIndex(FromX, FromY));
+	}
+
+	// Is any of the cells MinX..MaxX (inclusive) of row Y potentially visible from (FromX, FromY), which must be on the grid?
+	bool IsAnyVisibleInSpan(int32 FromX, int32 FromY, int32 Y, int32 MinX, int32 MaxX) const;
+
+	// Layout: FGAGridVisibilityHeader, then BlockCount + 1 uint32 offsets into the runs (one per row, plus the end),
+	// then the uint16 runs. Each row's runs alternate between clear and set bits, starting with clear.
+	void Encode(TArray<uint8>& BytesOut) const;
+
+	// Returns false (and leaves the table reset) if the bytes don't hold a valid table for a grid of this size
+	bool Decode(TConstArrayView<uint8> Bytes, int32 XCountIn, int32 YCountIn);
+
+private:
+	int32 XCount;
+	int32 YCount;
+	int32 BlockSize;
+	int32 BlockXCount;
+	int32 BlockYCount;
+
+	FGAGridBitPlane Bits;
+};
+
+struct FGAGridVisibilityHeader
+{
+	int32 XCount;
+	int32 YCount;
+	int32 BlockSize;
+	uint32 RunCount;
+};
@@ -1,10 +1,12 @@
 #include "GAPathComponent.h"
 #include "GameFramework/NavMovementComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "Algo/Reverse.h"
+#include <tuple>
+//Only FindPathLegacy still uses these
 #include <queue>
 #include <vector>
-#include <tuple>
-#include <optional>
+#include <list>
 
 using namespace std;
 
@@ -14,6 +16,8 @@ UGAPathComponent::UGAPathComponent(const FObjectInitializer& ObjectInitializer)
 	State = GAPS_None;
 	bDestinationValid = false;
 	ArrivalDistance = 100.0f;
+	AgentRadius = 0.0f;
+	bUseLegacyPathSearch = false;
 
 	// A bit of Unreal magic to make TickComponent below get called
 	PrimaryComponentTick.bCanEverTick = true;
@@ -71,7 +75,10 @@ APawn* UGAPathComponent::GetOwnerPawn()
 
 void UGAPathComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
-	if (bDestinationValid)
+	// Sit tight until the grid has finished building
+	const AGAGridActor* Grid = GetGridActor();
+
+	if (bDestinationValid && Grid && Grid->IsGridDataReady())
 	{
 		RefreshPath();
 
@@ -110,49 +117,191 @@ EGAPathState UGAPathComponent::RefreshPath()
 	return State;
 }
 
-//Helper function for getLineTrace that will get 80 points along the line created from the current FVector location to the FVector location of the goal cell
-//Checks to see if there are any obstructions in the way that the robot could run into or if it is an open straight shot to the cell
-bool getPointsAlongLine(const FVector& start, const FVector& end, const AGAGridActor* Grid) {
-	int steps = 80; //I Chose a step size of 80 because the grid is 80x80 and this makes it less likely that there would be an obstruction that wasnt caught by the interpolation
+//LineTrace() function for path smoothing
+//Function takes in the current path from robot to player, the location of the robot, and a reference to the grid
+//Returns a tuple so I can easily access the FVector and FCellRef representation of the same location
+//pathPositions is the caller's scratch array for the positions of the path cells, so replanning every tick doesn't allocate
+tuple<FVector, FCellRef> getLineTrace(TConstArrayView<FCellRef> path, const FCellRef& origin, const AGAGridActor* Grid, TArray<FVector>& pathPositions) {
+
+	FVector originVec = Grid->GetCellPosition(origin);
 
-	for (int i = 0; i < steps; ++i) {
-		// Calculate the interpolation factor (t) based on the current point index
-		float t = static_cast<float>(i) / (steps - 1);
+	//Get the positions of every cell in the A* path in one go
+	pathPositions.SetNumUninitialized(path.Num(), false);
+	Grid->GetCellPositions(path, pathPositions);
 
-		// Interpolate between start and end using lerp
-		float x = start.X + t * (end.X - start.X);
-		float y = start.Y + t * (end.Y - start.Y);
+	//Walk the grid cell by cell from the origin to each cell of the path in turn, stopping at the first one that can't be reached in a straight line without hitting a wall
+	int32 blockedIndex = Grid->FindFirstBlockedLine(originVec, pathPositions);
 
-		FCellRef lineCell = Grid->GetCellRef(FVector(x, y, 0.0f));
-		if (Grid->GetCellData(lineCell) != ECellData::CellDataTraversable) { //Check to see if the Cell associated with the FVector coordinates found by lerp is not traversible and will return true meaning that cell is not reachable by a straight line
-			return true;
-		}
+	if (blockedIndex == INDEX_NONE) {
+		return make_tuple(pathPositions.Last(), path.Last()); //If nothing is blocked that means all are reachable via a straight line and it returns the end of the path (i.e. the player's cell) as the one to point towards
 	}
-	return false;
+	if (blockedIndex == 0) {
+		return make_tuple(Grid->GetCellPosition(origin), origin); //Not even the first cell of the path is in a straight line, so stay put
+	}
+	return make_tuple(pathPositions[blockedIndex - 1], path[blockedIndex - 1]); //Otherwise head for the last cell before the obstruction that could be reached via a straight line
 }
 
-//LineTrace() function for path smoothing
-//Function takes in the current path from robot to player, the location of the robot, and a reference to the grid
-//Returns a tuple so I can easily access the FVector and FCellRef representation of the same location
-tuple<FVector, FCellRef> getLineTrace(const vector<FCellRef>& path, const FCellRef& origin, const AGAGridActor* Grid) {
+//Comparator to order the <f cost, cell index> pairs of the A* open list (a TArray heap) by lowest cost
+struct LowerPathCostFirst {
+	bool operator()(const TPair<float, int32>& lhs, const TPair<float, int32>& rhs) const {
+		return lhs.Key < rhs.Key;
+	}
+};
 
-	FVector originVec = Grid->GetCellPosition(origin);
-	FCellRef prev = origin;
+//A* search function
+EGAPathState UGAPathComponent::AStar()
+{
+	const AGAGridActor* Grid = GetGridActor();
+
+	//Steps only holds something while there's a path to follow, so a failed search never leaves an old step behind
+	Steps.Reset();
 	
-	//Loop through the A* path and check if cell in the path is directly reachable from the origin without hitting a wall by passing the cell vector to getPointsAlongLine
-	for (const auto& element : path) {
-		FVector destCellVec = Grid->GetCellPosition(element);
+	//Get the current location of the robot and set it as the startCell
+	AActor* Owner = GetOwnerPawn();
+	FVector StartPoint = Owner->GetActorLocation();
+	FCellRef startCell = Grid->GetCellRef(StartPoint);
 
-		if (getPointsAlongLine(originVec, destCellVec, Grid)) {
-			return make_tuple(Grid->GetCellPosition(prev), prev); //If there is an obstruction found between the robot and the current cell in the loop, the function returns the previous cell that could be reached via a straight line
+	//If the player is somewhere the robot can't get to (e.g. on top of one of the boxes with no ramp), flooding the whole region looking for them is pointless.
+	//Head for the closest cell the robot can actually reach instead.
+	FCellRef goalCell = DestinationCell;
+	int32 startRegion = Grid->GetCellRegion(startCell);
+	if (startRegion != INDEX_NONE && !Grid->AreCellsConnected(startCell, DestinationCell)) {
+		FCellRef substituteCell = Grid->FindNearestCellInRegion(DestinationCell, startRegion);
+		if (!substituteCell.IsValid()) {
+			//Nothing reachable anywhere near the player, so there's no path to find
+			return GAPS_Invalid;
 		}
+		goalCell = substituteCell;
+	}
+
+	//Search for the path, then head for the furthest cell along it that can be reached in a straight line
+	TArray<FCellRef>& path = PathScratch;
 
-		prev = element;
+	//Boolean to check if a path has been found. This is only relevenat if the player jumps ontop of either of the two square structures that have no ramp leading up to them so there is no possible path for the robot to reach the player. 
+	bool pathFound = bUseLegacyPathSearch ? FindPathLegacy(startCell, goalCell, path) : FindPath(startCell, goalCell, path);
+
+	//in the event the player is in a "glitch spot" where there is no possible path to be found as the player is standing in an area surrounded by non-traversible cells
+	//in this case it seems reasonable to just point the robot at the player because without this the robot was standing in place without trying to locate the player
+	if (!pathFound) {
+		//Steps[0].Set(FVector2D(Destination), DestinationCell);
+
+		//I was originially pointing the robot in the direction of the player, but that was causing some edge case issues if the robot got too close to the edge and would end up in an untraversible cell. Now the robot will just stop moving in this event.
+		return GAPS_Invalid;
 	}
-	
-	return make_tuple(Grid->GetCellPosition(path.back()), path.back()); //If all cells return false that means all are reachable via a straight line and it returns the end of the path (i.e. the player's cell) as the one to point towards
+
+	FPathStep& step = Steps.AddDefaulted_GetRef();
+	if (path.Num() >= 2) {
+		tuple<FVector, FCellRef> moveToTuple = getLineTrace(path, startCell, Grid, PathPositionsScratch);
+		if (Grid->IsCellTraversable(get<1>(moveToTuple))) {
+			step.Set(FVector2D(get<0>(moveToTuple)), get<1>(moveToTuple));
+		}
+		else {
+			//The robot is standing somewhere it shouldn't be (e.g. pushed off the edge), so just take the first step of the path back
+			step.Set(FVector2D(Grid->GetCellPosition(path[1])), path[1]);
+		}
+	}
+	else {
+		//When the robot finds the player, the new paths generated will be only 1 cell in length and calling index 1 will cause a crash
+		//This allows the player to start moving again and the robot will follow the player straight away then switch back to A* as soon as enough distance is created or an obstacle is in the way
+		step.Set(FVector2D(StartPoint), startCell);
+	}
+
+	return GAPS_Active;
+}
+
+bool UGAPathComponent::FindPath(const FCellRef& StartCell, const FCellRef& GoalCell, TArray<FCellRef>& PathOut)
+{
+	const AGAGridActor* Grid = GetGridActor();
+	PathOut.Reset();
+
+	//Bits are cleared every search, costs and parents are only read for cells that have been opened this search
+	const int32 xCount = Grid->XCount;
+	OpenedCellsScratch.Init(Grid->XCount, Grid->YCount);
+	ClosedCellsScratch.Init(Grid->XCount, Grid->YCount);
+	if (!OpenedCellsScratch.IsValidCell(StartCell.X, StartCell.Y)) {
+		return false;
+	}
+	PathCostsScratch.SetNumUninitialized(Grid->XCount * Grid->YCount, false);
+	ParentsScratch.SetNumUninitialized(Grid->XCount * Grid->YCount, false);
+	OpenListScratch.Reset();
+
+	//Any cell within ArrivalDistance of the goal will do. Every step costs at least 1 (see below) and is to a side neighbor, so the Manhattan distance
+	//to the goal, less the most that the arrival distance can knock off it, never overestimates what's left
+	const float arrivalCells = ArrivalDistance / Grid->CellScale;
+	const float arrivalCellsSquared = FMath::Square(arrivalCells);
+	const float heuristicSlack = arrivalCells * UE_SQRT_2;
+	auto heuristic = [&](int32 x, int32 y) {
+		return FMath::Max(float(FMath::Abs(x - GoalCell.X) + FMath::Abs(y - GoalCell.Y)) - heuristicSlack, 0.0f);
+	};
+
+	const int32 startIndex = Grid->CellRefToIndex(StartCell);
+	PathCostsScratch[startIndex] = 0.0f;
+	ParentsScratch[startIndex] = INDEX_NONE;
+	OpenedCellsScratch.Set(StartCell.X, StartCell.Y, true);
+	OpenListScratch.HeapPush(TPair<float, int32>(heuristic(StartCell.X, StartCell.Y), startIndex), LowerPathCostFirst());
+
+	while (OpenListScratch.Num() > 0) {
+		TPair<float, int32> entry;
+		OpenListScratch.HeapPop(entry, LowerPathCostFirst(), false);
+
+		const int32 curIndex = entry.Value;
+		const int32 curX = curIndex % xCount;
+		const int32 curY = curIndex / xCount;
+
+		//A cell is queued again whenever a cheaper way to it turns up, so only its first (cheapest) pop counts
+		if (ClosedCellsScratch.Get(curX, curY)) {
+			continue;
+		}
+		ClosedCellsScratch.Set(curX, curY, true);
+
+		//The first cell popped within the arrival distance is the cheapest one to get to. Walk the parents back to the start for the path.
+		if (FMath::Square(float(curX - GoalCell.X)) + FMath::Square(float(curY - GoalCell.Y)) <= arrivalCellsSquared) {
+			for (int32 index = curIndex; index != INDEX_NONE; index = ParentsScratch[index]) {
+				PathOut.Add(FCellRef(index % xCount, index / xCount));
+			}
+			Algo::Reverse(PathOut);
+			return true;
+		}
+
+		//Only the left-right-up-down neighbors, and only the traversable ones
+		const uint8 openNeighbors = Grid->GetTraversableNeighborMask(FCellRef(curX, curY)) & FGAGridBitPlane::SideNeighborsMask;
+
+		for (int32 n = 0; n < 8; n++) {
+			if (((openNeighbors >> n) & 1) == 0) {
+				continue;
+			}
+
+			const int32 adjX = curX + FGAGridBitPlane::NeighborDX[n];
+			const int32 adjY = curY + FGAGridBitPlane::NeighborDY[n];
+			if (ClosedCellsScratch.Get(adjX, adjY)) {
+				continue;
+			}
+
+			//The agent has to fit in the cell, except for the destination itself, since the player can stand anywhere
+			FCellRef adjCell(adjX, adjY);
+			if (AgentRadius > 0.0f && !(adjCell == GoalCell) && !Grid->HasClearance(adjCell, AgentRadius)) {
+				continue;
+			}
+
+			//Stepping into a cell costs that cell's traversal cost (1 unless it's slow, a door, a hazard etc.)
+			//The grid never costs a cell below 1, but the heuristic is only admissible if that holds, so make sure of it here
+			const float newCost = PathCostsScratch[curIndex] + float(FMath::Max(Grid->GetCellCost(adjCell), 1));
+			const int32 adjIndex = Grid->CellRefToIndex(adjCell);
+			if (!OpenedCellsScratch.Get(adjX, adjY) || newCost < PathCostsScratch[adjIndex]) {
+				OpenedCellsScratch.Set(adjX, adjY, true);
+				PathCostsScratch[adjIndex] = newCost;
+				ParentsScratch[adjIndex] = curIndex;
+				OpenListScratch.HeapPush(TPair<float, int32>(newCost + heuristic(adjX, adjY), adjIndex), LowerPathCostFirst());
+			}
+		}
+	}
+
+	return false;
 }
 
+// Legacy search --------------------------------
+// The original greedy search and its helpers, only kept for bUseLegacyPathSearch and BenchmarkPathSearch
+
 //Helper function for CompareCells operator
 //Calculates the linear distance between two cells on the grid
 double calculateDistance(const FCellRef& point1, const FCellRef& point2) {
@@ -162,6 +311,16 @@ double calculateDistance(const FCellRef& point1, const FCellRef& point2) {
 	return sqrt(deltaX * deltaX + deltaY * deltaY);
 }
 
+//Helper to look up whether the neighbor at offset (dx, dy) is set in a mask from AGAGridActor::GetTraversableNeighborMask
+bool IsNeighborOpen(uint8 neighborMask, int dx, int dy) {
+	for (int i = 0; i < 8; i++) {
+		if (FGAGridBitPlane::NeighborDX[i] == dx && FGAGridBitPlane::NeighborDY[i] == dy) {
+			return (neighborMask >> i) & 1;
+		}
+	}
+	return false;
+}
+
 //Struct to compare cells to be sorted in priority queue
 struct CompareCells {
 	const FCellRef& DestinationCell;
@@ -176,27 +335,18 @@ struct CompareCells {
 	}
 };
 
-//A* search function
-EGAPathState UGAPathComponent::AStar()
+bool UGAPathComponent::FindPathLegacy(const FCellRef& StartCell, const FCellRef& GoalCell, TArray<FCellRef>& PathOut) const
 {
 	const AGAGridActor* Grid = GetGridActor();
-
-	Steps.SetNum(1);
-	
-	//Get the current location of the robot and set it as the startCell
-	AActor* Owner = GetOwnerPawn();
-	FVector StartPoint = Owner->GetActorLocation();
-	FCellRef startCell = Grid->GetCellRef(StartPoint);
+	PathOut.Reset();
 
 	//Makes a priority queue of tuples of <FCellRef, vector<FCellRef>>. This represents the current cell being searched and the path leading from the start to that current cell. And CompareCells is passed in to sort them based on distance to the player
-	CompareCells compareCellsInstance(DestinationCell);
+	CompareCells compareCellsInstance(GoalCell);
 	priority_queue<tuple<FCellRef, vector<FCellRef>>, vector<tuple<FCellRef, vector<FCellRef>>>, CompareCells> pq(compareCellsInstance);
 	vector<FCellRef> startVector;
-	pq.push(make_tuple(startCell, startVector));
+	pq.push(make_tuple(StartCell, startVector));
 	vector<FCellRef> visited;
-	visited.push_back(startCell);
-	//Boolean to check if a path has been found. This is only relevenat if the player jumps ontop of either of the two square structures that have no ramp leading up to them so there is no possible path for the robot to reach the player. 
-	bool pathFound = false;
+	visited.push_back(StartCell);
 
 	while (!pq.empty()) {
 		tuple<FCellRef, vector<FCellRef>> curCellTuple = pq.top();
@@ -207,27 +357,13 @@ EGAPathState UGAPathComponent::AStar()
 
 		//priority queue pops the top element which is the closest to the player and converts that cell and the destinationCell to FVector2D
 		FVector2D curCell2D = Grid->GetCellGridSpacePosition(curCell);
-		FVector2D destCell2D = Grid->GetCellGridSpacePosition(DestinationCell);
+		FVector2D destCell2D = Grid->GetCellGridSpacePosition(GoalCell);
 		
-		//If the current cell is within the arrival distance we have found the optimal path
+		//If the current cell is within the arrival distance we have found the path
 		if (FVector2D::Distance(curCell2D, destCell2D) <= ArrivalDistance) {
-
-			if (curPath.size() >= 2) {
-				UWorld* World = GetWorld();
-				tuple<FVector, FCellRef> moveToTuple = getLineTrace(curPath, startCell, Grid);
-				if (Grid->GetCellData(get<1>(moveToTuple)) == ECellData::CellDataTraversable) {
-					Steps[0].Set(FVector2D(get<0>(moveToTuple)), get<1>(moveToTuple));
-				}
-			}
-			else {
-				//When the robot finds the player, the new paths generated will be only 1 cell in length and calling index 1 will cause a crash
-				//This allows the player to start moving again and the robot will follow the player straight away then switch back to A* as soon as enough distance is created or an obstacle is in the way
-				Steps[0].Set(FVector2D(StartPoint), startCell);
-			}
-
-			//Sets pathFound to true and breaks out of the while loop
-			pathFound = true;
-			break;
+			PathOut.Append(curPath.data(), int32(curPath.size()));
+			PathOut.Add(curCell);
+			return true;
 		}
 
 		//If not path was found the current cell is added to the existing path
@@ -244,6 +380,9 @@ EGAPathState UGAPathComponent::AStar()
 			//{-1,-1},
 		};
 
+		//Grab which neighbors are traversable in one go, so blocked directions can be skipped without looking at the grid again
+		uint8 openNeighbors = Grid->GetTraversableNeighborMask(curCell);
+
 		//Loop through the left-right-up-down neighbor adjacent cells of the current cell 
 		for (const list<int>& d : directions) {
 			auto it2 = d.begin();
@@ -253,25 +392,95 @@ EGAPathState UGAPathComponent::AStar()
 
 			FCellRef adjCell = FCellRef(newX, newY);
 
+			//The agent has to fit in the cell, except for the destination itself, since the player can stand anywhere
+			if (AgentRadius > 0.0f && !(adjCell == GoalCell) && !Grid->HasClearance(adjCell, AgentRadius)) {
+				continue;
+			}
+
 			//If the neighbor has not already been visisted, is valid, and is traversable, then it is added to visited and added to the priority queue
 			auto inVisted = find(visited.begin(), visited.end(), adjCell);
-			if (inVisted == visited.end() && adjCell.IsValid() && Grid->GetCellData(adjCell) == ECellData::CellDataTraversable) {
+			if (IsNeighborOpen(openNeighbors, newX - curCell.X, newY - curCell.Y) && inVisted == visited.end()) {
 				visited.push_back(adjCell);
 				pq.push(make_tuple(adjCell, curPath));
 			}
 		}
 	}
 
-	//in the event the player is in a "glitch spot" where there is no possible path to be found as the player is standing in an area surrounded by non-traversible cells
-	//in this case it seems reasonable to just point the robot at the player because without this the robot was standing in place without trying to locate the player
-	if (!pathFound) {
-		//Steps[0].Set(FVector2D(Destination), DestinationCell);
+	return false;
+}
 
-		//I was originially pointing the robot in the direction of the player, but that was causing some edge case issues if the robot got too close to the edge and would end up in an untraversible cell. Now the robot will just stop moving in this event.
-	} 
+#if WITH_EDITOR
+void UGAPathComponent::BenchmarkPathSearch()
+{
+	const int32 QueryCount = 50;
 
-	return GAPS_Active;
+	const AGAGridActor* Grid = GetGridActor();
+	if ((Grid == NULL) || !Grid->IsGridDataReady()) {
+		UE_LOG(LogTemp, Warning, TEXT("BenchmarkPathSearch: no grid to search"));
+		return;
+	}
+
+	//Random pairs of cells that are connected, so both searches have something to find. Seeded, so every run searches the same pairs.
+	FRandomStream random(0x5EED);
+	TArray<TPair<FCellRef, FCellRef>> queries;
+	for (int32 attempt = 0; queries.Num() < QueryCount && attempt < QueryCount * 100; attempt++) {
+		FCellRef fromCell(random.RandRange(0, Grid->XCount - 1), random.RandRange(0, Grid->YCount - 1));
+		FCellRef toCell(random.RandRange(0, Grid->XCount - 1), random.RandRange(0, Grid->YCount - 1));
+		if (Grid->IsCellTraversable(fromCell) && Grid->IsCellTraversable(toCell) && Grid->AreCellsConnected(fromCell, toCell)) {
+			queries.Add(TPair<FCellRef, FCellRef>(fromCell, toCell));
+		}
+	}
+
+	if (queries.Num() == 0) {
+		UE_LOG(LogTemp, Warning, TEXT("BenchmarkPathSearch: no connected cells to search between"));
+		return;
+	}
+
+	//What it costs to follow a path, by the same per-cell costs FindPath goes by
+	auto getPathCost = [Grid](const TArray<FCellRef>& path) {
+		int64 cost = 0;
+		for (int32 i = 1; i < path.Num(); i++) {
+			cost += FMath::Max(Grid->GetCellCost(path[i]), 1);
+		}
+		return cost;
+	};
+
+	TArray<FCellRef> legacyPath, aStarPath;
+	double legacySeconds = 0.0, aStarSeconds = 0.0;
+	int32 legacyFound = 0, aStarFound = 0, mismatches = 0;
+	int64 legacyCost = 0, aStarCost = 0;
+
+	for (const TPair<FCellRef, FCellRef>& query : queries) {
+		double startTime = FPlatformTime::Seconds();
+		bool bLegacyFound = FindPathLegacy(query.Key, query.Value, legacyPath);
+		legacySeconds += FPlatformTime::Seconds() - startTime;
+
+		startTime = FPlatformTime::Seconds();
+		bool bAStarFound = FindPath(query.Key, query.Value, aStarPath);
+		aStarSeconds += FPlatformTime::Seconds() - startTime;
+
+		const int64 queryLegacyCost = bLegacyFound ? getPathCost(legacyPath) : 0;
+		const int64 queryAStarCost = bAStarFound ? getPathCost(aStarPath) : 0;
+		legacyFound += bLegacyFound ? 1 : 0;
+		aStarFound += bAStarFound ? 1 : 0;
+		legacyCost += queryLegacyCost;
+		aStarCost += queryAStarCost;
+
+		//Both searches explore the same cells, so they have to agree on whether there's a way there, and A* should never do worse than the greedy search
+		if (bLegacyFound != bAStarFound || queryAStarCost > queryLegacyCost) {
+			mismatches++;
+			UE_LOG(LogTemp, Error, TEXT("BenchmarkPathSearch: (%d, %d) to (%d, %d): legacy %s, cost %lld; A* %s, cost %lld"),
+				query.Key.X, query.Key.Y, query.Value.X, query.Value.Y,
+				bLegacyFound ? TEXT("found") : TEXT("not found"), queryLegacyCost, bAStarFound ? TEXT("found") : TEXT("not found"), queryAStarCost);
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("BenchmarkPathSearch on %s (%d x %d), %d queries: legacy %.3f ms, %d found, total cost %lld; A* %.3f ms, %d found, total cost %lld; %.2fx faster, %d mismatches"),
+		*GetWorld()->GetMapName(), Grid->XCount, Grid->YCount, queries.Num(),
+		legacySeconds * 1000.0, legacyFound, legacyCost, aStarSeconds * 1000.0, aStarFound, aStarCost,
+		(aStarSeconds > 0.0) ? legacySeconds / aStarSeconds : 0.0, mismatches);
 }
+#endif // WITH_EDITOR
 
 void UGAPathComponent::FollowPath()
 {
@@ -298,6 +507,23 @@ FVector UGAPathComponent::GetRandomAccessiblePosition()
 	const AGAGridActor* Grid = GetGridActor();
 	FVector CurrentLocation = GetOwnerPawn()->GetActorLocation();
 
+	// Bounds (in cells) of the sampling box. If none of it is traversable, don't bother sampling.
+	FIntRect SampleRect(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+	for (int32 Corner = 0; Corner < 4; Corner++)
+	{
+		FVector CornerPoint(CurrentLocation.X + ((Corner & 1) ? 2000 : -2000), CurrentLocation.Y + ((Corner & 2) ? 2000 : -2000), CurrentLocation.Z);
+		FCellRef CornerCell = Grid->GetCellRef(CornerPoint);
+		SampleRect.Include(FIntPoint(CornerCell.X, CornerCell.Y));
+	}
+
+	if (Grid->GetRectCoverage(SampleRect) == EGACellCoverage::None)
+	{
+		return FVector();
+	}
+
+	//Only accept positions the pawn can actually walk to, as long as it's standing somewhere sensible itself
+	int32 ownerRegion = Grid->GetCellRegion(Grid->GetCellRef(CurrentLocation));
+
 	int maxAttempts = 10000;
 	int attempt = 0;
 
@@ -309,7 +535,8 @@ FVector UGAPathComponent::GetRandomAccessiblePosition()
 
 		FCellRef CellRef = Grid->GetCellRef(Candidate);
 
-		if (Grid->GetCellData(CellRef) == ECellData::CellDataTraversable) {
+		//Don't wander into hazards on purpose
+		if (Grid->HasClearance(CellRef, AgentRadius) && !Grid->HasCellFlag(CellRef, ECellData::CellDataHazard) && (ownerRegion == INDEX_NONE || Grid->GetCellRegion(CellRef) == ownerRegion)) {
 			return Candidate;
 		}
 		attempt++;
@@ -334,7 +561,11 @@ EGAPathState UGAPathComponent::SetDestination(const FVector &DestinationPoint)
 			DestinationCell = CellRef;
 			bDestinationValid = true;
 
-			RefreshPath();
+			// If the grid isn't ready yet, TickComponent will pick the path up once it is
+			if (Grid->IsGridDataReady())
+			{
+				RefreshPath();
+			}
 		}
 	}
 
@@ -67,6 +67,15 @@ class UGAPathComponent : public UActorComponent
 
 	EGAPathState AStar();
 
+	// Search from StartCell for the cheapest way (by AGAGridActor::GetCellCost) to a cell within ArrivalDistance of
+	// GoalCell. A* over flat cell indices, with a binary heap, closed-set bits and parent indices that are all kept
+	// between searches. PathOut gets the cells from StartCell to the cell reached, both included.
+	// Returns false if there's no way there.
+	bool FindPath(const FCellRef& StartCell, const FCellRef& GoalCell, TArray<FCellRef>& PathOut);
+
+	// The original search: greedy best-first by distance to GoalCell, ignoring cell costs. Same arguments as FindPath.
+	bool FindPathLegacy(const FCellRef& StartCell, const FCellRef& GoalCell, TArray<FCellRef>& PathOut) const;
+
 	void FollowPath();
 
 	// Parameters ------------------------
@@ -75,6 +84,24 @@ class UGAPathComponent : public UActorComponent
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	float ArrivalDistance;
 
+	// Pathing only uses cells at least this far from anything non-traversable (see AGAGridActor::HasClearance).
+	// 0 treats the agent as a point.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float AgentRadius;
+
+	// If true, paths are found with FindPathLegacy rather than FindPath.
+	// Only really useful for comparing the two -- see BenchmarkPathSearch.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bUseLegacyPathSearch;
+
+#if WITH_EDITOR
+	// Run FindPath and FindPathLegacy between the same 50 random pairs of connected cells of the current grid (e.g. one of
+	// the TestMap levels), and log how long each took and what their paths cost. Any pair they disagree on reaching, or
+	// that A* found a costlier path for, is logged as an error.
+	UFUNCTION(CallInEditor)
+	void BenchmarkPathSearch();
+#endif // WITH_EDITOR
+
 	// Destination ------------------------
 
 	UFUNCTION(BlueprintCallable)
@@ -100,5 +127,26 @@ class UGAPathComponent : public UActorComponent
 	UPROPERTY(BlueprintReadWrite)
 	TArray<FPathStep> Steps;
 
+private:
+	// Scratch space for FindPath, kept from one search to the next so it stops allocating once it's warmed up.
+	// Costs and parents are indexed by AGAGridActor::CellRefToIndex, and only mean anything for cells in OpenedCellsScratch.
+
+	// Binary heap of (cost so far + heuristic, cell index)
+	TArray<TPair<float, int32>> OpenListScratch;
+
+	// Cost of the cheapest way to each cell found so far
+	TArray<float> PathCostsScratch;
+
+	// The cell each cell is reached from, INDEX_NONE for the start
+	TArray<int32> ParentsScratch;
+
+	FGAGridBitPlane OpenedCellsScratch;
+
+	FGAGridBitPlane ClosedCellsScratch;
+
+	TArray<FCellRef> PathScratch;
+
+	// Positions of the cells of PathScratch, for smoothing
+	TArray<FVector> PathPositionsScratch;
 
 };
\ No newline at end of file
@@ -62,6 +62,8 @@ void UGATargetComponent::OnRegister()
 	if (Grid)
 	{
 		OccupancyMap = FGAGridMap(Grid, 0.0f);
+		OccupancyMap.SetChunked(bSparseOccupancyMap);
+		bOccupancySumsDirty = true;
 	}
 }
 
@@ -114,6 +116,13 @@ void UGATargetComponent::TickComponent(float DeltaTime, enum ELevelTick TickType
 		LastKnownState.State = GATS_Hidden;
 	}
 
+	// The omap reads the grid's cell data, so leave it alone until the grid has finished building
+	AGAGridActor* Grid = GetGridActor();
+	if ((Grid == NULL) || !Grid->IsGridDataReady())
+	{
+		return;
+	}
+
 	if (LastKnownState.State == GATS_Hidden)
 	{
 		OccupancyMapUpdate();
@@ -128,7 +137,6 @@ void UGATargetComponent::TickComponent(float DeltaTime, enum ELevelTick TickType
 
 	if (bDebugOccupancyMap)
 	{
-		AGAGridActor* Grid = GetGridActor();
 		Grid->DebugGridMap = OccupancyMap;
 		GridActor->RefreshDebugTexture();
 		GridActor->DebugMeshComponent->SetVisibility(true);
@@ -136,6 +144,31 @@ void UGATargetComponent::TickComponent(float DeltaTime, enum ELevelTick TickType
 }
 
 
+float UGATargetComponent::GetOccupancyAround(const FVector& Point, float Radius) const
+{
+	const AGAGridActor* Grid = GetGridActor();
+	if ((Grid == NULL) || !OccupancyMap.IsValid())
+	{
+		return 0.0f;
+	}
+
+	if (bOccupancySumsDirty)
+	{
+		// Everything outside the active bounds is 0, so that's all the table needs to cover
+		if (OccupancyMap.GetActiveBounds().IsValid()) {
+			OccupancySums.Build(OccupancyMap, NULL, OccupancyMap.GetActiveBounds());
+		}
+		else {
+			OccupancySums.Reset();
+		}
+		bOccupancySumsDirty = false;
+	}
+
+	const int32 cellRadius = FMath::Max(FMath::RoundToInt(Radius / Grid->CellScale), 0);
+	return float(OccupancySums.GetSumAround(Grid->GetCellRef(Point), cellRadius));
+}
+
+
 void UGATargetComponent::OccupancyMapSetPosition(const FVector& Position)
 {
 	// TODO PART 4
@@ -145,19 +178,9 @@ void UGATargetComponent::OccupancyMapSetPosition(const FVector& Position)
 	AGAGridActor* Grid = GetGridActor();
 	FCellRef curPosCell = Grid->GetCellRef(Position);
 
-	for (int32 Y = OccupancyMap.GridBounds.MinY; Y < OccupancyMap.GridBounds.MaxY; Y++)
-	{
-		for (int32 X = OccupancyMap.GridBounds.MinX; X < OccupancyMap.GridBounds.MaxX; X++)
-		{
-			if (Y == curPosCell.Y && X == curPosCell.X) {
-				OccupancyMap.SetValue(curPosCell, 1.0f);
-			}
-			else {
-				FCellRef CellRef(X, Y);
-				OccupancyMap.SetValue(CellRef, 0.0f);
-			}
-		}
-	}
+	OccupancyMap.Fill(0.0f);
+	OccupancyMap.SetValue(curPosCell, 1.0f);
+	bOccupancySumsDirty = true;
 }
 
 // Function to check if a vector is within the vision angle
@@ -201,12 +224,22 @@ void UGATargetComponent::OccupancyMapUpdate()
 	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
 	if (Grid)
 	{
-		FGAGridMap VisibilityMap(Grid, 0.0f);
+		// The cells some AI can see right now (kept between updates, so this only allocates when the grid size changes)
+		VisibleCells.Init(Grid->XCount, Grid->YCount);
 
 		// TODO PART 4
 
 		// STEP 1: Build the visibility map, based on the perception components of the AIs in the world
 
+		// Seeing a cell only matters if there's some probability in it to clear out, and all of those are inside the
+		// omap's active bounds, so that's all that needs testing (bounds here are exclusive, like the loops below)
+		const FGridBox& activeBounds = OccupancyMap.GetActiveBounds();
+		const bool hasActive = activeBounds.IsValid();
+		const int32 minX = hasActive ? FMath::Max(OccupancyMap.GridBounds.MinX, activeBounds.MinX) : 0;
+		const int32 maxX = hasActive ? FMath::Min(OccupancyMap.GridBounds.MaxX, activeBounds.MaxX + 1) : 0;
+		const int32 minY = hasActive ? FMath::Max(OccupancyMap.GridBounds.MinY, activeBounds.MinY) : 0;
+		const int32 maxY = hasActive ? FMath::Min(OccupancyMap.GridBounds.MaxY, activeBounds.MaxY + 1) : 0;
+
 		UGAPerceptionSystem* PerceptionSystem = UGAPerceptionSystem::GetPerceptionSystem(this);
 		if (PerceptionSystem)
 		{
@@ -220,21 +253,64 @@ void UGATargetComponent::OccupancyMapUpdate()
 				float angle = PerceptionComponent->VisionParameters.VisionAngle;
 				float dist = PerceptionComponent->VisionParameters.VisionDistance;
 
-				for (int32 Y = OccupancyMap.GridBounds.MinY; Y < OccupancyMap.GridBounds.MaxY; Y++)
+				bool hasFound = IsWithinDistance(Start, LastKnownState.Position, 200.0f);
+
+				// Test visibility of where the target's center would be if it stood on each cell
+				float TargetHeightAboveGround = 0.0f;
+				const bool bHasTargetHeight = Grid->GetHeightAboveGround(GetOwner()->GetActorLocation(), TargetHeightAboveGround);
+
+				// World positions of a row of cells, converted a row at a time
+				const int32 RowWidth = FMath::Max(maxX - minX, 0);
+				TArray<FCellRef>& RowCells = RowCellsScratch;
+				TArray<FVector>& RowPositions = RowPositionsScratch;
+				RowCells.SetNumUninitialized(RowWidth, false);
+				RowPositions.SetNumUninitialized(RowWidth, false);
+
+				// With a baked visibility table, cells the viewer can't possibly see don't need tracing
+				const FCellRef ViewerCell = Grid->GetCellRef(Start);
+
+				for (int32 Y = minY; Y < maxY; Y++)
 				{
-					for (int32 X = OccupancyMap.GridBounds.MinX; X < OccupancyMap.GridBounds.MaxX; X++)
+					// A row with no traversable cells can only matter once the target has been reached
+					if (!hasFound && !Grid->IsAnyTraversableInSpan(Y, minX, maxX - 1))
 					{
+						continue;
+					}
 
-						FCellRef CellRef(X, Y);
-						FVector End = Grid->GetCellPosition(CellRef);
-						End.Z = Start.Z;
+					// Likewise for a row the viewer can't see any of
+					if (!hasFound && !Grid->IsAnyCellPotentiallyVisibleInSpan(ViewerCell, Y, minX, maxX - 1))
+					{
+						continue;
+					}
 
-						bool flags = EnumHasAllFlags(Grid->GetCellData(CellRef), ECellData::CellDataTraversable);
+					for (int32 Index = 0; Index < RowWidth; Index++)
+					{
+						RowCells[Index] = FCellRef(minX + Index, Y);
+					}
+					Grid->GetCellPositions(RowCells, RowPositions);
+
+					//Only cells with some probability in them have anything to clear, so the rest don't need tracing
+					OccupancyMap.ForEachCell([&](const FCellRef& CellRef, float prob) {
+						if (prob == 0.0f) {
+							return;
+						}
+
+						FVector End = RowPositions[CellRef.X - minX];
+						if (bHasTargetHeight && Grid->HasCellHeight(CellRef))
+						{
+							End.Z += TargetHeightAboveGround;
+						}
+						else
+						{
+							End.Z = Start.Z;
+						}
+
+						bool flags = Grid->IsCellTraversable(CellRef);
 						bool inAngle = IsWithinVisionAngle(ForwardVector, End - Start, angle);
 						bool inDist = IsWithinDistance(Start, End, dist);
-						bool hasFound = IsWithinDistance(Start, LastKnownState.Position, 200.0f);
+						bool maybeVisible = Grid->IsCellPotentiallyVisible(ViewerCell, CellRef);
 
-						if ((flags && inAngle && inDist) || (hasFound)) { //check if the cell is within the VisionDistance before casting a ray because if it isnt theres no point since its not visible or if its reached the max cell
+						if ((flags && inAngle && inDist && maybeVisible) || (hasFound)) { //check if the cell is within the VisionDistance before casting a ray because if it isnt theres no point since its not visible or if its reached the max cell
 
 							UWorld* World = GetWorld();
 							FHitResult HitResult;
@@ -245,64 +321,39 @@ void UGATargetComponent::OccupancyMapUpdate()
 							//If bHitSomething is false, then we have a clear LOS
 
 							if (!bHitSomething) {
-								VisibilityMap.SetValue(CellRef, 1.0f);
+								VisibleCells.Set(CellRef.X, CellRef.Y, true);
 							}
 
-						}	
-					}
+						}
+					}, FGridBox(minX, maxX - 1, Y, Y));
 				}
 			}
 		}
 
 		// STEP 2: Clear out the probability in the visible cells
-		float oMapSum = 0.0f;
-		float ocuVal;
-
-		for (int32 Y = VisibilityMap.GridBounds.MinY; Y < VisibilityMap.GridBounds.MaxY; Y++)
-		{
-			for (int32 X = VisibilityMap.GridBounds.MinX; X < VisibilityMap.GridBounds.MaxX; X++)
-			{
-				FCellRef CellRef(X, Y);
-				float visVal;
-				VisibilityMap.GetValue(CellRef, visVal);
-				if (visVal == 1.0f) {
-					OccupancyMap.SetValue(CellRef, 0.0f);
-				}
+		OccupancyMap.Fill(0.0f, &VisibleCells);
+		float oMapSum = OccupancyMap.Sum();
 
-				OccupancyMap.GetValue(CellRef, ocuVal);
-				oMapSum += ocuVal;
-			}
+		// STEP 3: Renormalize the OMap, so that it's still a valid probability distribution
+		const FGAGridBitPlane& traversable = Grid->GetTraversableBits();
+		if (oMapSum > 0.0f) {
+			OccupancyMap.Scale(1.0f / oMapSum, &traversable);
 		}
 
-		// STEP 3: Renormalize the OMap, so that it's still a valid probability distribution
 		float maxVal = 0.0f;
 		FCellRef maxCell;
-
-		for (int32 Y = OccupancyMap.GridBounds.MinY; Y < OccupancyMap.GridBounds.MaxY; Y++)
-		{
-			for (int32 X = OccupancyMap.GridBounds.MinX; X < OccupancyMap.GridBounds.MaxX; X++)
-			{
-				FCellRef CellRef(X, Y);
-
-				bool flags = EnumHasAllFlags(Grid->GetCellData(CellRef), ECellData::CellDataTraversable);
-
-				if (flags) {
-					float curVal;
-					OccupancyMap.GetValue(CellRef, curVal);
-					float newVal = curVal / oMapSum;
-					OccupancyMap.SetValue(CellRef, newVal);
-
-					if (newVal > maxVal) {
-						maxVal = newVal;
-						maxCell = CellRef;
-					}
-				}
-			}
+		FCellRef bestCell;
+		float bestVal;
+		if (OccupancyMap.ArgMax(bestCell, bestVal, &traversable) && bestVal > maxVal) {
+			maxVal = bestVal;
+			maxCell = bestCell;
 		}
 
 		// STEP 4: Extract the highest-likelihood cell on the omap and refresh the LastKnownState.
 		FVector maxVec = Grid->GetCellPosition(maxCell);
 		LastKnownState.Position = maxVec;
+
+		bOccupancySumsDirty = true;
 	}
 
 }
@@ -313,109 +364,55 @@ void UGATargetComponent::OccupancyMapDiffuse()
 	// TODO PART 4
 	// Diffuse the probability in the OMAP
 	float alpha = 0.75f;
-	float r2 = FMath::Sqrt(2.0f);
-
-	std::list<std::pair<int, int>> sides = {
-			{0,1},
-			{0,-1},
-			{1,0},
-			{-1,0},
-	};
-
-	std::list<std::pair<int, int>> diag = {
-			{1,1},
-			{1,-1},
-			{-1,1},
-			{-1,-1},
-	};
-
-	int32 maxX = OccupancyMap.GridBounds.MaxX;
-	int32 maxY = OccupancyMap.GridBounds.MaxY;
-	int32 minX = OccupancyMap.GridBounds.MinX;
-	int32 minY = OccupancyMap.GridBounds.MinY;
 
 	AGAGridActor* Grid = GetGridActor();
 
-	for (int32 Y = minY; Y < maxY; Y++)	//Only diffuse cells with >0.0f value
-	{
-		for (int32 X = minX; X < maxX; X++)
-		{
-			FCellRef CellRef(X, Y);
-			float curProb;
-			OccupancyMap.GetValue(CellRef, curProb);
-
-			if (curProb == 0.0f) {
-				continue;
-			}
-
-			float sideProb = alpha * curProb;
-			float diagProb = (alpha * curProb) / r2;
-
-			
-			bool flags = EnumHasAllFlags(Grid->GetCellData(CellRef), ECellData::CellDataTraversable);
-
-			for (const auto& s : sides) {
-
-				int32 newX = X + s.first;
-				int32 newY = Y + s.second;
-
-				if (flags && newX < maxX && newX >= minX && newY < maxY && newY >= minY) {
-					FCellRef sideRef(newX, newY);
-					float sideVal;
-					OccupancyMap.GetValue(sideRef, sideVal);
-					
-					if (curProb > sideVal) { //Only diffuse larger probabilities to smaller probabilities
-						OccupancyMap.SetValue(sideRef, sideProb);
-					}
-				}
+	if (OccupancyBlurSigma > 0.0f) {
+		//One separable pass over the active bounds; the traversable mask keeps probability from bleeding through walls
+		OccupancyMap.GaussianBlur(OccupancyBlurSigma, &Grid->GetTraversableBits());
+		OccupancyMap.Normalize();
+		bOccupancySumsDirty = true;
+		return;
+	}
 
-			}
+	//Cells with 0.0f have nothing to diffuse, and every other cell is inside the omap's active bounds, so only those
+	//and the ring of cells around them can change (a copy, since the map's own bounds move as it's modified)
+	const FGridBox activeBounds = OccupancyMap.GetActiveBounds();
+	if (!activeBounds.IsValid()) {
+		return;
+	}
 
-			for (const auto& d : diag) {
+	//Diffuse from a copy of the omap, so every cell sees what its neighbors held before this pass whatever order the cells are visited in
+	FGAPooledGridMap previous(Grid->GetMapPool(), Grid, OccupancyMap.GridBounds, 0.0f);
+	previous->Add(OccupancyMap, 1.0f, NULL, activeBounds);
 
-				int32 newX = X + d.first;
-				int32 newY = Y + d.second;
+	static const int32 sides[4][2] = {
+			{0,1},
+			{0,-1},
+			{1,0},
+			{-1,0},
+	};
 
-				if (flags && newX < maxX && newX >= minX && newY < maxY && newY >= minY) {
-					FCellRef diagRef(newX, newY);
-					float diagVal;
-					OccupancyMap.GetValue(diagRef, diagVal);
+	//Each traversable cell takes alpha times the largest probability of its traversable side neighbors, if that's more than it has already
+	//(only larger probabilities diffuse to smaller ones)
+	OccupancyMap.ModifyEachCell([&](const FCellRef& CellRef, float& curProb) {
+		if (!Grid->IsCellTraversable(CellRef)) {
+			return;
+		}
 
-					if (curProb > diagVal) { //Only diffuse larger probabilities to smaller probabilities
-						OccupancyMap.SetValue(diagRef, diagVal);
-					}
-				}
+		float sideMax = 0.0f;
+		for (const auto& side : sides) {
+			FCellRef sideRef(CellRef.X + side[0], CellRef.Y + side[1]);
+			float sideVal;
+			if (Grid->IsCellTraversable(sideRef) && previous->GetValue(sideRef, sideVal)) {
+				sideMax = FMath::Max(sideMax, sideVal);
 			}
 		}
-	}
 
-	float oMapSum = 0.0f;
-	float mapVal;
-
-	//Get the sum of probabilities after diffusion
-	for (int32 Y = OccupancyMap.GridBounds.MinY; Y < OccupancyMap.GridBounds.MaxY; Y++)
-	{
-		for (int32 X = OccupancyMap.GridBounds.MinX; X < OccupancyMap.GridBounds.MaxX; X++)
-		{
-			FCellRef CellRef(X, Y);
-
-			OccupancyMap.GetValue(CellRef, mapVal);
-			oMapSum += mapVal;
-		}
-	}
+		curProb = FMath::Max(curProb, alpha * sideMax);
+	}, FGridBox(activeBounds.MinX - 1, activeBounds.MaxX + 1, activeBounds.MinY - 1, activeBounds.MaxY + 1));
 
 	//Renormalize probabilities after diffusion
-	for (int32 Y = OccupancyMap.GridBounds.MinY; Y < OccupancyMap.GridBounds.MaxY; Y++)
-	{
-		for (int32 X = OccupancyMap.GridBounds.MinX; X < OccupancyMap.GridBounds.MaxX; X++)
-		{
-			FCellRef CellRef(X, Y);
-
-			float curVal;
-			OccupancyMap.GetValue(CellRef, curVal);
-			float newVal = curVal / oMapSum;
-			OccupancyMap.SetValue(CellRef, newVal);
-		}
-	}
-
+	OccupancyMap.Normalize();
+	bOccupancySumsDirty = true;
 }
@@ -3,6 +3,8 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "GameAI/Grid/GAGridMap.h"
+#include "GameAI/Grid/GAGridActor.h"
+#include "GameAI/Grid/GAGridSummedArea.h"
 #include "GATargetComponent.generated.h"
 
 
@@ -59,9 +61,22 @@ class UGATargetComponent : public UActorComponent
 	
 	// Occupancy Map
 
+	// Kept as a float map rather than a compact TGAGridMap: every update runs whole-map operations over it (masked
+	// fills, scaling, ArgMax, blurs, summed-area tables) that only FGAGridMap has, its chunked mode already keeps it
+	// small on big grids, and blueprint and the debug view read it as an FGAGridMap.
 	UPROPERTY(BlueprintReadOnly)
 	FGAGridMap OccupancyMap;
 
+	// If true, the occupancy map only allocates memory for the chunks of the grid that have some probability in them.
+	// Its Data array is then empty, so leave this off if blueprints read OccupancyMap.Data directly.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bSparseOccupancyMap = false;
+
+	// If > 0, OccupancyMapDiffuse spreads the probability with a Gaussian blur of this many cells over the traversable
+	// cells, instead of pushing it out to neighbours one cell at a time
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float OccupancyBlurSigma = 0.0f;
+
 	UPROPERTY(BlueprintReadOnly)
 	bool bDebugOccupancyMap = false;
 
@@ -88,6 +103,12 @@ class UGATargetComponent : public UActorComponent
 		return (LastKnownState.State == GATS_Immediate) || (LastKnownState.State == GATS_Hidden);
 	}
 
+	// Total probability in the omap of the square of cells within Radius (world units) of Point.
+	// Constant time, since spatial layers with the Perception input call it for every cell: the omap's summed-area table
+	// is only rebuilt once it has changed.
+	UFUNCTION(BlueprintCallable)
+	float GetOccupancyAround(const FVector& Point, float Radius) const;
+
 
 	// UPDATE ----------
 
@@ -102,4 +123,16 @@ class UGATargetComponent : public UActorComponent
 	void OccupancyMapUpdate();
 	void OccupancyMapDiffuse();
 
+private:
+	// Scratch space for OccupancyMapUpdate, kept between updates so that it stops allocating once it has warmed up
+
+	FGAGridBitPlane VisibleCells;
+
+	TArray<FCellRef> RowCellsScratch;
+
+	TArray<FVector> RowPositionsScratch;
+
+	// Summed-area table of the omap for GetOccupancyAround, built when first needed after the omap changes
+	mutable FGAGridSummedAreaTable OccupancySums;
+	mutable bool bOccupancySumsDirty = true;
 };
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "GASpatialComponent.h"
 #include "GameAI/Pathfinding/GAPathComponent.h"
+#include "GameAI/Perception/GAPerceptionComponent.h"
 #include "GameAI/Grid/GAGridMap.h"
 #include "Kismet/GameplayStatics.h"
+#include "Algo/Reverse.h"
 #include "Math/MathFwd.h"
 #include "GASpatialFunction.h"
 #include "ProceduralMeshComponent.h"
@@ -97,15 +99,16 @@ APawn* UGASpatialComponent::GetOwnerPawn() const
 	return NULL;
 }
 
-//Function that takes in the dijkstra distance map, the starting point, the max cell, and the grid and returns the shortest path between the starting point and the max cell via dijkstra
-vector<FCellRef> getPositionPath(const FGAGridMap& DistanceMapOut, const FVector& StartPoint, const FCellRef& dest, const AGAGridActor* Grid) {
+//Function that takes in the dijkstra distance map, the starting point, the max cell, and the grid and fills path with the shortest path between the starting point and the max cell via dijkstra
+//path is the caller's scratch array, so following the path every tick doesn't allocate
+void getPositionPath(const FGAGridDistanceMap& DistanceMapOut, const FVector& StartPoint, const FCellRef& dest, const AGAGridActor* Grid, TArray<FCellRef>& path) {
 
 	FCellRef curCell = dest;
 	FCellRef startCell = Grid->GetCellRef(StartPoint);
-	vector<FCellRef> path;
+	path.Reset();
 	int iter = 0;
 
-	list<pair<int, int>> directions = {
+	static const pair<int, int> directions[] = {
 			{0,1},
 			{0,-1},
 			{1,0},
@@ -114,7 +117,7 @@ vector<FCellRef> getPositionPath(const FGAGridMap& DistanceMapOut, const FVector
 
 	//Loop to start from the destination cell and follow the dijkstra neighbors back to the start cell to find the shortest path
 	while (curCell != startCell && iter < 1000) {
-		path.push_back(curCell);
+		path.Add(curCell);
 		
 		float cellVal = FLT_MAX;
 		FCellRef nextCell = curCell;
@@ -125,7 +128,7 @@ vector<FCellRef> getPositionPath(const FGAGridMap& DistanceMapOut, const FVector
 			FCellRef adjCell = FCellRef(newX, newY);
 
 			//Find the smallest distance neighbor and set the current cell to that cell so it can follow the dijkstra path
-			if (DistanceMapOut.GridBounds.IsValidCell(adjCell) && Grid->GetCellData(adjCell) == ECellData::CellDataTraversable) {
+			if (DistanceMapOut.GridBounds.IsValidCell(adjCell) && Grid->IsCellTraversable(adjCell)) {
 
 				float adjDist;
 				DistanceMapOut.GetValue(adjCell, adjDist);
@@ -143,66 +146,40 @@ vector<FCellRef> getPositionPath(const FGAGridMap& DistanceMapOut, const FVector
 	}
 
 	//Reverses the order of the path since the path was constructed in reverse order
-	reverse(path.begin(), path.end());
-
-	return path;
-}
-
-//Helper function for getLineTrace that will get 80 points along the line created from the current FVector location to the FVector location of the goal cell
-//Checks to see if there are any obstructions in the way that the robot could run into or if it is an open straight shot to the cell
-bool getPointsAlongLine2(const FVector& start, const FVector& end, const AGAGridActor* Grid) {
-	int steps = 80; //I Chose a step size of 80 because the grid is 80x80 and this makes it less likely that there would be an obstruction that wasnt caught by the interpolation
-
-	for (int i = 0; i < steps; ++i) {
-		// Calculate the interpolation factor (t) based on the current point index
-		float t = static_cast<float>(i) / (steps - 1);
-
-		// Interpolate between start and end using lerp
-		float x = start.X + t * (end.X - start.X);
-		float y = start.Y + t * (end.Y - start.Y);
-
-		FCellRef lineCell = Grid->GetCellRef(FVector(x, y, 0.0f));
-		if (Grid->GetCellData(lineCell) != ECellData::CellDataTraversable) { //Check to see if the Cell associated with the FVector coordinates found by lerp is not traversible and will return true meaning that cell is not reachable by a straight line
-			return true;
-		}
-	}
-	return false;
+	Algo::Reverse(path);
 }
 
 //LineTrace() function for path smoothing
 //Function takes in the current path from robot to player, the location of the robot, and a reference to the grid
 //Returns a tuple so I can easily access the FVector and FCellRef representation of the same location
-tuple<FVector, FCellRef> getLineTrace2(const vector<FCellRef>& path, const FVector& origin, const AGAGridActor* Grid) {
+//pathPositions is the caller's scratch array for the positions of the path cells
+tuple<FVector, FCellRef> getLineTrace2(TConstArrayView<FCellRef> path, const FVector& origin, const AGAGridActor* Grid, TArray<FVector>& pathPositions) {
 
 	FCellRef originCell = Grid->GetCellRef(origin);
-	FCellRef prev = originCell;
 
-	//Loop through the A* path and check if cell in the path is directly reachable from the origin without hitting a wall by passing the cell vector to getPointsAlongLine
-	for (const auto& element : path) {
-		FVector destCellVec = Grid->GetCellPosition(element);
+	//Get the positions of every cell in the A* path in one go
+	pathPositions.SetNumUninitialized(path.Num(), false);
+	Grid->GetCellPositions(path, pathPositions);
 
-		if (getPointsAlongLine2(origin, destCellVec, Grid)) {
-			return make_tuple(Grid->GetCellPosition(prev), prev); //If there is an obstruction found between the robot and the current cell in the loop, the function returns the previous cell that could be reached via a straight line
-		}
+	//Walk the grid cell by cell from the origin to each cell of the path in turn, stopping at the first one that can't be reached in a straight line without hitting a wall
+	int32 blockedIndex = Grid->FindFirstBlockedLine(origin, pathPositions);
 
-		prev = element;
+	if (blockedIndex == INDEX_NONE) {
+		return make_tuple(pathPositions.Last(), path.Last()); //If nothing is blocked that means all are reachable via a straight line and it returns the end of the path (i.e. the player's cell) as the one to point towards
 	}
-
-	return make_tuple(Grid->GetCellPosition(path.back()), path.back()); //If all cells return false that means all are reachable via a straight line and it returns the end of the path (i.e. the player's cell) as the one to point towards
+	if (blockedIndex == 0) {
+		return make_tuple(Grid->GetCellPosition(originCell), originCell); //Not even the first cell of the path is in a straight line, so stay put
+	}
+	return make_tuple(pathPositions[blockedIndex - 1], path[blockedIndex - 1]); //Otherwise head for the last cell before the obstruction that could be reached via a straight line
 }
 
-//Comparator struct to order the <dist, cell> pairs by lowest distance in Dijkstra priority queue
-struct PairLess {
-	bool operator()(const std::pair<float, FCellRef>& lhs, const std::pair<float, FCellRef>& rhs) const {
-		return lhs.first > rhs.first;  // Compare based on the float values
+//Comparator struct to order the <dist, cell> pairs by lowest distance in the Dijkstra open list (a TArray heap)
+struct CheaperFirst {
+	bool operator()(const TPair<float, FCellRef>& lhs, const TPair<float, FCellRef>& rhs) const {
+		return lhs.Key < rhs.Key;
 	}
 };
 
-//Compare function to compare float of <cell val, cell> pair to order by max cell value from GridMap
-bool comparePairs(const std::pair<float, FCellRef>& a, const std::pair<float, FCellRef>& b) {
-	return a.first < b.first;
-}
-
 
 bool UGASpatialComponent::ChoosePosition(bool PathfindToPosition, bool Debug)
 {
@@ -213,6 +190,11 @@ bool UGASpatialComponent::ChoosePosition(bool PathfindToPosition, bool Debug)
 	const UGAPathComponent* pathComponent = GetPathComponent();
 	UGAPathComponent* nonConstPathComponent = const_cast<UGAPathComponent*>(pathComponent);
 
+	if ((Grid == NULL) || !Grid->IsGridDataReady())
+	{
+		return false;
+	}
+
 	if (SpatialFunctionReference.Get() == NULL)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("UGASpatialComponent has no SpatialFunctionReference assigned."));
@@ -251,11 +233,11 @@ bool UGASpatialComponent::ChoosePosition(bool PathfindToPosition, bool Debug)
 		// to make a separate bp-accessible FStruct that represents _exactly the same thing_.
 		FGridBox GridBox(CellRect);
 
-		// This is the grid map I'm going to fill with values
-		FGAGridMap GridMap(Grid, GridBox, 0.0f);
+		// This is the grid map I'm going to fill with values (borrowed from the grid's pool, like the other scratch maps)
+		FGAPooledGridMap GridMap(Grid->GetMapPool(), Grid, GridBox, 0.0f);
 
-		// Fill in this distance map using Dijkstra!
-		FGAGridMap DistanceMap(Grid, GridBox, FLT_MAX);
+		// Fill in this distance map using Dijkstra! Step costs are whole numbers, so 16 bits a cell is plenty
+		TGAPooledGridMap<FGAGridDistanceMap> DistanceMap(Grid->GetMapPool(), Grid, GridBox, FLT_MAX);
 
 
 		// ~~~ STEPS TO FILL IN FOR ASSIGNMENT 3 ~~~
@@ -265,46 +247,33 @@ bool UGASpatialComponent::ChoosePosition(bool PathfindToPosition, bool Debug)
 		// I would recommend adding a method to the path component which looks something like
 		// bool UGAPathComponent::Dijkstra(const FVector &StartPoint, FGAGridMap &DistanceMapOut) const;
 		
-		Dijkstra(pawnLocation, DistanceMap);
+		Dijkstra(pawnLocation, *DistanceMap);
 
 		// Step 2: For each layer in the spatial function, evaluate and accumulate the layer in GridMap
 		// Note, only evaluate accessible cells found in step 1
 		for (const FFunctionLayer& Layer : SpatialFunction->Layers)
 		{
 			// figure out how to evaluate each layer type, and accumulate the value in the GridMap
-			EvaluateLayer(Layer, GridMap, DistanceMap);
+			EvaluateLayer(Layer, *GridMap, *DistanceMap);
 		}
 
 		// Step 3: pick the best cell in GridMap
 
-		//Loop through all cells in the grid and add them and their value to a vector
-		vector<std::pair<float, FCellRef>> cellValVec;
-
-		for (int32 Y = GridMap.GridBounds.MinY; Y < GridMap.GridBounds.MaxY; Y++)
-		{
-			for (int32 X = GridMap.GridBounds.MinX; X < GridMap.GridBounds.MaxX; X++)
-			{
-				FCellRef CellRef(X, Y);
-				float curVal;
-				GridMap.GetValue(CellRef, curVal);
-
-				cellValVec.push_back({ curVal, CellRef });
+		//The highest value cell that Dijkstra actually reached
+		FGAGridBitPlane& reachable = ReachableCellsScratch;
+		reachable.Init(Grid->XCount, Grid->YCount);
+		for (int32 Y = DistanceMap->GridBounds.MinY; Y < DistanceMap->GridBounds.MaxY; Y++) {
+			for (int32 X = DistanceMap->GridBounds.MinX; X < DistanceMap->GridBounds.MaxX; X++) {
+				float curDistVal;
+				if (DistanceMap->GetValue(FCellRef(X, Y), curDistVal) && curDistVal >= 0 && curDistVal < FLT_MAX) {
+					reachable.Set(X, Y, true);
+				}
 			}
 		}
 
-		//sort the vector by highest value
-		sort(cellValVec.begin(), cellValVec.end(), comparePairs);
-
-		//loop through vector to find the highest value cell that is also traversable in Dijkstra and set that as the max
 		FCellRef maxCell;
-		for (const auto& pair : cellValVec) {
-			float curDistVal;
-			DistanceMap.GetValue(pair.second, curDistVal);
-
-			if (curDistVal >= 0 && curDistVal < FLT_MAX && trunc(curDistVal) == curDistVal) {
-				maxCell = pair.second;
-			}
-		}
+		float maxVal;
+		GridMap->ArgMax(maxCell, maxVal, &reachable);
 
 		// Let's pretend for now we succeeded.
 		Result = true;
@@ -317,15 +286,18 @@ bool UGASpatialComponent::ChoosePosition(bool PathfindToPosition, bool Debug)
 			// or in the UGAPathComponent
 
 			//if ladder to get the path from current robot cell to max cell and follow the smoothed path towards the max until it reaches it and stops
-			vector<FCellRef> path = getPositionPath(DistanceMap, pawnLocation, maxCell, Grid);
-			if (path.size() > 1 && path.size() < 1000) {
-				tuple<FVector, FCellRef> moveToTuple = getLineTrace2(path, pawnLocation, Grid);
+			TArray<FCellRef>& path = PathScratch;
+			getPositionPath(*DistanceMap, pawnLocation, maxCell, Grid, path);
+			if (path.Num() > 1 && path.Num() < 1000) {
+				tuple<FVector, FCellRef> moveToTuple = getLineTrace2(path, pawnLocation, Grid, PathPositionsScratch);
 				nonConstPathComponent->SetDestination(Grid->GetCellPosition(get<1>(moveToTuple)));
+				nonConstPathComponent->Steps.SetNum(1); //SetDestination leaves Steps empty if it couldn't find a path itself
 				nonConstPathComponent->Steps[0].Set(FVector2D(get<0>(moveToTuple)), get<1>(moveToTuple));
 				nonConstPathComponent->State = GAPS_Active;
 			}
-			else if (path.size() == 1000) {
+			else if (path.Num() == 1000) {
 				nonConstPathComponent->SetDestination(Grid->GetCellPosition(maxCell));
+				nonConstPathComponent->Steps.SetNum(1);
 				nonConstPathComponent->Steps[0].Set(Grid->GetCellGridSpacePosition(maxCell), maxCell);
 				nonConstPathComponent->State = GAPS_Active;
 			}
@@ -343,7 +315,7 @@ bool UGASpatialComponent::ChoosePosition(bool PathfindToPosition, bool Debug)
 			// cache it off for debug rendering. Ideally you'd be able to control what layer you wanted to 
 			// see from blueprint
 
-			GridActor->DebugGridMap = GridMap;
+			GridActor->DebugGridMap = *GridMap;
 			GridActor->RefreshDebugTexture();
 			GridActor->DebugMeshComponent->SetVisibility(true);		//cheeky!
 		}
@@ -353,7 +325,7 @@ bool UGASpatialComponent::ChoosePosition(bool PathfindToPosition, bool Debug)
 }
 
 
-void UGASpatialComponent::EvaluateLayer(const FFunctionLayer& Layer, FGAGridMap &GridMap, const FGAGridMap &DistanceMap) const
+void UGASpatialComponent::EvaluateLayer(const FFunctionLayer& Layer, FGAGridMap &GridMap, const FGAGridDistanceMap &DistanceMap) const
 {
 	AActor* OwnerPawn = GetOwnerPawn();
 	const AGAGridActor* Grid = GetGridActor();
@@ -361,118 +333,189 @@ void UGASpatialComponent::EvaluateLayer(const FFunctionLayer& Layer, FGAGridMap
 	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
 	FVector StartPoint = OwnerPawn->GetActorLocation();
 	FVector End = PlayerPawn->GetActorLocation();
+
+	// For LOS, rays start where the AI's center would be if it stood on the cell
+	float OwnerHeightAboveGround = 0.0f;
+	const bool bHasOwnerHeight = Grid->GetHeightAboveGround(StartPoint, OwnerHeightAboveGround);
 	
 	//UGAPathComponent* nonConstPathComponent = const_cast<UGAPathComponent*>(pathComponent);
 
+	// Only these inputs need cell world positions; those are converted a whole row at a time
+	const bool bNeedsPositions = (Layer.Input == ESpatialInput::SI_TargetRange) || (Layer.Input == ESpatialInput::SI_LOS) || (Layer.Input == ESpatialInput::SI_PERCEP);
+
+	// For perception, cells are scored by how much of the current target's omap lies around them
+	const UGAPerceptionComponent* PerceptionComponent = (Layer.Input == ESpatialInput::SI_PERCEP) ? GetOwner()->FindComponentByClass<UGAPerceptionComponent>() : NULL;
+	const UGATargetComponent* TargetComponent = PerceptionComponent ? PerceptionComponent->GetCurrentTarget() : NULL;
+
+	// For LOS, the baked visibility table (if there is one) can rule out whole rows and cells without tracing
+	const FCellRef PlayerCell = Grid->GetCellRef(End);
+	const int32 RowWidth = FMath::Max(GridMap.GridBounds.MaxX - GridMap.GridBounds.MinX, 0);
+	TArray<FCellRef>& RowCells = RowCellsScratch;
+	TArray<FVector>& RowPositions = RowPositionsScratch;
+	if (bNeedsPositions)
+	{
+		RowCells.SetNumUninitialized(RowWidth, false);
+		RowPositions.SetNumUninitialized(RowWidth, false);
+	}
+
+	// The layer's values are evaluated into their own map first, then combined into GridMap in one go below
+	FGAPooledGridMap LayerMap(Grid->GetMapPool(), Grid, GridMap.GridBounds, 0.0f);
+
 	for (int32 Y = GridMap.GridBounds.MinY; Y < GridMap.GridBounds.MaxY; Y++)
 	{
-		for (int32 X = GridMap.GridBounds.MinX; X < GridMap.GridBounds.MaxX; X++)
+		// Skip rows that are blocked all the way across, 64 cells at a time
+		if (!Grid->IsAnyTraversableInSpan(Y, GridMap.GridBounds.MinX, GridMap.GridBounds.MaxX - 1))
 		{
-			FCellRef CellRef(X, Y);
-			//DistanceMap.GridBounds.IsValidCell(CellRef) && 
-			if (EnumHasAllFlags(Grid->GetCellData(CellRef), ECellData::CellDataTraversable))
-			{
-				// evaluate me!
-
-				// First step is determine input value. Remember there are three possible inputs to handle:
-				// 	SI_None				UMETA(DisplayName = "None"),
-				//	SI_TargetRange		UMETA(DisplayName = "Target Range"),
-				//	SI_PathDistance		UMETA(DisplayName = "PathDistance"),
-				//	SI_LOS				UMETA(DisplayName = "Line Of Sight")
+			continue;
+		}
 
-				// Next, run it through the response curve using something like this
-				// float Value = 4.5f;
-				// float ModifiedValue = Layer.ResponseCurve.GetRichCurveConst()->Eval(Value, 0.0f);
+		// Flag inputs are zero across the whole row unless some cell of it has the flag
+		const ECellData RowFlag = (Layer.Input == ESpatialInput::SI_Cover) ? ECellData::CellDataCover : ECellData::CellDataHazard;
+		const bool bRowHasFlag = ((Layer.Input == ESpatialInput::SI_Cover) || (Layer.Input == ESpatialInput::SI_Hazard))
+			&& Grid->IsAnyFlagInSpan(RowFlag, Y, GridMap.GridBounds.MinX, GridMap.GridBounds.MaxX - 1);
 
-				// Then add it's influence to the grid map, combining with the current value using one of the two operators
-				//	SO_None				UMETA(DisplayName = "None"),
-				//	SO_Add				UMETA(DisplayName = "Add"),			// add this layer to the accumulated buffer
-				//	SO_Multiply			UMETA(DisplayName = "Multiply")		// multiply this layer into the accumulated buffer
+		const bool bRowMaybeVisible = (Layer.Input == ESpatialInput::SI_LOS)
+			&& Grid->IsAnyCellPotentiallyVisibleInSpan(PlayerCell, Y, GridMap.GridBounds.MinX, GridMap.GridBounds.MaxX - 1);
 
-				float ModifiedValue;
-				float value;
+		if (bNeedsPositions)
+		{
+			for (int32 Index = 0; Index < RowWidth; Index++)
+			{
+				RowCells[Index] = FCellRef(GridMap.GridBounds.MinX + Index, Y);
+			}
+			Grid->GetCellPositions(RowCells, RowPositions);
+		}
 
-				switch (Layer.Input) {
-					case ESpatialInput::SI_None:
-						value = 0.0f;
-						break;
-					case ESpatialInput::SI_TargetRange: 
-						value = FVector::Dist(Grid->GetCellPosition(CellRef), End); //Get FVector dist from current cell to player cell
-						break;
-					case ESpatialInput::SI_PathDistance:
-						float tempDist;
-						DistanceMap.GetValue(CellRef, tempDist); //Get Dijkstra path distance value and makes sure it is traversable from Dijkstra
-						value = (tempDist != FLT_MAX) ? tempDist : 0.0f;
-						break;
-					case ESpatialInput::SI_PERCEP:
-						value = 0.0f;
-						break;
-					case ESpatialInput::SI_LOS:
-						UWorld* World = GetWorld();
-						FHitResult HitResult;
-						FCollisionQueryParams Params;
-						FVector Start = Grid->GetCellPosition(CellRef);
-						Start.Z = End.Z;		// Hack: we don't have Z information in the grid actor -- take the player's z value and raycast against that
-						Params.AddIgnoredActor(PlayerPawn);			// Probably want to ignore the player pawn
-						Params.AddIgnoredActor(OwnerPawn);			// Probably want to ignore the AI themself
-						bool bHitSomething = World->LineTraceSingleByChannel(HitResult, Start, End, ECollisionChannel::ECC_Visibility, Params);
-						//If bHitSomething is false, then we have a clear LOS
-						value = bHitSomething ? 0.0f : 1.0f;
+		//Only traversable cells get evaluated, and their values go straight into the layer map's row
+		float* layerRow = LayerMap->GetRowData(Y);
+		Grid->ForEachTraversableCell(FIntRect(GridMap.GridBounds.MinX, Y, GridMap.GridBounds.MaxX - 1, Y), [&](const FCellRef& CellRef, ECellData Flags)
+		{
+			const int32 X = CellRef.X;
+
+			// evaluate me!
+
+			// First step is determine input value. Remember there are three possible inputs to handle:
+			// 	SI_None				UMETA(DisplayName = "None"),
+			//	SI_TargetRange		UMETA(DisplayName = "Target Range"),
+			//	SI_PathDistance		UMETA(DisplayName = "PathDistance"),
+			//	SI_LOS				UMETA(DisplayName = "Line Of Sight")
+
+			// Next, run it through the response curve using something like this
+			// float Value = 4.5f;
+			// float ModifiedValue = Layer.ResponseCurve.GetRichCurveConst()->Eval(Value, 0.0f);
+
+			// Then add it's influence to the grid map, combining with the current value using one of the two operators
+			//	SO_None				UMETA(DisplayName = "None"),
+			//	SO_Add				UMETA(DisplayName = "Add"),			// add this layer to the accumulated buffer
+			//	SO_Multiply			UMETA(DisplayName = "Multiply")		// multiply this layer into the accumulated buffer
+
+			float ModifiedValue;
+			float value;
+
+			switch (Layer.Input) {
+				case ESpatialInput::SI_None:
+					value = 0.0f;
+					break;
+				case ESpatialInput::SI_TargetRange: 
+					value = FVector::Dist(RowPositions[X - GridMap.GridBounds.MinX], End); //Get FVector dist from current cell to player cell
+					break;
+				case ESpatialInput::SI_PathDistance:
+					float tempDist;
+					DistanceMap.GetValue(CellRef, tempDist); //Get Dijkstra path distance value and makes sure it is traversable from Dijkstra
+					value = (tempDist != FLT_MAX) ? tempDist : 0.0f;
+					break;
+				case ESpatialInput::SI_PERCEP:
+					value = TargetComponent ? TargetComponent->GetOccupancyAround(RowPositions[X - GridMap.GridBounds.MinX], Grid->CellScale) : 0.0f;
+					break;
+				case ESpatialInput::SI_Cover:
+				case ESpatialInput::SI_Hazard:
+					value = (bRowHasFlag && EnumHasAnyFlags(Flags, RowFlag)) ? 1.0f : 0.0f;
+					break;
+				case ESpatialInput::SI_LOS:
+					if (!bRowMaybeVisible || !Grid->IsCellPotentiallyVisible(CellRef, PlayerCell)) {
+						value = 0.0f;		// Static geometry is in the way, no need to trace
 						break;
-				}
+					}
+					UWorld* World = GetWorld();
+					FHitResult HitResult;
+					FCollisionQueryParams Params;
+					FVector Start = RowPositions[X - GridMap.GridBounds.MinX];
+					if (bHasOwnerHeight && Grid->HasCellHeight(CellRef))
+					{
+						Start.Z += OwnerHeightAboveGround;
+					}
+					else
+					{
+						Start.Z = End.Z;		// Fallback: no Z information for this cell -- take the player's z value and raycast against that
+					}
+					Params.AddIgnoredActor(PlayerPawn);			// Probably want to ignore the player pawn
+					Params.AddIgnoredActor(OwnerPawn);			// Probably want to ignore the AI themself
+					bool bHitSomething = World->LineTraceSingleByChannel(HitResult, Start, End, ECollisionChannel::ECC_Visibility, Params);
+					//If bHitSomething is false, then we have a clear LOS
+					value = bHitSomething ? 0.0f : 1.0f;
+					break;
+			}
 
-				ModifiedValue = Layer.ResponseCurve.GetRichCurveConst()->Eval(value, 0.0f);
-				float curValue;
-				GridMap.GetValue(CellRef, curValue);
+			ModifiedValue = Layer.ResponseCurve.GetRichCurveConst()->Eval(value, 0.0f);
+			layerRow[X - LayerMap->GridBounds.MinX] = ModifiedValue;
 
-				switch (Layer.Op) {
-					case ESpatialOp::SO_None: 
-						GridMap.SetValue(CellRef, 0.0f);
-						break;
-					case ESpatialOp::SO_Add: 
-						GridMap.SetValue(CellRef, curValue + ModifiedValue);
-						break;
-					case ESpatialOp::SO_Multiply: 
-						GridMap.SetValue(CellRef, curValue * ModifiedValue);
-						break;
-				}
+			// HERE ARE SOME ADDITIONAL HINTS
 
-				// HERE ARE SOME ADDITIONAL HINTS
+			// Here's how to get the player's pawn
+			// APawn *PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
 
-				// Here's how to get the player's pawn
-				// APawn *PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
+			// Here's how to cast a ray
 
-				// Here's how to cast a ray
+			// UWorld* World = GetWorld();
+			// FHitResult HitResult;
+			// FCollisionQueryParams Params;
+			// FVector Start = Grid->GetCellPosition(CellRef);		// need a ray start
+			// FVector End = PlayerPawn->GetActorLocation();		// need a ray end
+			// Start.Z = End.Z;		// Hack: we don't have Z information in the grid actor -- take the player's z value and raycast against that
+			// Add any actors that should be ignored by the raycast by calling
+			// Params.AddIgnoredActor(PlayerPawn);			// Probably want to ignore the player pawn
+			// Params.AddIgnoredActor(OwnerPawn);			// Probably want to ignore the AI themself
+			// bool bHitSomething = World->LineTraceSingleByChannel(HitResult, Start, End, ECollisionChannel::ECC_Visibility, Params);
+			// If bHitSomething is false, then we have a clear LOS
+		});
+	}
 
-				// UWorld* World = GetWorld();
-				// FHitResult HitResult;
-				// FCollisionQueryParams Params;
-				// FVector Start = Grid->GetCellPosition(CellRef);		// need a ray start
-				// FVector End = PlayerPawn->GetActorLocation();		// need a ray end
-				// Start.Z = End.Z;		// Hack: we don't have Z information in the grid actor -- take the player's z value and raycast against that
-				// Add any actors that should be ignored by the raycast by calling
-				// Params.AddIgnoredActor(PlayerPawn);			// Probably want to ignore the player pawn
-				// Params.AddIgnoredActor(OwnerPawn);			// Probably want to ignore the AI themself
-				// bool bHitSomething = World->LineTraceSingleByChannel(HitResult, Start, End, ECollisionChannel::ECC_Visibility, Params);
-				// If bHitSomething is false, then we have a clear LOS
-			}
-		}
+	//The rows were written directly, so the layer map's active bounds need catching up before it's combined
+	LayerMap->RecomputeActiveBounds();
+
+	// Combine the layer with the accumulated buffer, over the traversable cells
+	const FGAGridBitPlane& traversable = Grid->GetTraversableBits();
+	switch (Layer.Op) {
+		case ESpatialOp::SO_None:
+			GridMap.Fill(0.0f, &traversable);
+			break;
+		case ESpatialOp::SO_Add:
+			GridMap.Add(*LayerMap, 1.0f, &traversable);
+			break;
+		case ESpatialOp::SO_Multiply:
+			GridMap.Multiply(*LayerMap, &traversable);
+			break;
 	}
 }
 
 //Dijkstra implementation to get distance from start to all traversible cells in the distance map
-bool UGASpatialComponent::Dijkstra(const FVector& StartPoint, FGAGridMap& DistanceMapOut) const
+bool UGASpatialComponent::Dijkstra(const FVector& StartPoint, FGAGridDistanceMap& DistanceMapOut) const
 {
 	const AGAGridActor* Grid = GetGridActor();
 
 	FCellRef startCell = Grid->GetCellRef(StartPoint);
-	priority_queue<pair<float, FCellRef>, vector<pair<float, FCellRef>>, PairLess> pq;
-	pq.push({ 0.0f, startCell });
-	vector<FCellRef> visited;
-	visited.push_back(startCell);
+	//The open list reuses the same array every query, so it stops allocating once it has grown big enough
+	TArray<TPair<float, FCellRef>>& pq = OpenListScratch;
+	pq.Reset();
+	pq.HeapPush(TPair<float, FCellRef>(0.0f, startCell), CheaperFirst());
+	DistanceMapOut.SetValue(startCell, 0.0f);
 	FCellRef temp = FCellRef(10, 75);
 
-	list<pair<int, int>> directions = {
+	//Only gather cells the AI actually fits in
+	const UGAPathComponent* pathComponent = GetPathComponent();
+	float agentRadius = pathComponent ? pathComponent->AgentRadius : 0.0f;
+
+	static const int32 directions[4][2] = {
 			{0,1},
 			{0,-1},
 			{1,0},
@@ -480,27 +523,34 @@ bool UGASpatialComponent::Dijkstra(const FVector& StartPoint, FGAGridMap& Distan
 	};
 
 	//loops while there are still cells in the priority queue
-	while (!pq.empty()) {
-		pair<float, FCellRef> curCellPair = pq.top();
-		pq.pop();
+	while (pq.Num() > 0) {
+		TPair<float, FCellRef> curCellPair;
+		pq.HeapPop(curCellPair, CheaperFirst(), false);
 
-		float curDist = curCellPair.first;
-		FCellRef curCell = curCellPair.second;
-		DistanceMapOut.SetValue(curCell, curDist); //sets the value in the distance map to the current distance from start
+		float curDist = curCellPair.Key;
+		FCellRef curCell = curCellPair.Value;
 
-		float newDist = curDist + 1.0f;
+		//Steps now cost different amounts, so a cell can get queued more than once. Only the cheapest entry counts.
+		float bestDist;
+		if (DistanceMapOut.GetValue(curCell, bestDist) && curDist > bestDist) {
+			continue;
+		}
 
 		//Loop through the left-right-up-down neighbor adjacent cells of the current cell 
 		for (const auto& d : directions) {
-			int newX = curCell.X + d.first;
-			int newY = curCell.Y + d.second;
+			int newX = curCell.X + d[0];
+			int newY = curCell.Y + d[1];
 			FCellRef adjCell = FCellRef(newX, newY);
 
-			//If the neighbor has not already been visisted, is valid, and is traversable, then it is added to visited and added to the priority queue
-			auto inVisted = find(visited.begin(), visited.end(), adjCell);
-			if (inVisted == visited.end() && DistanceMapOut.GridBounds.IsValidCell(adjCell) && Grid->GetCellData(adjCell) == ECellData::CellDataTraversable) {
-				visited.push_back(adjCell);
-				pq.push({ newDist, adjCell });
+			//Stepping into a cell costs that cell's traversal cost (1 unless it's slow, a door, a hazard etc.)
+			float newDist = curDist + float(Grid->GetCellCost(adjCell));
+
+			//If the neighbor is valid, traversable and this is the shortest way to it found so far, then its distance is updated and it is added to the priority queue
+			//Distances too big for the map to hold count as unreachable
+			float adjDist;
+			if (DistanceMapOut.GridBounds.IsValidCell(adjCell) && Grid->HasClearance(adjCell, agentRadius) && DistanceMapOut.CanStore(newDist) && DistanceMapOut.GetValue(adjCell, adjDist) && newDist < adjDist) {
+				DistanceMapOut.SetValue(adjCell, newDist);
+				pq.HeapPush(TPair<float, FCellRef>(newDist, adjCell), CheaperFirst());
 			}
 		}
 	}
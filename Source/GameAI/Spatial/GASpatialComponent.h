@@ -3,6 +3,7 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "GameAI/Grid/GAGridActor.h"
+#include "GameAI/Grid/GAGridMapTyped.h"
 #include "GASpatialComponent.generated.h"
 
 class UGASpatialFunction;
@@ -52,9 +53,26 @@ class UGASpatialComponent : public UActorComponent
 	UFUNCTION(BlueprintCallable)
 	bool ChoosePosition(bool PathfindToPosition, bool Debug);
 
-	void EvaluateLayer(const FFunctionLayer& Layer, FGAGridMap& GridMap, const FGAGridMap& DistanceMap) const;
+	void EvaluateLayer(const FFunctionLayer& Layer, FGAGridMap& GridMap, const FGAGridDistanceMap& DistanceMap) const;
 
-	bool Dijkstra(const FVector& StartPoint, FGAGridMap& DistanceMapOut) const;
+	// Fills in the step cost from StartPoint to every cell of DistanceMapOut the AI can reach. The rest keep their value.
+	bool Dijkstra(const FVector& StartPoint, FGAGridDistanceMap& DistanceMapOut) const;
 
+private:
+	// Scratch space kept from one query to the next, so that queries stop allocating once they've warmed up
+	// (the maps themselves come from the grid's map pool). Mutable so the const queries can use it too.
+
+	mutable TArray<TPair<float, FCellRef>> OpenListScratch;
+
+	mutable TArray<FCellRef> RowCellsScratch;
+
+	mutable TArray<FVector> RowPositionsScratch;
+
+	// The path to the chosen position, and the positions of its cells
+	TArray<FCellRef> PathScratch;
+
+	TArray<FVector> PathPositionsScratch;
+
+	FGAGridBitPlane ReachableCellsScratch;
 
 };
\ No newline at end of file
@@ -14,7 +14,9 @@ enum ESpatialInput
 	SI_TargetRange		UMETA(DisplayName = "Target Range"),
 	SI_PathDistance		UMETA(DisplayName = "PathDistance"),
 	SI_LOS				UMETA(DisplayName = "Line Of Sight"),
-	SI_PERCEP			UMETA(DisplayName = "Perception Last Known")
+	SI_PERCEP			UMETA(DisplayName = "Perception Last Known"),
+	SI_Cover			UMETA(DisplayName = "Cover"),				// 1 on cells flagged as cover, 0 elsewhere
+	SI_Hazard			UMETA(DisplayName = "Hazard")				// 1 on cells flagged as hazardous, 0 elsewhere
 	// Add others if you want!
 };
 